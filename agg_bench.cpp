@@ -0,0 +1,1631 @@
+//----------------------------------------------------------------------------
+// The benchmark of libagl. It draws the same scenes into every span format
+// of agg.h and reports the frame time, the shapes and the pixels per
+// second and the checksum of the image. The scenes are made with a seeded
+// generator and the whole pipeline is integer, so the checksums are the
+// same on the board and on the host, and they are compared with the ones
+// below: a change that makes things faster must not change the pixels.
+// If it's meant to change them, the table must be updated.
+//
+// The comparisons after the scenarios time the variants of one step of
+// the pipeline against each other, e.g. the sweep with and without the
+// fused coverage table, and check that they give the same result.
+//
+// On the board agg_bench() is called from main() (see AGG_BENCH in
+// main.c), on the host it's built with "make -f Makefile.host bench" in
+// libagl:
+//
+//     host/agg_bench [frames] [scenario or comparison]
+//
+//----------------------------------------------------------------------------
+#include <stdio.h>
+#include <string.h>
+#include "agg.h"
+#include "agg_curves.h"
+#include "agg_stroke.h"
+#include "agg_line_aa.h"
+#include "agg_path_storage.h"
+#include "agg_scanline_storage.h"
+#include "agg_trans_affine.h"
+
+#ifdef __lm32__
+#include "agg_stats.h"
+#ifndef AGG_BENCH_CLOCK_HZ
+#define AGG_BENCH_CLOCK_HZ 83333333
+#endif
+#else
+#include <stdlib.h>
+#include <time.h>
+#endif
+
+#ifdef AGG_BENCH_MT
+#include "agg_mt.h"
+#endif
+
+enum
+{
+    bench_width  = 640,
+    bench_height = 480,
+    bench_frames = 4
+};
+
+
+//----------------------------------------------------------------------------
+// Microseconds. On the board the 32-bit cycle counter is extended, so it
+// must be read at least once per wrap, that is, once per frame.
+static double bench_time_us()
+{
+#ifdef __lm32__
+    static unsigned           last = 0;
+    static unsigned long long high = 0;
+    unsigned cc = agg_stats_cycles();
+    if(cc < last) high += 1ULL << 32;
+    last = cc;
+    return double(high + cc) * 1e6 / double(AGG_BENCH_CLOCK_HZ);
+#else
+    timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return double(t.tv_sec) * 1e6 + double(t.tv_nsec) * 1e-3;
+#endif
+}
+
+
+//----------------------------------------------------------------------------
+// Xorshift, the same sequence everywhere, unlike rand()
+class bench_random
+{
+public:
+    bench_random(unsigned seed) : m_state(seed ? seed : 1) {}
+
+    unsigned next()
+    {
+        m_state ^= m_state << 13;
+        m_state ^= m_state >> 17;
+        m_state ^= m_state << 5;
+        return m_state;
+    }
+
+    // [lo...hi]
+    int uniform(int lo, int hi)
+    {
+        return lo + int(next() % unsigned(hi - lo + 1));
+    }
+
+    agg::rgba8 color(unsigned max, unsigned min_alpha)
+    {
+        unsigned v = next();
+        return agg::rgba8((v & 0xFF) % (max + 1),
+                          ((v >> 8) & 0xFF) % (max + 1),
+                          ((v >> 16) & 0xFF) % (max + 1),
+                          min_alpha + (v >> 24) % (256 - min_alpha));
+    }
+
+private:
+    unsigned m_state;
+};
+
+
+//----------------------------------------------------------------------------
+// The shapes of a scenario, made once before the timing: path path_id[i]
+// of the storage is drawn with colors[i].
+struct bench_scene
+{
+    agg::path_storage          paths;
+    agg::pod_vector<unsigned>  path_id;
+    agg::pod_vector<agg::rgba8> colors;
+    agg::filling_rule_e        filling_rule;
+
+    bench_scene() : filling_rule(agg::fill_non_zero) {}
+
+    template<class VertexSource> void add(VertexSource& vs, const agg::rgba8& c)
+    {
+        path_id.add(paths.start_new_path());
+        colors.add(c);
+
+        int x = 0;
+        int y = 0;
+        unsigned cmd;
+        vs.rewind(0);
+        while((cmd = vs.vertex(&x, &y)) != agg::path_cmd_stop)
+        {
+            paths.add_vertex(x, y, cmd);
+        }
+    }
+};
+
+
+//----------------------------------------------------------------------------
+// Random coordinates in subpixels, up to 30 pixels beyond the frame
+static int random_x(bench_random& rnd)
+{
+    return rnd.uniform(-30 * agg::poly_base_size, (bench_width + 30) * agg::poly_base_size);
+}
+
+static int random_y(bench_random& rnd)
+{
+    return rnd.uniform(-30 * agg::poly_base_size, (bench_height + 30) * agg::poly_base_size);
+}
+
+
+//----------------------------------------------------------------------------
+static void make_clear(bench_scene&)
+{
+}
+
+
+//----------------------------------------------------------------------------
+// Few big polygons, the cost is in the sweep and the blending
+static void make_polygons(bench_scene& s)
+{
+    bench_random rnd(1);
+    s.filling_rule = agg::fill_even_odd;
+    int i;
+    for(i = 0; i < 20; i++)
+    {
+        agg::path_storage poly;
+        int n = rnd.uniform(3, 8);
+        poly.move_to(random_x(rnd), random_y(rnd));
+        int j;
+        for(j = 1; j < n; j++) poly.line_to(random_x(rnd), random_y(rnd));
+        s.add(poly, rnd.color(255, 0));
+    }
+}
+
+
+//----------------------------------------------------------------------------
+// Many small ellipses, the cost is in the setup and the sort
+static void make_ellipses(bench_scene& s)
+{
+    bench_random rnd(2);
+    int i;
+    for(i = 0; i < 2000; i++)
+    {
+        agg::ellipse e(random_x(rnd), random_y(rnd),
+                       rnd.uniform(2 * agg::poly_base_size, 12 * agg::poly_base_size),
+                       rnd.uniform(2 * agg::poly_base_size, 12 * agg::poly_base_size));
+        s.add(e, rnd.color(127, 100));
+    }
+}
+
+
+//----------------------------------------------------------------------------
+// Stroked lines of 0.5...1.5 pixels, mostly the edges and the cells
+static void make_lines(bench_scene& s)
+{
+    bench_random rnd(3);
+    int i;
+    for(i = 0; i < 2000; i++)
+    {
+        agg::stroker st;
+        st.width(rnd.uniform(agg::poly_base_size / 2, agg::poly_base_size * 3 / 2));
+        int x = random_x(rnd);
+        int y = random_y(rnd);
+        st.move_to(x, y);
+        st.line_to(x + rnd.uniform(-200 * agg::poly_base_size, 200 * agg::poly_base_size),
+                   y + rnd.uniform(-200 * agg::poly_base_size, 200 * agg::poly_base_size));
+        s.add(st, rnd.color(127, 128));
+    }
+}
+
+
+//----------------------------------------------------------------------------
+struct bench_scenario
+{
+    const char* name;
+    void (*make)(bench_scene& s);
+};
+
+static const bench_scenario bench_scenarios[] =
+{
+    { "clear",    make_clear    },
+    { "polygons", make_polygons },
+    { "ellipses", make_ellipses },
+    { "lines",    make_lines    },
+    { 0, 0 }
+};
+
+
+//----------------------------------------------------------------------------
+// The expected checksums, scenario by scenario in the order of the
+// formats of run_formats()
+static const unsigned bench_checksums[][10] =
+{
+    { 0x39878dc5, 0x30f27dc5, 0x25f27dc5, 0x465d6dc5, 0x465d6dc5,
+      0x9ac85dc5, 0x9ac85dc5, 0x9ac85dc5, 0x9ac85dc5, 0x07015dc5 },
+    { 0x36d38f07, 0x84b4e7ca, 0xdef7710e, 0xbdc8b07d, 0x55e5c245,
+      0x92045046, 0x90e6b4c6, 0x5d4ebf70, 0x2894e860, 0x953d6483 },
+    { 0x288889ac, 0xc9c49600, 0x8665d289, 0x175b2a28, 0xd94f26c4,
+      0x454c824f, 0x8a9d009b, 0xb142524f, 0x3df6546b, 0x0b637864 },
+    { 0xaebd4fd1, 0x62eacaa8, 0xbcc61513, 0xeac53385, 0xcdfac9d9,
+      0x0401a3d5, 0x44458281, 0x4a5e0b59, 0x1a3d9745, 0xfce39003 }
+};
+
+
+//----------------------------------------------------------------------------
+// FNV-1a of the pixels. The formats of 16 and 32-bit words (word = 2, 4)
+// are read by words, so the sum doesn't depend on the byte order.
+static unsigned checksum(const agg::rendering_buffer& rbuf,
+                         unsigned bpp, unsigned word)
+{
+    unsigned h = 2166136261U;
+    unsigned y;
+    for(y = 0; y < rbuf.height(); y++)
+    {
+        const unsigned char* p = rbuf.row(y);
+        unsigned n = rbuf.width() * bpp / word;
+        for(; n; --n, p += word)
+        {
+            unsigned v = *p;
+            if(word == 2) v = *(const agg::int16u*)p;
+            if(word == 4) v = *(const agg::int32u*)p;
+            unsigned i;
+            for(i = 0; i < word; i++, v >>= 8) h = (h ^ (v & 0xFF)) * 16777619U;
+        }
+    }
+    return h;
+}
+
+
+//----------------------------------------------------------------------------
+// Passes the scanlines to the renderer and counts their pixels within
+// the buffer, once per scenario, not timed.
+template<class Renderer> class counting_renderer
+{
+public:
+    counting_renderer(Renderer& r) : m_ren(&r), m_pixels(0) {}
+
+    const agg::rendering_buffer& rbuf() const { return m_ren->rbuf(); }
+    unsigned pixels() const { return m_pixels; }
+
+    void clear(const agg::rgba8& c) { m_ren->clear(c); }
+
+    void render(const agg::scanline& sl, const agg::rgba8& c)
+    {
+        int y = sl.y();
+        if(y >= 0 && y < int(rbuf().height()))
+        {
+            int base_x = sl.base_x();
+            unsigned num_spans = sl.num_spans();
+            agg::scanline::iterator span(sl);
+            do
+            {
+                int x1 = span.next() + base_x;
+                int x2 = x1 + ((span.num_pix() < 0) ? -span.num_pix() : span.num_pix());
+                if(x1 < 0) x1 = 0;
+                if(x2 > int(rbuf().width())) x2 = rbuf().width();
+                if(x2 > x1) m_pixels += unsigned(x2 - x1);
+            }
+            while(--num_spans);
+        }
+        m_ren->render(sl, c);
+    }
+
+private:
+    Renderer* m_ren;
+    unsigned  m_pixels;
+};
+
+
+//----------------------------------------------------------------------------
+template<class Renderer, class Rasterizer>
+static void draw(Renderer& ren, Rasterizer& ras, const bench_scene& s)
+{
+    ren.clear(agg::rgba8(255, 255, 255));
+    ras.filling_rule(s.filling_rule);
+    unsigned i;
+    for(i = 0; i < s.path_id.size(); i++)
+    {
+        ras.reset();
+        ras.add_path(s.paths, s.path_id[i]);
+        ras.render(ren, s.colors[i]);
+    }
+}
+
+
+//----------------------------------------------------------------------------
+// Draws one scenario in one format. The first frame counts the pixels,
+// the other ones are timed. Returns false if the checksum has changed.
+template<class Span>
+static bool run_format(const char* name, unsigned bpp, unsigned word,
+                       const bench_scenario& sc, const bench_scene& s,
+                       unsigned expected, unsigned frames,
+                       unsigned char* buf)
+{
+    agg::rendering_buffer rbuf(buf, bench_width, bench_height, bench_width * bpp);
+    agg::renderer<Span> ren(rbuf);
+    agg::rasterizer ras;
+    ras.clip_box(0, 0, bench_width, bench_height);
+
+    counting_renderer<agg::renderer<Span> > counter(ren);
+    draw(counter, ras, s);
+    unsigned pixels = s.path_id.size() ? counter.pixels() :
+                                         unsigned(bench_width * bench_height);
+
+    double total = 0.0;
+    unsigned i;
+    for(i = 0; i < frames; i++)
+    {
+        double t = bench_time_us();
+        if(s.path_id.size()) draw(ren, ras, s);
+        else                 ren.clear(agg::rgba8(i & 0xFF, 128, 255));
+        total += bench_time_us() - t;
+    }
+    if(s.path_id.size() == 0) ren.clear(agg::rgba8(255, 255, 255));
+
+    unsigned sum = checksum(rbuf, bpp, word);
+    double us = total / double(frames);
+    if(us <= 0.0) us = 1e-3;
+
+    printf("%-9s %-14s %8u us %8u shapes/s %5u.%02u Mpix/s  %08x %s\n",
+           sc.name, name,
+           unsigned(us),
+           unsigned(double(s.path_id.size()) * 1e6 / us),
+           unsigned(double(pixels) / us),
+           unsigned(double(pixels) * 100.0 / us) % 100,
+           sum,
+           (expected == 0) ? "" : (sum == expected) ? "ok" : "CHANGED");
+    return expected == 0 || sum == expected;
+}
+
+
+//----------------------------------------------------------------------------
+static unsigned run_formats(const bench_scenario& sc, const unsigned* expected,
+                            unsigned frames, unsigned char* buf)
+{
+    bench_scene s;
+    sc.make(s);
+
+    unsigned failed = 0;
+    failed += !run_format<agg::span_mono8>     ("span_mono8",     1, 1, sc, s, expected[0], frames, buf);
+    failed += !run_format<agg::span_rgb555>    ("span_rgb555",    2, 2, sc, s, expected[1], frames, buf);
+    failed += !run_format<agg::span_rgb565>    ("span_rgb565",    2, 2, sc, s, expected[2], frames, buf);
+    failed += !run_format<agg::span_bgr24>     ("span_bgr24",     3, 1, sc, s, expected[3], frames, buf);
+    failed += !run_format<agg::span_rgb24>     ("span_rgb24",     3, 1, sc, s, expected[4], frames, buf);
+    failed += !run_format<agg::span_abgr32>    ("span_abgr32",    4, 1, sc, s, expected[5], frames, buf);
+    failed += !run_format<agg::span_argb32>    ("span_argb32",    4, 1, sc, s, expected[6], frames, buf);
+    failed += !run_format<agg::span_bgra32>    ("span_bgra32",    4, 1, sc, s, expected[7], frames, buf);
+    failed += !run_format<agg::span_rgba32>    ("span_rgba32",    4, 1, sc, s, expected[8], frames, buf);
+    failed += !run_format<agg::span_rgb101010> ("span_rgb101010", 4, 4, sc, s, expected[9], frames, buf);
+    return failed;
+}
+
+
+//----------------------------------------------------------------------------
+// The comparisons: two or more ways of doing the same work, timed one
+// after another in every frame. The best frame of each one is reported,
+// as the least disturbed. The variants must give the same result as the
+// first one, run() returns the number of the ones that don't.
+struct bench_comparison
+{
+    const char* name;
+    unsigned (*run)(unsigned frames);
+};
+
+
+//----------------------------------------------------------------------------
+// Hashes the spans of the scanlines, for comparing the sweeps without 
+// drawing anything
+class hash_renderer
+{
+public:
+    hash_renderer() : m_hash(2166136261U) {}
+
+    unsigned hash() const { return m_hash; }
+
+    void render(const agg::scanline& sl, const agg::rgba8&)
+    {
+        add(unsigned(sl.y()));
+        unsigned num_spans = sl.num_spans();
+        agg::scanline::iterator span(sl);
+        do
+        {
+            add(unsigned(span.next() + sl.base_x()));
+            int num_pix = span.num_pix();
+            add(unsigned(num_pix));
+            const agg::int8u* covers = span.covers();
+            if(num_pix < 0) num_pix = 1;
+            for(; num_pix; --num_pix) add(*covers++);
+        }
+        while(--num_spans);
+    }
+
+private:
+    void add(unsigned v) { m_hash = (m_hash ^ v) * 16777619U; }
+
+    unsigned m_hash;
+};
+
+// Takes the scanlines and does nothing, for the timing of the sweeps
+struct null_renderer
+{
+    void render(const agg::scanline&, const agg::rgba8&) {}
+};
+
+
+//----------------------------------------------------------------------------
+// The quicksort of the cell pointers that cells() used before the bucket
+// and radix sort, kept as the reference for compare_sort()
+enum
+{
+    qsort_threshold = 9
+};
+
+static inline void swap_cells(const agg::cell** a, const agg::cell** b)
+{
+    const agg::cell* temp = *a;
+    *a = *b;
+    *b = temp;
+}
+
+static inline bool less_than(const agg::cell** a, const agg::cell** b)
+{
+    return (*a)->key < (*b)->key;
+}
+
+static void qsort_cells(const agg::cell** start, unsigned num)
+{
+    const agg::cell**  stack[80];
+    const agg::cell*** top; 
+    const agg::cell**  limit;
+    const agg::cell**  base;
+
+    limit = start + num;
+    base  = start;
+    top   = stack;
+
+    for (;;)
+    {
+        int len = int(limit - base);
+
+        const agg::cell** i;
+        const agg::cell** j;
+        const agg::cell** pivot;
+
+        if(len > qsort_threshold)
+        {
+            // we use base + len/2 as the pivot
+            pivot = base + len / 2;
+            swap_cells(base, pivot);
+
+            i = base + 1;
+            j = limit - 1;
+
+            // now ensure that *i <= *base <= *j 
+            if(less_than(j, i))    swap_cells(i, j);
+            if(less_than(base, i)) swap_cells(base, i);
+            if(less_than(j, base)) swap_cells(base, j);
+
+            for(;;)
+            {
+                do i++; while( less_than(i, base) );
+                do j--; while( less_than(base, j) );
+                if(i > j) break;
+                swap_cells(i, j);
+            }
+
+            swap_cells(base, j);
+
+            // now, push the largest sub-array
+            if(j - base > limit - i)
+            {
+                top[0] = base;
+                top[1] = j;
+                base   = i;
+            }
+            else
+            {
+                top[0] = i;
+                top[1] = limit;
+                limit  = j;
+            }
+            top += 2;
+        }
+        else
+        {
+            // the sub-array is small, perform insertion sort
+            j = base;
+            i = j + 1;
+
+            for(; i < limit; j = i, i++)
+            {
+                for(; less_than(j + 1, j); j--)
+                {
+                    swap_cells(j + 1, j);
+                    if(j == base) break;
+                }
+            }
+            if(top > stack)
+            {
+                top  -= 2;
+                base  = top[0];
+                limit = top[1];
+            }
+            else
+            {
+                break;
+            }
+        }
+    }
+}
+
+
+//----------------------------------------------------------------------------
+// Hashes the cells in sorted order, the ones of the same key added up,
+// since the two sorts may leave them in a different order
+class cell_hash
+{
+public:
+    cell_hash() : m_hash(2166136261U), m_num(0) {}
+
+    unsigned hash() { flush(); return m_hash; }
+
+    void add(const agg::cell& c)
+    {
+        if(m_num && c.key == m_key)
+        {
+            m_cover += c.cover();
+            m_area  += c.area();
+            return;
+        }
+        flush();
+        m_key   = c.key;
+        m_cover = c.cover();
+        m_area  = c.area();
+        m_num   = 1;
+    }
+
+private:
+    void flush()
+    {
+        if(m_num == 0) return;
+        add(unsigned(m_key));
+        add(unsigned(m_cover));
+        add(unsigned(m_area));
+        m_num = 0;
+    }
+    void add(unsigned v) { m_hash = (m_hash ^ v) * 16777619U; }
+
+    unsigned            m_hash;
+    unsigned            m_num;
+    agg::cell::key_type m_key;
+    int                 m_cover;
+    int                 m_area;
+};
+
+
+//----------------------------------------------------------------------------
+// The sort of the cells in cells(): the bucket sort by Y and the radix or
+// insertion sort by X, against the quicksort of the pointers it replaced,
+// including the gathering of the pointers from the blocks. The shapes are
+// the 2000 small ellipses of the "ellipses" scene and 20 polygons of 40 
+// vertices across the frame. They're rasterized in groups of 20 outlines
+// before the timing, the sorts of a group are timed together. The cells
+// must come out in the same order.
+static unsigned compare_sort(unsigned frames)
+{
+    enum { group_size = 20 };
+    static const char* const variant_names[] = { "bucket+radix", "quicksort" };
+
+    unsigned failed = 0;
+    unsigned size;
+    for(size = 0; size < 2; size++)
+    {
+        bench_scene s;
+        if(size == 0)
+        {
+            make_ellipses(s);
+        }
+        else
+        {
+            bench_random rnd(4);
+            unsigned i;
+            for(i = 0; i < 20; i++)
+            {
+                agg::path_storage poly;
+                poly.move_to(random_x(rnd), random_y(rnd));
+                int j;
+                for(j = 1; j < 40; j++) poly.line_to(random_x(rnd), random_y(rnd));
+                s.add(poly, agg::rgba8(0, 0, 0));
+            }
+        }
+        unsigned num_shapes = s.path_id.size();
+
+        agg::outline* outlines = new agg::outline [group_size];
+        agg::pod_vector<const agg::cell*> pointers[group_size];
+        const agg::cell** sorted[group_size];
+
+        unsigned hash[2];
+        double best[2] = { 1e30, 1e30 };
+        unsigned f;
+        for(f = 0; f < frames; f++)
+        {
+            unsigned v;
+            for(v = 0; v < 2; v++)
+            {
+                cell_hash h;
+                double time = 0.0;
+                unsigned first;
+                for(first = 0; first < num_shapes; first += group_size)
+                {
+                    unsigned n = num_shapes - first;
+                    if(n > group_size) n = group_size;
+                    unsigned i;
+                    for(i = 0; i < n; i++)
+                    {
+                        outlines[i].reset();
+                        outlines[i].add_path(s.paths, s.path_id[first + i]);
+                        outlines[i].close_cells();
+                        pointers[i].remove_all();
+                        sorted[i] = pointers[i].allocate(outlines[i].num_cells());
+                    }
+
+                    double t = bench_time_us();
+                    for(i = 0; i < n; i++)
+                    {
+                        if(v == 0)
+                        {
+                            outlines[i].cells();
+                            continue;
+                        }
+                        const agg::cell** ptr = sorted[i];
+                        unsigned nb;
+                        for(nb = 0; nb < outlines[i].num_blocks(); nb++)
+                        {
+                            unsigned num;
+                            const agg::cell* c = outlines[i].block_cells(nb, &num);
+                            for(; num; --num) *ptr++ = c++;
+                        }
+                        qsort_cells(sorted[i], outlines[i].num_cells());
+                    }
+                    time += bench_time_us() - t;
+
+                    if(f) continue;
+                    for(i = 0; i < n; i++)
+                    {
+                        unsigned num = outlines[i].num_cells();
+                        unsigned k;
+                        if(v == 0)
+                        {
+                            const agg::cell* c = outlines[i].cells();
+                            for(k = 0; k < num; k++) h.add(c[k]);
+                        }
+                        else
+                        {
+                            for(k = 0; k < num; k++) h.add(*sorted[i][k]);
+                        }
+                    }
+                }
+                if(f == 0) hash[v] = h.hash();
+                if(time < best[v]) best[v] = time;
+            }
+        }
+
+        unsigned v;
+        for(v = 0; v < 2; v++)
+        {
+            bool same = hash[v] == hash[0];
+            failed += !same;
+            printf("%-9s %-11s %-12s %8u us %4u%%  %08x %s\n",
+                   "sort",
+                   size ? "polygons" : "ellipses",
+                   variant_names[v],
+                   unsigned(best[v]),
+                   unsigned(best[v] * 100.0 / ((best[0] > 0.0) ? best[0] : 1.0)),
+                   hash[v],
+                   same ? "ok" : "DIFFERENT");
+        }
+        delete [] outlines;
+    }
+    return failed;
+}
+
+
+//----------------------------------------------------------------------------
+// The rasterizer with the sorted sweep of render() run with a chosen
+// computation of the coverage. "calculate" is the per-cell work of the
+// loop before the fused table: calculate_alpha() and then the gamma.
+// "table" is the one of render(), "linear" ignores the gamma.
+class sweep_rasterizer : public agg::rasterizer
+{
+public:
+    enum sweep_e
+    {
+        sweep_calculate,
+        sweep_table,
+        sweep_linear
+    };
+
+    template<class Renderer> void render_sweep(Renderer& r, 
+                                               const agg::rgba8& c, 
+                                               sweep_e s)
+    {
+        if(!sort()) return;
+        const agg::cell* cells = m_outline.cells();
+        const agg::cell* end   = cells + m_outline.num_cells();
+        bool even_odd = m_filling_rule == agg::fill_even_odd;
+        m_scanline.reset(m_outline.min_x(), m_outline.max_x(), 0, 0);
+        switch(s)
+        {
+        case sweep_calculate:
+            sweep(r, m_scanline, c, cells, end, alpha_calculate(m_gamma, m_filling_rule));
+            break;
+
+        case sweep_table:
+            if(even_odd) sweep(r, m_scanline, c, cells, end, alpha_even_odd(m_alpha));
+            else         sweep(r, m_scanline, c, cells, end, alpha_non_zero(m_alpha));
+            break;
+
+        case sweep_linear:
+            if(even_odd) sweep(r, m_scanline, c, cells, end, alpha_even_odd_linear());
+            else         sweep(r, m_scanline, c, cells, end, alpha_non_zero_linear());
+            break;
+        }
+    }
+
+private:
+    struct alpha_calculate
+    {
+        const agg::int8u*   gamma;
+        agg::filling_rule_e filling_rule;
+        alpha_calculate(const agg::int8u* g, agg::filling_rule_e fr) : 
+            gamma(g), filling_rule(fr) {}
+        unsigned operator () (int area) const
+        {
+            return gamma[calculate_alpha(area, filling_rule)];
+        }
+    };
+};
+
+
+//----------------------------------------------------------------------------
+// The coverage computations of the sorted sweep, see sweep_rasterizer.
+// 20 polygons of 40 vertices across the frame are swept into the null 
+// renderer, with the default gamma and the identity one, with both 
+// filling rules.
+static unsigned compare_sweep(unsigned frames)
+{
+    enum { num_shapes = 20 };
+    static const char* const variant_names[] =
+    {
+        "calculate", "table", "linear"
+    };
+
+    bench_random rnd(4);
+    agg::path_storage paths;
+    unsigned path_id[num_shapes];
+    unsigned i;
+    for(i = 0; i < num_shapes; i++)
+    {
+        path_id[i] = paths.start_new_path();
+        paths.move_to(random_x(rnd), random_y(rnd));
+        int j;
+        for(j = 1; j < 40; j++) paths.line_to(random_x(rnd), random_y(rnd));
+    }
+
+    agg::int8u linear_gamma[256];
+    for(i = 0; i < 256; i++) linear_gamma[i] = agg::int8u(i);
+
+    unsigned failed = 0;
+    unsigned cfg;
+    for(cfg = 0; cfg < 4; cfg++)
+    {
+        bool linear = (cfg & 2) != 0;
+        agg::filling_rule_e rule = (cfg & 1) ? agg::fill_even_odd : agg::fill_non_zero;
+        unsigned num_variants = linear ? 3 : 2;
+
+        sweep_rasterizer* ras = new sweep_rasterizer [num_shapes];
+        for(i = 0; i < num_shapes; i++)
+        {
+            if(linear) ras[i].gamma(linear_gamma);
+            ras[i].filling_rule(rule);
+            ras[i].add_path(paths, path_id[i]);
+        }
+
+        unsigned hash[3];
+        unsigned v;
+        for(v = 0; v < num_variants; v++)
+        {
+            hash_renderer h;
+            for(i = 0; i < num_shapes; i++)
+            {
+                ras[i].render_sweep(h, agg::rgba8(0, 0, 0), sweep_rasterizer::sweep_e(v));
+            }
+            hash[v] = h.hash();
+        }
+
+        double best[3] = { 1e30, 1e30, 1e30 };
+        null_renderer nr;
+        unsigned f;
+        for(f = 0; f < frames; f++)
+        {
+            for(v = 0; v < num_variants; v++)
+            {
+                double t = bench_time_us();
+                for(i = 0; i < num_shapes; i++)
+                {
+                    ras[i].render_sweep(nr, agg::rgba8(0, 0, 0), sweep_rasterizer::sweep_e(v));
+                }
+                t = bench_time_us() - t;
+                if(t < best[v]) best[v] = t;
+            }
+        }
+
+        for(v = 0; v < num_variants; v++)
+        {
+            bool same = hash[v] == hash[0];
+            failed += !same;
+            printf("%-9s %-6s %-8s %-9s %8u us %4u%%  %08x %s\n",
+                   "sweep",
+                   linear ? "linear" : "gamma",
+                   (rule == agg::fill_even_odd) ? "even-odd" : "non-zero",
+                   variant_names[v],
+                   unsigned(best[v]),
+                   unsigned(best[v] * 100.0 / ((best[0] > 0.0) ? best[0] : 1.0)),
+                   hash[v],
+                   same ? "ok" : "DIFFERENT");
+        }
+        delete [] ras;
+    }
+    return failed;
+}
+
+
+//----------------------------------------------------------------------------
+// A static shape drawn many times at integer offsets: rasterized every
+// time, with render(ren, c, dx, dy), or stored once in scanline_storage
+// and replayed. The logo is 3 polygons and 3 ellipses, even-odd, about
+// 160x120 pixels, placed 300 times per frame in random colors, partly
+// off-screen. The images must be the same.
+static unsigned compare_replay(unsigned frames)
+{
+    enum { num_placements = 300 };
+    static const char* const variant_names[] = { "render", "replay" };
+
+    bench_random rnd(5);
+    bench_scene logo;
+    unsigned i;
+    for(i = 0; i < 3; i++)
+    {
+        agg::path_storage poly;
+        int n = rnd.uniform(4, 8);
+        poly.move_to(rnd.uniform(0, 160 * agg::poly_base_size),
+                     rnd.uniform(0, 120 * agg::poly_base_size));
+        int j;
+        for(j = 1; j < n; j++)
+        {
+            poly.line_to(rnd.uniform(0, 160 * agg::poly_base_size),
+                         rnd.uniform(0, 120 * agg::poly_base_size));
+        }
+        logo.add(poly, agg::rgba8(0, 0, 0));
+    }
+    for(i = 0; i < 3; i++)
+    {
+        int r = rnd.uniform(10 * agg::poly_base_size, 40 * agg::poly_base_size);
+        agg::ellipse e(rnd.uniform(r, 160 * agg::poly_base_size - r),
+                       rnd.uniform(r, 120 * agg::poly_base_size - r),
+                       r, r * 3 / 4);
+        logo.add(e, agg::rgba8(0, 0, 0));
+    }
+
+    int dx[num_placements];
+    int dy[num_placements];
+    agg::rgba8 colors[num_placements];
+    for(i = 0; i < num_placements; i++)
+    {
+        dx[i] = rnd.uniform(-80, bench_width - 80);
+        dy[i] = rnd.uniform(-60, bench_height - 60);
+        colors[i] = rnd.color(255, 64);
+    }
+
+    agg::rasterizer ras;
+    ras.filling_rule(agg::fill_even_odd);
+    agg::scanline_storage storage;
+    unsigned num_paths = logo.path_id.size();
+    for(i = 0; i < num_paths; i++)
+    {
+        ras.reset();
+        ras.add_path(logo.paths, logo.path_id[i]);
+        ras.render(storage, agg::rgba8(0, 0, 0));
+    }
+
+    unsigned char* buf = new unsigned char [bench_width * bench_height * 4];
+    agg::rendering_buffer rbuf(buf, bench_width, bench_height, bench_width * 4);
+    agg::renderer<agg::span_rgba32> ren(rbuf);
+
+    double best[2] = { 1e30, 1e30 };
+    unsigned sum[2] = { 0, 0 };
+    unsigned f;
+    for(f = 0; f < frames; f++)
+    {
+        unsigned v;
+        for(v = 0; v < 2; v++)
+        {
+            ren.clear(agg::rgba8(255, 255, 255));
+            double t = bench_time_us();
+            for(i = 0; i < num_placements; i++)
+            {
+                if(v == 0)
+                {
+                    unsigned j;
+                    for(j = 0; j < num_paths; j++)
+                    {
+                        ras.reset();
+                        ras.add_path(logo.paths, logo.path_id[j]);
+                        ras.render(ren, colors[i], dx[i], dy[i]);
+                    }
+                }
+                else
+                {
+                    storage.replay(ren, colors[i], dx[i], dy[i]);
+                }
+            }
+            t = bench_time_us() - t;
+            if(t < best[v]) best[v] = t;
+            sum[v] = checksum(rbuf, 4, 1);
+        }
+    }
+    delete [] buf;
+
+    unsigned failed = 0;
+    for(i = 0; i < 2; i++)
+    {
+        bool same = sum[i] == sum[0];
+        failed += !same;
+        printf("%-9s %-24s %8u us %4u%%  %08x %s\n",
+               "replay", variant_names[i],
+               unsigned(best[i]),
+               unsigned(best[i] * 100.0 / ((best[0] > 0.0) ? best[0] : 1.0)),
+               sum[i],
+               same ? "ok" : "DIFFERENT");
+    }
+    printf("%-9s %u bytes stored, %u scanlines, %u spans\n",
+           "replay", storage.byte_size(), storage.num_scanlines(), storage.num_spans());
+    return failed;
+}
+
+
+//----------------------------------------------------------------------------
+// The transformation of the vertices: trans_affine in 16.16 on the
+// subpixel coordinates, and a matrix of doubles on the pixel coordinates
+// with poly_coord() after it, like the floating point pipeline did. Both
+// rotate by the sine 0.6 and the cosine 0.8 around the center of the
+// frame, scale by 1.25 and move by (10.5, -20.25) pixels. The results
+// aren't the same bit by bit, the largest difference in subpixels is
+// reported and is only for the information.
+static unsigned compare_transform(unsigned frames)
+{
+    enum { num_vertices = 4096, num_passes = 16 };
+
+    const double cx = bench_width  / 2;
+    const double cy = bench_height / 2;
+    const double s  = 0.6;
+    const double c  = 0.8;
+    const double k  = 1.25;
+    const double tx = 10.5;
+    const double ty = -20.25;
+
+    agg::trans_affine mtx;
+    mtx *= agg::trans_affine_translation(agg::poly_coord(-cx), agg::poly_coord(-cy));
+    mtx *= agg::trans_affine_rotation(agg::affine_coord(s), agg::affine_coord(c));
+    mtx *= agg::trans_affine_scaling(agg::affine_coord(k));
+    mtx *= agg::trans_affine_translation(agg::poly_coord(cx + tx), agg::poly_coord(cy + ty));
+
+    // The same matrix in doubles, see trans_affine
+    const double d_sx  =  c * k;
+    const double d_shy =  s * k;
+    const double d_shx = -s * k;
+    const double d_sy  =  c * k;
+    const double d_tx  = cx + tx - d_sx  * cx - d_shx * cy;
+    const double d_ty  = cy + ty - d_shy * cx - d_sy  * cy;
+
+    int*    xy   = new int    [num_vertices * 2];
+    double* dxy  = new double [num_vertices * 2];
+    int*    out  = new int    [num_vertices * 2];
+    int*    dout = new int    [num_vertices * 2];
+
+    bench_random rnd(6);
+    unsigned i;
+    for(i = 0; i < num_vertices; i++)
+    {
+        xy[i * 2]      = random_x(rnd);
+        xy[i * 2 + 1]  = random_y(rnd);
+        dxy[i * 2]     = double(xy[i * 2])     / agg::poly_base_size;
+        dxy[i * 2 + 1] = double(xy[i * 2 + 1]) / agg::poly_base_size;
+    }
+
+    double best[2] = { 1e30, 1e30 };
+    unsigned f;
+    for(f = 0; f < frames; f++)
+    {
+        double t = bench_time_us();
+        unsigned pass;
+        for(pass = 0; pass < num_passes; pass++)
+        {
+            for(i = 0; i < num_vertices; i++)
+            {
+                int x = xy[i * 2];
+                int y = xy[i * 2 + 1];
+                mtx.transform(&x, &y);
+                out[i * 2]     = x;
+                out[i * 2 + 1] = y;
+            }
+        }
+        t = bench_time_us() - t;
+        if(t < best[0]) best[0] = t;
+
+        t = bench_time_us();
+        for(pass = 0; pass < num_passes; pass++)
+        {
+            for(i = 0; i < num_vertices; i++)
+            {
+                double x = dxy[i * 2];
+                double y = dxy[i * 2 + 1];
+                dout[i * 2]     = agg::poly_coord(x * d_sx  + y * d_shx + d_tx);
+                dout[i * 2 + 1] = agg::poly_coord(x * d_shy + y * d_sy  + d_ty);
+            }
+        }
+        t = bench_time_us() - t;
+        if(t < best[1]) best[1] = t;
+    }
+
+    int max_error = 0;
+    for(i = 0; i < num_vertices * 2; i++)
+    {
+        int e = out[i] - dout[i];
+        if(e < 0) e = -e;
+        if(e > max_error) max_error = e;
+    }
+
+    static const char* const variant_names[] = { "trans_affine", "double" };
+    unsigned v;
+    for(v = 0; v < 2; v++)
+    {
+        double us = (best[v] > 0.0) ? best[v] : 1e-3;
+        double mvert = double(num_vertices) * num_passes / us;
+        printf("%-9s %-24s %8u us %4u%%  %5u.%02u Mvert/s\n",
+               "transform", variant_names[v],
+               unsigned(best[v]),
+               unsigned(best[v] * 100.0 / ((best[0] > 0.0) ? best[0] : 1.0)),
+               unsigned(mvert),
+               unsigned(mvert * 100.0) % 100);
+    }
+    printf("%-9s max difference %d subpixels\n", "transform", max_error);
+
+    delete [] dout;
+    delete [] out;
+    delete [] dxy;
+    delete [] xy;
+    return 0;
+}
+
+
+#ifdef AGG_BENCH_MT
+//----------------------------------------------------------------------------
+// rasterizer::render() against band_renderer with 1, 2, 4 and 8 threads,
+// host only (AGG_BENCH_MT in Makefile.host). A 3840x2160 rgba32 frame of
+// 40 big polygons and 200 ellipses, non-zero. The images must be the
+// same. The speedup is bounded by the number of the CPUs, printed first.
+static unsigned compare_bands(unsigned frames)
+{
+    enum
+    {
+        width        = 3840,
+        height       = 2160,
+        num_variants = 5
+    };
+    static const char* const variant_names[] =
+    {
+        "render", "bands 1 thread", "bands 2 threads", "bands 4 threads", "bands 8 threads"
+    };
+    static const unsigned variant_threads[] = { 0, 1, 2, 4, 8 };
+
+    bench_random rnd(7);
+    bench_scene s;
+    unsigned i;
+    for(i = 0; i < 40; i++)
+    {
+        agg::path_storage poly;
+        int n = rnd.uniform(3, 8);
+        poly.move_to(rnd.uniform(0, width * agg::poly_base_size),
+                     rnd.uniform(0, height * agg::poly_base_size));
+        int j;
+        for(j = 1; j < n; j++)
+        {
+            poly.line_to(rnd.uniform(0, width * agg::poly_base_size),
+                         rnd.uniform(0, height * agg::poly_base_size));
+        }
+        s.add(poly, rnd.color(255, 64));
+    }
+    for(i = 0; i < 200; i++)
+    {
+        agg::ellipse e(rnd.uniform(0, width * agg::poly_base_size),
+                       rnd.uniform(0, height * agg::poly_base_size),
+                       rnd.uniform(20 * agg::poly_base_size, 200 * agg::poly_base_size),
+                       rnd.uniform(20 * agg::poly_base_size, 200 * agg::poly_base_size));
+        s.add(e, rnd.color(255, 64));
+    }
+
+    unsigned char* buf = new unsigned char [width * height * 4];
+    agg::rendering_buffer rbuf(buf, width, height, width * 4);
+    agg::renderer<agg::span_rgba32> ren(rbuf);
+    agg::rasterizer ras;
+    ras.clip_box(0, 0, width, height);
+
+    agg::thread_pool* pools[num_variants];
+    agg::band_renderer* bands[num_variants];
+    unsigned v;
+    for(v = 0; v < num_variants; v++)
+    {
+        pools[v] = 0;
+        bands[v] = 0;
+        if(variant_threads[v])
+        {
+            pools[v] = new agg::thread_pool(variant_threads[v]);
+            bands[v] = new agg::band_renderer(*pools[v]);
+        }
+    }
+
+    {
+        agg::thread_pool online;
+        printf("%-9s %u CPUs online\n", "bands", online.num_threads());
+    }
+
+    double best[num_variants];
+    unsigned sum[num_variants];
+    for(v = 0; v < num_variants; v++)
+    {
+        best[v] = 1e30;
+        sum[v]  = 0;
+    }
+
+    unsigned f;
+    for(f = 0; f < frames; f++)
+    {
+        for(v = 0; v < num_variants; v++)
+        {
+            ren.clear(agg::rgba8(255, 255, 255));
+            double t = bench_time_us();
+            for(i = 0; i < s.path_id.size(); i++)
+            {
+                ras.reset();
+                ras.add_path(s.paths, s.path_id[i]);
+                if(bands[v]) bands[v]->render(ras, ren, s.colors[i]);
+                else         ras.render(ren, s.colors[i]);
+            }
+            t = bench_time_us() - t;
+            if(t < best[v]) best[v] = t;
+            sum[v] = checksum(rbuf, 4, 1);
+        }
+    }
+
+    unsigned failed = 0;
+    for(v = 0; v < num_variants; v++)
+    {
+        bool same = sum[v] == sum[0];
+        failed += !same;
+        printf("%-9s %-24s %8u us %4u%%  %08x %s\n",
+               "bands", variant_names[v],
+               unsigned(best[v]),
+               unsigned(best[v] * 100.0 / ((best[0] > 0.0) ? best[0] : 1.0)),
+               sum[v],
+               same ? "ok" : "DIFFERENT");
+        delete bands[v];
+        delete pools[v];
+    }
+    delete [] buf;
+    return failed;
+}
+#endif
+
+
+//----------------------------------------------------------------------------
+// The shapes of a scenario drawn one by one with the rasterizer, as by
+// the scenarios above, and all at once with compound_rasterizer, which
+// sorts the cells of the frame once and reads and writes every pixel
+// once. The images must be the same. The cells of the lines take about
+// 10 MB with the sorted copy, hence the budget.
+template<class Span>
+static unsigned compare_compound_format(const char* scene_name, 
+                                        const char* format_name,
+                                        unsigned bpp, unsigned word,
+                                        const bench_scene& s, 
+                                        unsigned frames,
+                                        unsigned char* buf)
+{
+    static const char* const variant_names[] = { "separate", "compound" };
+
+    agg::rendering_buffer rbuf(buf, bench_width, bench_height, bench_width * bpp);
+    agg::renderer<Span> ren(rbuf);
+    agg::rasterizer ras;
+    agg::compound_rasterizer cras(16 * 1024 * 1024);
+    ras.clip_box(0, 0, bench_width, bench_height);
+    cras.clip_box(0, 0, bench_width, bench_height);
+
+    double best[2] = { 1e30, 1e30 };
+    unsigned sum[2] = { 0, 0 };
+    unsigned f;
+    for(f = 0; f < frames; f++)
+    {
+        unsigned v;
+        for(v = 0; v < 2; v++)
+        {
+            double t = bench_time_us();
+            if(v == 0)
+            {
+                draw(ren, ras, s);
+            }
+            else
+            {
+                ren.clear(agg::rgba8(255, 255, 255));
+                cras.reset();
+                unsigned i;
+                for(i = 0; i < s.path_id.size(); i++)
+                {
+                    cras.add_path(s.paths, s.path_id[i]);
+                    cras.add(s.colors[i], s.filling_rule);
+                }
+                cras.render(ren);
+            }
+            t = bench_time_us() - t;
+            if(t < best[v]) best[v] = t;
+            sum[v] = checksum(rbuf, bpp, word);
+        }
+    }
+
+    unsigned failed = 0;
+    unsigned v;
+    for(v = 0; v < 2; v++)
+    {
+        bool same = sum[v] == sum[0];
+        failed += !same;
+        printf("%-9s %-8s %-6s %-8s %8u us %4u%%  %08x %s\n",
+               "compound", scene_name, format_name, variant_names[v],
+               unsigned(best[v]),
+               unsigned(best[v] * 100.0 / ((best[0] > 0.0) ? best[0] : 1.0)),
+               sum[v],
+               same ? "ok" : "DIFFERENT");
+    }
+    return failed;
+}
+
+static unsigned compare_compound(unsigned frames)
+{
+    unsigned char* buf = new unsigned char [bench_width * bench_height * 4];
+    unsigned failed = 0;
+    unsigned i;
+    for(i = 0; bench_scenarios[i].name; i++)
+    {
+        bench_scene s;
+        bench_scenarios[i].make(s);
+        if(s.path_id.size() == 0) continue;
+
+        const char* name = bench_scenarios[i].name;
+        failed += compare_compound_format<agg::span_rgb565>(name, "rgb565", 2, 2, s, frames, buf);
+        failed += compare_compound_format<agg::span_bgr24> (name, "bgr24",  3, 1, s, frames, buf);
+        failed += compare_compound_format<agg::span_rgba32>(name, "rgba32", 4, 1, s, frames, buf);
+    }
+    delete [] buf;
+    return failed;
+}
+
+
+//----------------------------------------------------------------------------
+// Copies the paths of the scene with the coordinates shifted right, for
+// the rasterizers with fewer subpixel bits
+static void scale_scene(const bench_scene& src, bench_scene& dst, unsigned shift)
+{
+    agg::path_storage& paths = const_cast<agg::path_storage&>(src.paths);
+    dst.filling_rule = src.filling_rule;
+    unsigned i;
+    for(i = 0; i < src.path_id.size(); i++)
+    {
+        dst.path_id.add(dst.paths.start_new_path());
+        dst.colors.add(src.colors[i]);
+
+        int x = 0;
+        int y = 0;
+        unsigned cmd;
+        paths.rewind(src.path_id[i]);
+        while((cmd = paths.vertex(&x, &y)) != agg::path_cmd_stop)
+        {
+            dst.paths.add_vertex(x >> shift, y >> shift, cmd);
+        }
+    }
+}
+
+
+//----------------------------------------------------------------------------
+// Rasterizes the scene into the null renderer, then draws it into the
+// buffer untimed, for the checksum
+template<class Rasterizer>
+static double time_instance(agg::renderer<agg::span_rgb565>& ren, 
+                            Rasterizer& ras, const bench_scene& s)
+{
+    null_renderer nr;
+    ras.filling_rule(s.filling_rule);
+    double t = bench_time_us();
+    unsigned i;
+    for(i = 0; i < s.path_id.size(); i++)
+    {
+        ras.reset();
+        ras.add_path(s.paths, s.path_id[i]);
+        ras.render(nr, s.colors[i]);
+    }
+    t = bench_time_us() - t;
+    draw(ren, ras, s);
+    return t;
+}
+
+
+//----------------------------------------------------------------------------
+// The configurations of rasterizer_aa compiled into the library: the
+// default 24.8 one with int16 cells, the same with int32 cells and the 
+// 6-bit rasterizer_low. Only the rasterization is timed, into the null
+// renderer; the checksum is of the image drawn in rgb565. The int32 one
+// must give the same image as the default one. The scenes of 
+// rasterizer_low have the coordinates shifted by 2 bits, so its image 
+// is different and its checksum is only printed.
+static unsigned compare_instances(unsigned frames)
+{
+    enum { num_variants = 3 };
+    static const char* const variant_names[] = 
+    { 
+        "int16 8-bit", "int32 8-bit", "int16 6-bit" 
+    };
+
+    unsigned char* buf = new unsigned char [bench_width * bench_height * 2];
+    agg::rendering_buffer rbuf(buf, bench_width, bench_height, bench_width * 2);
+    agg::renderer<agg::span_rgb565> ren(rbuf);
+
+    agg::rasterizer       ras;
+    agg::rasterizer_int32 ras_int32;
+    agg::rasterizer_low   ras_low;
+    ras.clip_box(0, 0, bench_width, bench_height);
+    ras_int32.clip_box(0, 0, bench_width, bench_height);
+    ras_low.clip_box(0, 0, bench_width, bench_height);
+
+    unsigned failed = 0;
+    unsigned sc;
+    for(sc = 1; bench_scenarios[sc].name; sc++)
+    {
+        bench_scene s;
+        bench_scenarios[sc].make(s);
+        bench_scene s_low;
+        scale_scene(s, s_low, agg::poly_base_shift - agg::low_base_shift);
+
+        double best[num_variants];
+        unsigned sum[num_variants];
+        unsigned v;
+        for(v = 0; v < num_variants; v++) best[v] = 1e30;
+
+        unsigned f;
+        for(f = 0; f < frames; f++)
+        {
+            for(v = 0; v < num_variants; v++)
+            {
+                double t;
+                if(v == 0) t = time_instance(ren, ras, s);
+                else
+                if(v == 1) t = time_instance(ren, ras_int32, s);
+                else       t = time_instance(ren, ras_low, s_low);
+                if(t < best[v]) best[v] = t;
+                sum[v] = checksum(rbuf, 2, 2);
+            }
+        }
+
+        for(v = 0; v < num_variants; v++)
+        {
+            bool same = sum[v] == sum[0];
+            if(v < 2) failed += !same;
+            printf("%-9s %-11s %-12s %8u us %4u%%  %08x %s\n",
+                   "instances",
+                   bench_scenarios[sc].name,
+                   variant_names[v],
+                   unsigned(best[v]),
+                   unsigned(best[v] * 100.0 / ((best[0] > 0.0) ? best[0] : 1.0)),
+                   sum[v],
+                   (v == 2) ? "" : same ? "ok" : "DIFFERENT");
+        }
+    }
+    delete [] buf;
+    return failed;
+}
+
+
+//----------------------------------------------------------------------------
+// Draws the lines of compare_lines(), through the stroker and the 
+// rasterizer (polygon = true) or with renderer_line_aa
+template<class Span>
+static void draw_lines(agg::renderer<Span>& ren, 
+                       agg::stroker& st, agg::rasterizer& ras,
+                       bool polygon, int width,
+                       const int* xy, const agg::rgba8* colors, unsigned num)
+{
+    agg::renderer_line_aa<agg::renderer<Span> > lines(ren);
+    lines.width(width);
+    st.width(width);
+
+    unsigned i;
+    for(i = 0; i < num; i++, xy += 4)
+    {
+        if(polygon)
+        {
+            st.remove_all();
+            st.move_to(xy[0], xy[1]);
+            st.line_to(xy[2], xy[3]);
+            ras.reset();
+            ras.add_path(st);
+            ras.render(ren, colors[i]);
+        }
+        else
+        {
+            lines.line(xy[0], xy[1], xy[2], xy[3], colors[i]);
+        }
+    }
+}
+
+
+//----------------------------------------------------------------------------
+// Thin lines: renderer_line_aa against the stroked polygon, both with the
+// default gamma. 2000 lines of up to 40 pixels in random colors, 1 and 2
+// pixels wide, drawn in rgb565. The pixels differ at the butt ends, so 
+// the check is the ink: the lines drawn in black on white in mono8 must
+// have the same total coverage within 5%.
+static unsigned compare_lines(unsigned frames)
+{
+    enum { num_lines = 2000 };
+    static const char* const variant_names[] = { "polygon", "line_aa" };
+
+    bench_random rnd(8);
+    int* xy = new int [num_lines * 4];
+    agg::rgba8* colors = new agg::rgba8 [num_lines];
+    agg::rgba8* black  = new agg::rgba8 [num_lines];
+    unsigned i;
+    for(i = 0; i < num_lines; i++)
+    {
+        xy[i * 4]     = rnd.uniform(0, bench_width  * agg::poly_base_size);
+        xy[i * 4 + 1] = rnd.uniform(0, bench_height * agg::poly_base_size);
+        xy[i * 4 + 2] = xy[i * 4]     + rnd.uniform(-20 * agg::poly_base_size, 20 * agg::poly_base_size);
+        xy[i * 4 + 3] = xy[i * 4 + 1] + rnd.uniform(-20 * agg::poly_base_size, 20 * agg::poly_base_size);
+        colors[i] = rnd.color(255, 255);
+        black[i]  = agg::rgba8(0, 0, 0);
+    }
+
+    unsigned char* buf = new unsigned char [bench_width * bench_height * 2];
+    agg::rendering_buffer rbuf(buf, bench_width, bench_height, bench_width * 2);
+    agg::renderer<agg::span_rgb565> ren(rbuf);
+    agg::rendering_buffer mono_rbuf(buf, bench_width, bench_height, bench_width);
+    agg::renderer<agg::span_mono8> mono(mono_rbuf);
+    agg::stroker st;
+    agg::rasterizer ras;
+    ras.clip_box(0, 0, bench_width, bench_height);
+
+    unsigned failed = 0;
+    unsigned w;
+    for(w = 1; w <= 2; w++)
+    {
+        int width = w * agg::poly_base_size;
+        double best[2] = { 1e30, 1e30 };
+        unsigned sum[2];
+        double ink[2];
+        unsigned v;
+        unsigned f;
+        for(f = 0; f < frames; f++)
+        {
+            for(v = 0; v < 2; v++)
+            {
+                ren.clear(agg::rgba8(255, 255, 255));
+                double t = bench_time_us();
+                draw_lines(ren, st, ras, v == 0, width, xy, colors, num_lines);
+                t = bench_time_us() - t;
+                if(t < best[v]) best[v] = t;
+                sum[v] = checksum(rbuf, 2, 2);
+            }
+        }
+        for(v = 0; v < 2; v++)
+        {
+            mono.clear(agg::rgba8(255, 255, 255));
+            draw_lines(mono, st, ras, v == 0, width, xy, black, num_lines);
+            ink[v] = 0.0;
+            unsigned y;
+            for(y = 0; y < bench_height; y++)
+            {
+                const unsigned char* p = mono_rbuf.row(y);
+                unsigned x;
+                for(x = 0; x < bench_width; x++) ink[v] += 255 - p[x];
+            }
+        }
+
+        for(v = 0; v < 2; v++)
+        {
+            double diff = ink[v] / ((ink[0] > 0.0) ? ink[0] : 1.0);
+            bool same = diff > 0.95 && diff < 1.05;
+            failed += !same;
+            printf("%-9s %u px %-11s %8u us %8u lines/s %4u%%  ink %3u%%  %08x %s\n",
+                   "lines", w,
+                   variant_names[v],
+                   unsigned(best[v]),
+                   unsigned(double(num_lines) * 1e6 / ((best[v] > 0.0) ? best[v] : 1e-3)),
+                   unsigned(best[v] * 100.0 / ((best[0] > 0.0) ? best[0] : 1.0)),
+                   unsigned(diff * 100.0 + 0.5),
+                   sum[v],
+                   same ? "ok" : "DIFFERENT");
+        }
+    }
+    delete [] buf;
+    delete [] black;
+    delete [] colors;
+    delete [] xy;
+    return failed;
+}
+
+
+//----------------------------------------------------------------------------
+static const bench_comparison bench_comparisons[] =
+{
+    { "sort",      compare_sort      },
+    { "sweep",     compare_sweep     },
+    { "replay",    compare_replay    },
+    { "transform", compare_transform },
+    { "compound",  compare_compound  },
+    { "instances", compare_instances },
+    { "lines",     compare_lines     },
+#ifdef AGG_BENCH_MT
+    { "bands",     compare_bands     },
+#endif
+    { 0, 0 }
+};
+
+
+//----------------------------------------------------------------------------
+// Runs the scenarios and the comparisons (all with name = 0) and returns
+// the number of the changed checksums and of the differing variants.
+static unsigned bench_run(unsigned frames, const char* name)
+{
+    if(frames == 0) frames = 1;
+    unsigned char* buf = new unsigned char [bench_width * bench_height * 4];
+
+    printf("%ux%u, %u frames per format\n",
+           unsigned(bench_width), unsigned(bench_height), frames);
+
+    unsigned failed = 0;
+    unsigned i;
+    for(i = 0; bench_scenarios[i].name; i++)
+    {
+        if(name && strcmp(name, bench_scenarios[i].name) != 0) continue;
+        failed += run_formats(bench_scenarios[i], bench_checksums[i], frames, buf);
+    }
+    if(failed) printf("%u checksums have changed\n", failed);
+
+    unsigned differ = 0;
+    for(i = 0; bench_comparisons[i].name; i++)
+    {
+        if(name && strcmp(name, bench_comparisons[i].name) != 0) continue;
+        differ += bench_comparisons[i].run(frames);
+    }
+    if(differ) printf("%u variants differ\n", differ);
+    failed += differ;
+
+    delete [] buf;
+    return failed;
+}
+
+
+#ifdef AGG_BENCH_MAIN
+
+int main(int argc, char** argv)
+{
+    unsigned frames = (argc > 1) ? unsigned(atoi(argv[1])) : 50;
+    const char* name = (argc > 2) ? argv[2] : 0;
+    return bench_run(frames, name) ? 1 : 0;
+}
+
+#else
+
+extern "C" void agg_bench(void);
+void agg_bench(void)
+{
+    bench_run(bench_frames, 0);
+}
+
+#endif
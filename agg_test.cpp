@@ -1,9 +1,10 @@
 #include <stdlib.h>
 #include <stdio.h>
-#include <math.h>
 #include <hw/csr.h>
 #include <hw/flags.h>
 #include "agg.h"
+#include "agg_curves.h"
+#include "agg_stroke.h"
 
 enum
 {
@@ -19,40 +20,35 @@ double random(double min, double max)
 }
 
 
-void draw_ellipse(agg::rasterizer& ras,
+template<class Rasterizer>
+void draw_ellipse(Rasterizer& ras,
                   double x,  double y,
                   double rx, double ry)
 {
-    int i;
-    ras.move_to_d(x + rx, y);
-
-    // Here we have a fixed number of approximation steps, namely 360
-    // while in reality it's supposed to be smarter.
-    for(i = 1; i < 360; i++)
-    {
-        double a = double(i) * 3.1415926 / 180.0;
-        ras.line_to_d(x + cos(a) * rx, y + sin(a) * ry);
-    }
+    // The number of vertices is calculated from the radii, so that
+    // the error doesn't exceed 1/8 of a pixel. They are produced in
+    // fixed point, without cos() and sin().
+    agg::ellipse e(agg::poly_coord(x),  agg::poly_coord(y),
+                   agg::poly_coord(rx), agg::poly_coord(ry));
+    ras.add_path(e);
 }
 
 
-void draw_line(agg::rasterizer& ras,
+template<class Rasterizer>
+void draw_line(Rasterizer& ras,
+               agg::stroker& s,
                double x1, double y1, 
                double x2, double y2,
                double width)
 {
-
-    double dx = x2 - x1;
-    double dy = y2 - y1;
-    double d = sqrt(dx*dx + dy*dy);
-    
-    dx = width * (y2 - y1) / d;
-    dy = width * (x2 - x1) / d;
-
-    ras.move_to_d(x1 - dx,  y1 + dy);
-    ras.line_to_d(x2 - dx,  y2 + dy);
-    ras.line_to_d(x2 + dx,  y2 - dy);
-    ras.line_to_d(x1 + dx,  y1 - dy);
+    // The outline is made by the stroker. More line_to() would make 
+    // a polyline with joins, still one outline to fill with non-zero.
+    // The stroker is reused, remove_all() keeps its memory.
+    s.remove_all();
+    s.width(agg::poly_coord(width * 2.0));
+    s.move_to(agg::poly_coord(x1), agg::poly_coord(y1));
+    s.line_to(agg::poly_coord(x2), agg::poly_coord(y2));
+    ras.add_path(s);
 }
 
 enum {
@@ -170,13 +166,15 @@ void agg_test(void)
     // Create the rendering buffer 
     agg::rendering_buffer rbuf(buf, width, height, width * 4);
 
-    // Create the renderer and the rasterizer
+    // Create the renderer and the rasterizer. All the shapes of the frame 
+    // are collected first and then rendered at once, tile by tile.
     agg::renderer<agg::span_rgb101010> ren(rbuf);
-    agg::rasterizer ras;
+    agg::batch_rasterizer ras;
 
-    // Setup the rasterizer
+    // Setup the rasterizer. The shapes go up to 30 pixels beyond the 
+    // frame, those parts are clipped before they make any cells.
     ras.gamma(1.3);
-    ras.filling_rule(agg::fill_even_odd);
+    ras.clip_box(0, 0, rbuf.width(), rbuf.height());
 
     ren.clear(agg::rgba8(255, 255, 255));
 
@@ -199,11 +197,11 @@ void agg_test(void)
                           random(-30, rbuf.height() + 30));
         }
 
-        // Render
-        ras.render(ren, agg::rgba8(rand() & 0xFF, 
-                                   rand() & 0xFF, 
-                                   rand() & 0xFF, 
-                                   rand() & 0xFF));
+        ras.add(agg::rgba8(rand() & 0xFF, 
+                           rand() & 0xFF, 
+                           rand() & 0xFF, 
+                           rand() & 0xFF),
+                agg::fill_even_odd);
     }
 
     // Draw random ellipses
@@ -214,26 +212,32 @@ void agg_test(void)
                      random(-30, rbuf.height() + 30),
                      random(3, 50), 
                      random(3, 50));
-        ras.render(ren, agg::rgba8(rand() & 0x7F, 
-                                   rand() & 0x7F, 
-                                   rand() & 0x7F,
-                                  (rand() & 0x7F) + 100));
+        ras.add(agg::rgba8(rand() & 0x7F, 
+                           rand() & 0x7F, 
+                           rand() & 0x7F,
+                          (rand() & 0x7F) + 100),
+                agg::fill_even_odd);
     }
 
     // Draw random straight lines
+    agg::stroker stroke;
     for(i = 0; i < 20; i++)
     {
-        draw_line(ras, 
+        draw_line(ras, stroke,
                   random(-30, rbuf.width()  + 30), 
                   random(-30, rbuf.height() + 30),
                   random(-30, rbuf.width()  + 30), 
                   random(-30, rbuf.height() + 30),
                   random(0.1, 10));
 
-        ras.render(ren, agg::rgba8(rand() & 0x7F, 
-                                   rand() & 0x7F, 
-                                   rand() & 0x7F));
+        ras.add(agg::rgba8(rand() & 0x7F, 
+                           rand() & 0x7F, 
+                           rand() & 0x7F),
+                agg::fill_non_zero);
     }
 
+    // Render
+    ras.render(ren);
+
     delete [] buf;
 }
@@ -35,6 +35,7 @@
 
 #include <math.h>
 #include "agg.h"
+#include "agg_path_storage.h"
 
 
 namespace agg
@@ -116,8 +117,8 @@ namespace agg
           m_max_len(0),
           m_dx(0),
           m_dy(0),
-          m_last_x(0x7FFF),
-          m_last_y(0x7FFF),
+          m_last_x(0x7FFFFFF0),
+          m_last_y(0x7FFFFFF0),
           m_covers(0),
           m_start_ptrs(0),
           m_counts(0),
@@ -139,13 +140,13 @@ namespace agg
             delete [] m_covers;
             m_covers     = new unsigned char  [max_len];
             m_start_ptrs = new unsigned char* [max_len];
-            m_counts     = new int16u[max_len];
+            m_counts     = new int [max_len];
             m_max_len    = max_len;
         }
         m_dx            = dx;
         m_dy            = dy;
-        m_last_x        = 0x7FFF;
-        m_last_y        = 0x7FFF;
+        m_last_x        = 0x7FFFFFF0;
+        m_last_y        = 0x7FFFFFF0;
         m_min_x         = min_x;
         m_cur_count     = m_counts;
         m_cur_start_ptr = m_start_ptrs;
@@ -154,18 +155,20 @@ namespace agg
 
 
     //------------------------------------------------------------------------
+    // A run of the same cover is stored as a solid span with a negative
+    // length. The cover is kept in the first byte of the span only.
     void scanline::add_span(int x, int y, unsigned num, unsigned cover)
     {
         x -= m_min_x;
 
-        memset(m_covers + x, cover, num);
-        if(x == m_last_x+1)
+        if(x == m_last_x+1 && *m_cur_count < 0 && **m_cur_start_ptr == cover)
         {
-            (*m_cur_count) += (int16u)num;
+            (*m_cur_count) -= int(num);
         }
         else
         {
-            *++m_cur_count = (int16u)num;
+            m_covers[x] = (unsigned char)cover;
+            *++m_cur_count = -int(num);
             *++m_cur_start_ptr = m_covers + x;
             m_num_spans++;
         }
@@ -178,7 +181,8 @@ namespace agg
     //========================================================================
 
     //------------------------------------------------------------------------
-    const int8u rasterizer::s_default_gamma[] = 
+    template<int Shift, class Coord>
+    const int8u rasterizer_aa<Shift, Coord>::s_default_gamma[] = 
     {
           0,  0,  1,  1,  2,  2,  3,  4,  4,  5,  5,  6,  7,  7,  8,  8,
           9, 10, 10, 11, 11, 12, 13, 13, 14, 14, 15, 16, 16, 17, 18, 18,
@@ -202,72 +206,217 @@ namespace agg
 
 
 
+    //========================================================================
+
+    //------------------------------------------------------------------------
+    cell_arena::~cell_arena()
+    {
+        if(m_buf == 0)
+        {
+            while(m_num_blocks--)
+            {
+                delete [] m_blocks[m_num_blocks];
+            }
+        }
+        delete [] m_scratch;
+        delete [] m_blocks;
+    }
+
+
+    //------------------------------------------------------------------------
+    cell_arena::cell_arena(unsigned budget) :
+        m_buf(0),
+        m_buf_size(0),
+        m_blocks(0),
+        m_num_blocks(0),
+        m_max_blocks(budget / block_size),
+        m_num_used(0),
+        m_budget(budget),
+        m_scratch(0),
+        m_scratch_capacity(0),
+        m_scratch_size(0)
+    {
+    }
+
+
+    //------------------------------------------------------------------------
+    cell_arena::cell_arena(void* buf, unsigned size) :
+        m_buf((int8u*)buf),
+        m_buf_size(size & ~7u),
+        m_blocks(0),
+        m_num_blocks((size & ~7u) / block_size),
+        m_max_blocks((size & ~7u) / block_size),
+        m_num_used(0),
+        m_budget(size & ~7u),
+        m_scratch(0),
+        m_scratch_capacity(0),
+        m_scratch_size(0)
+    {
+    }
+
+
+    //------------------------------------------------------------------------
+    // The blocks are requested in order, so nb is always m_num_used here
+    // unless it's out of the memory. In the buffer the blocks go from the 
+    // start and the scratch area from the end. From the heap, the scratch
+    // area is given up for a block if it's not in use, it's allocated 
+    // again by the next scratch().
+    int8u* cell_arena::allocate_block(unsigned nb)
+    {
+        if(nb >= m_max_blocks) return 0;
+        if(m_buf)
+        {
+            if((nb + 1) * block_size > m_buf_size - m_scratch_size) return 0;
+            m_num_used = nb + 1;
+            return m_buf + nb * block_size;
+        }
+
+        if(nb >= m_num_blocks)
+        {
+            if((nb + 1) * block_size > m_budget - m_scratch_capacity)
+            {
+                if(m_scratch_size) return 0;
+                delete [] m_scratch;
+                m_scratch = 0;
+                m_scratch_capacity = 0;
+            }
+            if(m_blocks == 0)
+            {
+                m_blocks = new int8u* [m_max_blocks];
+            }
+            m_blocks[m_num_blocks++] = new int8u [unsigned(block_size)];
+        }
+        m_num_used = nb + 1;
+        return m_blocks[nb];
+    }
+
+
+    //------------------------------------------------------------------------
+    int8u* cell_arena::scratch(unsigned size)
+    {
+        size = (size + 7) & ~7u;
+        if(m_buf)
+        {
+            if(size > m_buf_size || 
+               m_num_used * block_size > m_buf_size - size) return 0;
+            m_scratch_size = size;
+            return m_buf + m_buf_size - size;
+        }
+
+        if(size > m_scratch_capacity)
+        {
+            unsigned blocks = m_num_blocks * block_size;
+            if(size > m_budget || blocks > m_budget - size) return 0;
+
+            // Half as much again for the next shapes, if the budget allows
+            unsigned capacity = (m_budget - blocks) & ~7u;
+            if(capacity - size > size / 2) capacity = (size + size / 2) & ~7u;
+
+            int8u* s = new int8u [capacity];
+            if(m_scratch_size)
+            {
+                memcpy(s + capacity - m_scratch_size, 
+                       m_scratch + m_scratch_capacity - m_scratch_size, 
+                       m_scratch_size);
+            }
+            delete [] m_scratch;
+            m_scratch = s;
+            m_scratch_capacity = capacity;
+        }
+        m_scratch_size = size;
+        return m_scratch + m_scratch_capacity - size;
+    }
+
+
+    //------------------------------------------------------------------------
+    unsigned cell_arena::allocated_size() const
+    {
+        if(m_buf) return m_buf_size;
+        return m_num_blocks * block_size + m_scratch_capacity;
+    }
+
+
+
+
     //========================================================================
     enum
     {
         not_closed    = 1,
-        sort_required = 2
+        sort_required = 2,
+        cells_closed  = 4
     };
 
     //------------------------------------------------------------------------
-    inline void cell::set_cover(int c, int a)
+    template<int Shift, class Coord>
+    inline void outline_aa<Shift, Coord>::cur_cell::set_cover(int c, int a)
     {
         cover = c;
         area = a;
     }
 
     //------------------------------------------------------------------------
-    inline void cell::add_cover(int c, int a)
+    template<int Shift, class Coord>
+    inline void outline_aa<Shift, Coord>::cur_cell::add_cover(int c, int a)
     {
         cover += c;
         area += a;
     }
 
     //------------------------------------------------------------------------
-    inline void cell::set_coord(int cx, int cy)
+    template<int Shift, class Coord>
+    inline void outline_aa<Shift, Coord>::cur_cell::set(int cx, int cy, int c, int a)
     {
-        x = int16(cx);
-        y = int16(cy);
-        packed_coord = (cy << 16) + cx;
+        x = cx;
+        y = cy;
+        cover = c;
+        area = a;
     }
 
     //------------------------------------------------------------------------
-    inline void cell::set(int cx, int cy, int c, int a)
+    template<int Shift, class Coord>
+    outline_aa<Shift, Coord>::~outline_aa()
     {
-        x = int16(cx);
-        y = int16(cy);
-        packed_coord = (cy << 16) + cx;
-        cover = c;
-        area = a;
     }
 
+
     //------------------------------------------------------------------------
-    outline::~outline()
+    template<int Shift, class Coord>
+    outline_aa<Shift, Coord>::outline_aa() :
+        m_arena(&m_default_arena),
+        m_num_cells(0),
+        m_num_dropped(0),
+        m_cur_cell_ptr(0),
+        m_sorted_cells(0),
+        m_sorted_y(0),
+        m_acc_cells(0),
+        m_acc_width(0),
+        m_acc_threshold(0),
+        m_cur_x(0),
+        m_cur_y(0),
+        m_close_x(0),
+        m_close_y(0),
+        m_min_x(0x7FFFFFFF),
+        m_min_y(0x7FFFFFFF),
+        m_max_x(-0x7FFFFFFF),
+        m_max_y(-0x7FFFFFFF),
+        m_flags(sort_required)
     {
-        delete [] m_sorted_cells;
-        if(m_num_blocks)
-        {
-            cell** ptr = m_cells + m_num_blocks - 1;
-            while(m_num_blocks--)
-            {
-                delete [] *ptr;
-                ptr--;
-            }
-            delete [] m_cells;
-        }
+        m_cur_cell.set(0x7FFF, 0x7FFF, 0, 0);
     }
 
 
     //------------------------------------------------------------------------
-    outline::outline() :
-        m_num_blocks(0),
-        m_max_blocks(0),
-        m_cur_block(0),
+    template<int Shift, class Coord>
+    outline_aa<Shift, Coord>::outline_aa(cell_arena& arena) :
+        m_arena(&arena),
         m_num_cells(0),
-        m_cells(0),
+        m_num_dropped(0),
         m_cur_cell_ptr(0),
         m_sorted_cells(0),
-        m_sorted_size(0),
+        m_sorted_y(0),
+        m_acc_cells(0),
+        m_acc_width(0),
+        m_acc_threshold(0),
         m_cur_x(0),
         m_cur_y(0),
         m_close_x(0),
@@ -283,13 +432,17 @@ namespace agg
 
 
     //------------------------------------------------------------------------
-    void outline::reset()
+    template<int Shift, class Coord>
+    void outline_aa<Shift, Coord>::reset()
     { 
+        m_arena->rewind();
+        m_acc_cells = 0;
         m_num_cells = 0; 
-        m_cur_block = 0;
+        m_num_dropped = 0;
         m_cur_cell.set(0x7FFF, 0x7FFF, 0, 0);
+        m_clipper.reset();
         m_flags |= sort_required;
-        m_flags &= ~not_closed;
+        m_flags &= ~(not_closed | cells_closed);
         m_min_x =  0x7FFFFFFF;
         m_min_y =  0x7FFFFFFF;
         m_max_x = -0x7FFFFFFF;
@@ -299,48 +452,107 @@ namespace agg
 
 
     //------------------------------------------------------------------------
-    void outline::allocate_block()
+    template<int Shift, class Coord>
+    bool outline_aa<Shift, Coord>::allocate_block()
+    {
+        int8u* block = m_arena->block(m_num_cells / cell_block_size);
+        if(block == 0) return false;
+        m_cur_cell_ptr = (cell_type*)block;
+        return true;
+    }
+
+
+    //------------------------------------------------------------------------
+    // When the arena is exhausted every next cell gets here again, 
+    // so that all of them are counted.
+    template<int Shift, class Coord>
+    inline void outline_aa<Shift, Coord>::add_cell(typename cell_type::key_type key, 
+                                                   int cover, int area)
     {
-        if(m_cur_block >= m_num_blocks)
+        if((m_num_cells & cell_block_mask) == 0)
         {
-            if(m_num_blocks >= m_max_blocks)
+            if(!allocate_block())
             {
-                cell** new_cells = new cell* [m_max_blocks + cell_block_pool];
-                if(m_cells)
-                {
-                    memcpy(new_cells, m_cells, m_max_blocks * sizeof(cell*));
-                    delete [] m_cells;
-                }
-                m_cells = new_cells;
-                m_max_blocks += cell_block_pool;
+                m_num_dropped++;
+                AGG_STATS_ADD(dropped_cells, 1);
+                return;
             }
-            m_cells[m_num_blocks++] = new cell [unsigned(cell_block_size)];
         }
-        m_cur_cell_ptr = m_cells[m_cur_block++];
+        AGG_STATS_ADD(cells, 1);
+        m_cur_cell_ptr->set(key, cover, area);
+        m_cur_cell_ptr++;
+        m_num_cells++;
+    }
+
+
+
+    //------------------------------------------------------------------------
+    // The accumulated values don't fit a packed cell. It can happen only 
+    // when many contours pass through the same cell one after another, 
+    // so, it's not worth inlining.
+    template<int Shift, class Coord>
+    void outline_aa<Shift, Coord>::split_cur_cell()
+    {
+        typename cell_type::key_type key = cell_type::make_key(m_cur_cell.x, 
+                                                               m_cur_cell.y);
+        int cover = m_cur_cell.cover;
+        int area  = m_cur_cell.area;
+        int c_max = cell_type::cover_limit >> 1;
+        int a_max = cell_type::area_limit >> 1;
+
+        while(cover | area)
+        {
+            int c = cover;
+            int a = area;
+            if(c >  c_max) c =  c_max;
+            if(c < -c_max) c = -c_max;
+            if(a >  a_max) a =  a_max;
+            if(a < -a_max) a = -a_max;
+            add_cell(key, c, a);
+            cover -= c;
+            area  -= a;
+        }
     }
 
 
     //------------------------------------------------------------------------
-    inline void outline::add_cur_cell()
+    template<int Shift, class Coord>
+    inline void outline_aa<Shift, Coord>::add_cur_cell()
     {
         if(m_cur_cell.area | m_cur_cell.cover)
         {
-            if((m_num_cells & cell_block_mask) == 0)
+            if(m_acc_cells)
+            {
+                acc_cell* acc = m_acc_cells + 
+                                unsigned(m_cur_cell.y - m_min_y) * m_acc_width + 
+                                unsigned(m_cur_cell.x - m_min_x);
+                acc->cover += m_cur_cell.cover;
+                acc->area  += m_cur_cell.area;
+            }
+            else
+            if(unsigned(m_cur_cell.cover + cell_type::cover_limit) < 
+                   unsigned(cell_type::cover_limit * 2) &&
+               unsigned(m_cur_cell.area + cell_type::area_limit) < 
+                   unsigned(cell_type::area_limit * 2))
+            {
+                add_cell(cell_type::make_key(m_cur_cell.x, m_cur_cell.y),
+                         m_cur_cell.cover, 
+                         m_cur_cell.area);
+            }
+            else
             {
-                if(m_num_blocks >= cell_block_limit) return;
-                allocate_block();
+                split_cur_cell();
             }
-            *m_cur_cell_ptr++ = m_cur_cell;
-            m_num_cells++;
         }
     }
 
 
 
     //------------------------------------------------------------------------
-    inline void outline::set_cur_cell(int x, int y)
+    template<int Shift, class Coord>
+    inline void outline_aa<Shift, Coord>::set_cur_cell(int x, int y)
     {
-        if(m_cur_cell.packed_coord != (y << 16) + x)
+        if((m_cur_cell.x ^ x) | (m_cur_cell.y ^ y))
         {
             add_cur_cell();
             m_cur_cell.set(x, y, 0, 0);
@@ -350,12 +562,18 @@ namespace agg
 
 
     //------------------------------------------------------------------------
-    inline void outline::render_scanline(int ey, int x1, int y1, int x2, int y2)
+    // The products here don't exceed subpixel_size^2, so the reciprocal
+    // of the width replaces all the divisions. div is made by the first 
+    // scanline of this width that crosses the cells, see render_line().
+    template<int Shift, class Coord>
+    inline void outline_aa<Shift, Coord>::render_scanline(int ey, int x1, int y1, 
+                                                          int x2, int y2,
+                                                          divider& div)
     {
-        int ex1 = x1 >> poly_base_shift;
-        int ex2 = x2 >> poly_base_shift;
-        int fx1 = x1 & poly_base_mask;
-        int fx2 = x2 & poly_base_mask;
+        int ex1 = x1 >> subpixel_shift;
+        int ex2 = x2 >> subpixel_shift;
+        int fx1 = x1 & subpixel_mask;
+        int fx2 = x2 & subpixel_mask;
 
         int delta, p, first, dx;
         int incr, lift, mod, rem;
@@ -377,8 +595,8 @@ namespace agg
 
         //ok, we'll have to render a run of adjacent cells on the same
         //scanline...
-        p     = (poly_base_size - fx1) * (y2 - y1);
-        first = poly_base_size;
+        p     = (subpixel_size - fx1) * (y2 - y1);
+        first = subpixel_size;
         incr  = 1;
 
         dx = x2 - x1;
@@ -391,14 +609,8 @@ namespace agg
             dx    = -dx;
         }
 
-        delta = p / dx;
-        mod   = p % dx;
-
-        if(mod < 0)
-        {
-            delta--;
-            mod += dx;
-        }
+        if(div.d != dx) div.init(dx);
+        delta = div.div(p, &mod);
 
         m_cur_cell.add_cover(delta, (fx1 + first) * delta);
 
@@ -408,15 +620,8 @@ namespace agg
 
         if(ex1 != ex2)
         {
-            p     = poly_base_size * (y2 - y1 + delta);
-            lift  = p / dx;
-            rem   = p % dx;
-
-            if (rem < 0)
-            {
-                lift--;
-                rem += dx;
-            }
+            p     = subpixel_size * (y2 - y1 + delta);
+            lift  = div.div(p, &rem);
 
             mod -= dx;
 
@@ -430,14 +635,14 @@ namespace agg
                     delta++;
                 }
 
-                m_cur_cell.add_cover(delta, (poly_base_size) * delta);
+                m_cur_cell.add_cover(delta, (subpixel_size) * delta);
                 y1  += delta;
                 ex1 += incr;
                 set_cur_cell(ex1, ey);
             }
         }
         delta = y2 - y1;
-        m_cur_cell.add_cover(delta, (fx2 + poly_base_size - first) * delta);
+        m_cur_cell.add_cover(delta, (fx2 + subpixel_size - first) * delta);
     }
 
 
@@ -446,16 +651,42 @@ namespace agg
 
 
     //------------------------------------------------------------------------
-    void outline::render_line(int x1, int y1, int x2, int y2)
+    // floor(p / d) of the products of render_line(). The 64-bit ones of 
+    // the int32 coordinates are divided for real if they don't fit in int.
+    static inline int floor_div(int p, const divider& d, int* mod)
+    {
+        return d.div(p, mod);
+    }
+
+    static inline int floor_div(int64 p, const divider& d, int* mod)
+    {
+        if(p == int64(int(p))) return d.div(int(p), mod);
+        int q = int(p / d.d);
+        int m = int(p % d.d);
+        if(m < 0)
+        {
+            q--;
+            m += d.d;
+        }
+        *mod = m;
+        return q;
+    }
+
+
+    //------------------------------------------------------------------------
+    template<int Shift, class Coord>
+    void outline_aa<Shift, Coord>::render_line(int x1, int y1, int x2, int y2)
     {
-        int ey1 = y1 >> poly_base_shift;
-        int ey2 = y2 >> poly_base_shift;
-        int fy1 = y1 & poly_base_mask;
-        int fy2 = y2 & poly_base_mask;
+        int ey1 = y1 >> subpixel_shift;
+        int ey2 = y2 >> subpixel_shift;
+        int fy1 = y1 & subpixel_mask;
+        int fy2 = y2 & subpixel_mask;
 
         int dx, dy, x_from, x_to;
-        int p, rem, mod, lift, delta, first, incr;
+        int rem, mod, lift, delta, first, incr;
+        calc_type p;
 
+        AGG_STATS_ADD(edges, 1);
         if(ey1   < m_min_y) m_min_y = ey1;
         if(ey1+1 > m_max_y) m_max_y = ey1+1;
         if(ey2   < m_min_y) m_min_y = ey2;
@@ -467,7 +698,8 @@ namespace agg
         //everything is on a single scanline
         if(ey1 == ey2)
         {
-            render_scanline(ey1, x1, fy1, x2, fy2);
+            divider width;
+            render_scanline(ey1, x1, fy1, x2, fy2, width);
             return;
         }
 
@@ -478,11 +710,11 @@ namespace agg
         incr  = 1;
         if(dx == 0)
         {
-            int ex = x1 >> poly_base_shift;
-            int two_fx = (x1 - (ex << poly_base_shift)) << 1;
+            int ex = x1 >> subpixel_shift;
+            int two_fx = (x1 - (ex << subpixel_shift)) << 1;
             int area;
 
-            first = poly_base_size;
+            first = subpixel_size;
             if(dy < 0)
             {
                 first = 0;
@@ -498,60 +730,52 @@ namespace agg
             ey1 += incr;
             set_cur_cell(ex, ey1);
 
-            delta = first + first - poly_base_size;
+            delta = first + first - subpixel_size;
             area = two_fx * delta;
             while(ey1 != ey2)
             {
-                //render_scanline(ey1, x_from, poly_base_size - first, x_from, first);
+                //render_scanline(ey1, x_from, subpixel_size - first, x_from, first);
                 m_cur_cell.set_cover(delta, area);
                 ey1 += incr;
                 set_cur_cell(ex, ey1);
             }
-            //render_scanline(ey1, x_from, poly_base_size - first, x_from, fy2);
-            delta = fy2 - poly_base_size + first;
+            //render_scanline(ey1, x_from, subpixel_size - first, x_from, fy2);
+            delta = fy2 - subpixel_size + first;
             m_cur_cell.add_cover(delta, two_fx * delta);
             return;
         }
 
         //ok, we have to render several scanlines
-        p     = (poly_base_size - fy1) * dx;
-        first = poly_base_size;
+        p     = (subpixel_size - fy1) * calc_type(dx);
+        first = subpixel_size;
 
         if(dy < 0)
         {
-            p     = fy1 * dx;
+            p     = fy1 * calc_type(dx);
             first = 0;
             incr  = -1;
             dy    = -dy;
         }
 
-        delta = p / dy;
-        mod   = p % dy;
-
-        if(mod < 0)
-        {
-            delta--;
-            mod += dy;
-        }
+        // The reciprocals of the widths of the first and last scanline and
+        // of the interior ones, lift and lift+1 subpixels, made on demand
+        divider div;
+        divider end_width;
+        divider width[2];
+        div.init(dy);
+        delta = floor_div(p, div, &mod);
 
         x_from = x1 + delta;
-        render_scanline(ey1, x1, fy1, x_from, first);
+        render_scanline(ey1, x1, fy1, x_from, first, end_width);
 
         ey1 += incr;
-        set_cur_cell(x_from >> poly_base_shift, ey1);
+        set_cur_cell(x_from >> subpixel_shift, ey1);
 
         if(ey1 != ey2)
         {
-            p     = poly_base_size * dx;
-            lift  = p / dy;
-            rem   = p % dy;
-
-            if(rem < 0)
-            {
-                lift--;
-                rem += dy;
-            }
-            mod -= dy;
+            p     = subpixel_size * calc_type(dx);
+            lift  = floor_div(p, div, &rem);
+            mod  -= dy;
 
             while(ey1 != ey2)
             {
@@ -564,23 +788,65 @@ namespace agg
                 }
 
                 x_to = x_from + delta;
-                render_scanline(ey1, x_from, poly_base_size - first, x_to, first);
+                render_scanline(ey1, x_from, subpixel_size - first, x_to, first,
+                                width[delta - lift]);
                 x_from = x_to;
 
                 ey1 += incr;
-                set_cur_cell(x_from >> poly_base_shift, ey1);
+                set_cur_cell(x_from >> subpixel_shift, ey1);
+            }
+        }
+        render_scanline(ey1, x_from, subpixel_size - first, x2, fy2, end_width);
+    }
+
+
+    //------------------------------------------------------------------------
+    template<int Shift, class Coord>
+    void outline_aa<Shift, Coord>::move_to(int x, int y)
+    {
+        if(m_acc_cells && (m_flags & cells_closed) == 0) store_acc_cells();
+        if(m_clipper.clipping())
+        {
+            if(m_flags & cells_closed) reset();
+            clipped_sink sink(this);
+            m_clipper.move_to(sink, x, y);
+        }
+        else
+        {
+            move_to_clipped(x, y);
+        }
+    }
+
+
+
+    //------------------------------------------------------------------------
+    template<int Shift, class Coord>
+    void outline_aa<Shift, Coord>::line_to(int x, int y)
+    {
+        if(m_acc_cells && (m_flags & cells_closed) == 0) store_acc_cells();
+        if(m_clipper.clipping())
+        {
+            if((m_flags & cells_closed) == 0)
+            {
+                clipped_sink sink(this);
+                m_clipper.line_to(sink, x, y);
             }
         }
-        render_scanline(ey1, x_from, poly_base_size - first, x2, fy2);
+        else
+        {
+            line_to_clipped(x, y);
+        }
     }
 
 
+
     //------------------------------------------------------------------------
-    void outline::move_to(int x, int y)
+    template<int Shift, class Coord>
+    void outline_aa<Shift, Coord>::move_to_clipped(int x, int y)
     {
-        if((m_flags & sort_required) == 0) reset();
-        if(m_flags & not_closed) line_to(m_close_x, m_close_y);
-        set_cur_cell(x >> poly_base_shift, y >> poly_base_shift);
+        if(m_flags & cells_closed) reset();
+        if(m_flags & not_closed) line_to_clipped(m_close_x, m_close_y);
+        set_cur_cell(x >> subpixel_shift, y >> subpixel_shift);
         m_close_x = m_cur_x = x;
         m_close_y = m_cur_y = y;
     }
@@ -588,18 +854,19 @@ namespace agg
 
 
     //------------------------------------------------------------------------
-    void outline::line_to(int x, int y)
+    template<int Shift, class Coord>
+    void outline_aa<Shift, Coord>::line_to_clipped(int x, int y)
     {
-        if((m_flags & sort_required) && ((m_cur_x ^ x) | (m_cur_y ^ y)))
+        if((m_flags & cells_closed) == 0 && ((m_cur_x ^ x) | (m_cur_y ^ y)))
         {
             int c;
 
-            c = m_cur_x >> poly_base_shift;
+            c = m_cur_x >> subpixel_shift;
             if(c < m_min_x) m_min_x = c;
             ++c;
             if(c > m_max_x) m_max_x = c;
 
-            c = x >> poly_base_shift;
+            c = x >> subpixel_shift;
             if(c < m_min_x) m_min_x = c;
             ++c;
             if(c > m_max_x) m_max_x = c;
@@ -612,281 +879,1382 @@ namespace agg
     }
 
 
-    enum
+
+    //------------------------------------------------------------------------
+    // Returns true if the vertices within the box can go straight to the
+    // cells. The box is the bounding box of the cells then, unless it's a
+    // point, which has no edges at all. The caller starts the contours 
+    // with move_to_clipped() and sets not_closed, as line_to_clipped() 
+    // would.
+    template<int Shift, class Coord>
+    bool outline_aa<Shift, Coord>::begin_bulk(int x1, int y1, int x2, int y2)
     {
-        qsort_threshold = 9
-    };
+        if(m_flags & cells_closed) reset();
+        if(m_clipper.clipping())
+        {
+            if(!m_clipper.inside(x1, y1, x2, y2)) return false;
+            clipped_sink sink(this);
+            m_clipper.close_polygon(sink);
+        }
+        if(x1 != x2 || y1 != y2)
+        {
+            if(m_acc_cells)
+            {
+                if((x1 >> subpixel_shift) < m_min_x || 
+                   (x2 >> subpixel_shift) + 1 > m_max_x ||
+                   (y1 >> subpixel_shift) < m_min_y || 
+                   (y2 >> subpixel_shift) + 1 > m_max_y) store_acc_cells();
+            }
+            else
+            if(m_acc_threshold && m_num_cells == 0 && m_min_y > m_max_y &&
+               (m_flags & not_closed) == 0)
+            {
+                begin_acc(x1, y1, x2, y2);
+            }
+            if((x1 >> subpixel_shift)     < m_min_x) m_min_x = x1 >> subpixel_shift;
+            if((x2 >> subpixel_shift) + 1 > m_max_x) m_max_x = (x2 >> subpixel_shift) + 1;
+        }
+        return true;
+    }
+
 
 
     //------------------------------------------------------------------------
-    template <class T> static inline void swap_cells(T* a, T* b)
+    // The first shape of the outline within the threshold is accumulated
+    // in a dense buffer of the bounding box of its vertices, which is then
+    // the bounding box of the outline.
+    template<int Shift, class Coord>
+    void outline_aa<Shift, Coord>::begin_acc(int x1, int y1, int x2, int y2)
     {
-        T temp = *a;
-        *a = *b;
-        *b = temp;
+        int ex1 = x1 >> subpixel_shift;
+        int ey1 = y1 >> subpixel_shift;
+        unsigned width  = unsigned((x2 >> subpixel_shift) - ex1 + 2);
+        unsigned height = unsigned((y2 >> subpixel_shift) - ey1 + 2);
+        if(width > m_acc_threshold / height) return;
+
+        acc_cell* acc = (acc_cell*)m_arena->scratch(width * height * sizeof(acc_cell));
+        if(acc == 0) return;
+        memset(acc, 0, width * height * sizeof(acc_cell));
+
+        m_acc_cells = acc;
+        m_acc_width = width;
+        m_min_x = ex1;
+        m_min_y = ey1;
+        m_max_x = ex1 + int(width) - 1;
+        m_max_y = ey1 + int(height) - 1;
     }
 
+
+
     //------------------------------------------------------------------------
-    template <class T> static inline bool less_than(T* a, T* b)
+    // The accumulated cells are stored in the blocks in the order of the
+    // buffer. The current cell isn't in the buffer yet, it stays current.
+    template<int Shift, class Coord>
+    void outline_aa<Shift, Coord>::store_acc_cells()
     {
-        return (*a)->packed_coord < (*b)->packed_coord;
+        const acc_cell* acc = m_acc_cells;
+        m_acc_cells = 0;
+
+        cur_cell cur = m_cur_cell;
+        int x, y;
+        for(y = m_min_y; y <= m_max_y; y++)
+        {
+            for(x = m_min_x; x <= m_max_x; x++, acc++)
+            {
+                if(acc->cover | acc->area)
+                {
+                    m_cur_cell.set(x, y, acc->cover, acc->area);
+                    add_cur_cell();
+                }
+            }
+        }
+        m_cur_cell = cur;
     }
 
 
 
     //------------------------------------------------------------------------
-    void outline::qsort_cells(cell** start, unsigned num)
+    template<int Shift, class Coord>
+    void outline_aa<Shift, Coord>::end_bulk()
     {
-        cell**  stack[80];
-        cell*** top; 
-        cell**  limit;
-        cell**  base;
+        if(m_clipper.clipping())
+        {
+            m_clipper.resume(m_close_x, m_close_y, m_cur_x, m_cur_y);
+        }
+    }
 
-        limit = start + num;
-        base  = start;
-        top   = stack;
 
-        for (;;)
-        {
-            int len = int(limit - base);
 
-            cell** i;
-            cell** j;
-            cell** pivot;
+    //------------------------------------------------------------------------
+    // The vertices are outside the clip box, so the only thing that
+    // matters is the last contour that may be continued by line_to().
+    // The clipper turns all its edges into the border ones, the sum of
+    // which is the edge from the start to the last vertex.
+    template<int Shift, class Coord>
+    void outline_aa<Shift, Coord>::skip_bulk(int start_x, int start_y,
+                                             int x, int y)
+    {
+        if(m_flags & cells_closed) reset();
+        if(m_acc_cells) store_acc_cells();
+        clipped_sink sink(this);
+        m_clipper.move_to(sink, start_x, start_y);
+        m_clipper.line_to(sink, x, y);
+    }
 
-            if(len > qsort_threshold)
-            {
-                // we use base + len/2 as the pivot
-                pivot = base + len / 2;
-                swap_cells(base, pivot);
 
-                i = base + 1;
-                j = limit - 1;
 
-                // now ensure that *i <= *base <= *j 
-                if(less_than(j, i))
-                {
-                    swap_cells(i, j);
-                }
+    //------------------------------------------------------------------------
+    template<int Shift, class Coord>
+    void outline_aa<Shift, Coord>::add_poly(const int* xy, unsigned n,
+                                            bool closed)
+    {
+        if(n == 0) return;
 
-                if(less_than(base, i))
-                {
-                    swap_cells(base, i);
-                }
+        int x1 = xy[0];
+        int y1 = xy[1];
+        int x2 = x1;
+        int y2 = y1;
+        const int* p = xy + 2;
+        unsigned i;
+        for(i = 1; i < n; i++, p += 2)
+        {
+            if(p[0] < x1) x1 = p[0];
+            if(p[0] > x2) x2 = p[0];
+            if(p[1] < y1) y1 = p[1];
+            if(p[1] > y2) y2 = p[1];
+        }
 
-                if(less_than(j, base))
+        if(begin_bulk(x1, y1, x2, y2))
+        {
+            move_to_clipped(xy[0], xy[1]);
+            m_flags |= not_closed;
+            int x = xy[0];
+            int y = xy[1];
+            for(i = 1, p = xy + 2; i < n; i++, p += 2)
+            {
+                if((x ^ p[0]) | (y ^ p[1]))
                 {
-                    swap_cells(base, j);
+                    render_line(x, y, p[0], p[1]);
+                    x = p[0];
+                    y = p[1];
                 }
+            }
+            if(closed && ((x ^ xy[0]) | (y ^ xy[1])))
+            {
+                render_line(x, y, xy[0], xy[1]);
+                x = xy[0];
+                y = xy[1];
+            }
+            m_cur_x = x;
+            m_cur_y = y;
+            end_bulk();
+            return;
+        }
 
-                for(;;)
-                {
-                    do i++; while( less_than(i, base) );
-                    do j--; while( less_than(base, j) );
+        if(m_clipper.outside(x1, y1, x2, y2))
+        {
+            p = closed ? xy : xy + (n - 1) * 2;
+            skip_bulk(xy[0], xy[1], p[0], p[1]);
+            return;
+        }
 
-                    if ( i > j )
-                    {
-                        break;
-                    }
+        move_to(xy[0], xy[1]);
+        for(i = 1, p = xy + 2; i < n; i++, p += 2)
+        {
+            line_to(p[0], p[1]);
+        }
+        if(closed) line_to(xy[0], xy[1]);
+    }
 
-                    swap_cells(i, j);
-                }
 
-                swap_cells(base, j);
 
-                // now, push the largest sub-array
-                if(j - base > limit - i)
+    //------------------------------------------------------------------------
+    // Two passes over the blocks of the path, the first one finds its end
+    // and its bounding box, the second one renders the edges.
+    template<int Shift, class Coord>
+    void outline_aa<Shift, Coord>::add_path(const path_storage& ps,
+                                            unsigned path_id)
+    {
+        unsigned total = ps.total_vertices();
+        if(path_id >= total) return;
+
+        int x1 =  0x7FFFFFFF;
+        int y1 =  0x7FFFFFFF;
+        int x2 = -0x7FFFFFFF;
+        int y2 = -0x7FFFFFFF;
+        int start_x = 0;
+        int start_y = 0;
+        int x = 0;
+        int y = 0;
+        unsigned end = path_id;
+        bool stop = false;
+        while(end < total && !stop)
+        {
+            unsigned k = end & path_storage::block_mask;
+            unsigned n = path_storage::block_size - k;
+            if(n > total - end) n = total - end;
+            const int*   xy  = ps.block_coords(end >> path_storage::block_shift) + k * 2;
+            const int8u* cmd = ps.block_cmds(end >> path_storage::block_shift) + k;
+            for(; n; --n, ++cmd, xy += 2, ++end)
+            {
+                unsigned c = *cmd;
+                if(c == path_cmd_stop) { stop = true; break; }
+                if(c == path_cmd_move_to)
                 {
-                    top[0] = base;
-                    top[1] = j;
-                    base   = i;
+                    start_x = xy[0];
+                    start_y = xy[1];
                 }
                 else
-                {
-                    top[0] = i;
-                    top[1] = limit;
-                    limit  = j;
-                }
-                top += 2;
+                if(c != path_cmd_line_to) continue;
+                x = xy[0];
+                y = xy[1];
+                if(x < x1) x1 = x;
+                if(x > x2) x2 = x;
+                if(y < y1) y1 = y;
+                if(y > y2) y2 = y;
             }
-            else
+        }
+
+        // The bulk needs the path to start with move_to(), because the
+        // clipper ignores line_to() without a contour.
+        unsigned i;
+        bool bulk = x1 <= x2 && ps.command(path_id) == path_cmd_move_to;
+        if(!bulk || !begin_bulk(x1, y1, x2, y2))
+        {
+            if(bulk && m_clipper.outside(x1, y1, x2, y2))
             {
-                // the sub-array is small, perform insertion sort
-                j = base;
-                i = j + 1;
+                skip_bulk(start_x, start_y, x, y);
+                return;
+            }
+            for(i = path_id; i < end; i++)
+            {
+                unsigned c = ps.vertex(i, &x, &y);
+                if(c == path_cmd_move_to) move_to(x, y);
+                else
+                if(c == path_cmd_line_to) line_to(x, y);
+            }
+            return;
+        }
 
-                for(; i < limit; j = i, i++)
+        i = path_id;
+        x = m_cur_x;
+        y = m_cur_y;
+        while(i < end)
+        {
+            unsigned k = i & path_storage::block_mask;
+            unsigned n = path_storage::block_size - k;
+            if(n > end - i) n = end - i;
+            const int*   xy  = ps.block_coords(i >> path_storage::block_shift) + k * 2;
+            const int8u* cmd = ps.block_cmds(i >> path_storage::block_shift) + k;
+            i += n;
+            for(; n; --n, ++cmd, xy += 2)
+            {
+                if(*cmd == path_cmd_line_to)
                 {
-                    for(; less_than(j + 1, j); j--)
+                    if((x ^ xy[0]) | (y ^ xy[1]))
                     {
-                        swap_cells(j + 1, j);
-                        if (j == base)
-                        {
-                            break;
-                        }
+                        render_line(x, y, xy[0], xy[1]);
+                        x = xy[0];
+                        y = xy[1];
                     }
                 }
-                if(top > stack)
-                {
-                    top  -= 2;
-                    base  = top[0];
-                    limit = top[1];
-                }
                 else
+                if(*cmd == path_cmd_move_to)
                 {
-                    break;
+                    m_cur_x = x;
+                    m_cur_y = y;
+                    move_to_clipped(xy[0], xy[1]);
+                    m_flags |= not_closed;
+                    x = xy[0];
+                    y = xy[1];
                 }
             }
         }
+        m_cur_x = x;
+        m_cur_y = y;
+        end_bulk();
     }
 
 
-
+    enum
+    {
+        insertion_sort_threshold = 12
+    };
 
 
     //------------------------------------------------------------------------
-    void outline::sort_cells()
+    template<class Cell> 
+    static inline void insertion_sort_cells(Cell* start, unsigned num)
     {
-        if(m_num_cells == 0) return;
-        if(m_num_cells > m_sorted_size)
+        Cell* limit = start + num;
+        Cell* i;
+        Cell* j;
+
+        for(i = start + 1; i < limit; i++)
         {
-            delete [] m_sorted_cells;
-            m_sorted_size = m_num_cells;
-            m_sorted_cells = new cell* [m_num_cells + 1];
+            Cell c = *i;
+            for(j = i; j > start && j[-1].key > c.key; j--)
+            {
+                *j = j[-1];
+            }
+            *j = c;
+            // The moves plus the last comparison, if it was made
+            AGG_STATS_ADD(sort_compares, unsigned(i - j) + (j > start));
         }
+    }
 
-        cell** sorted_ptr = m_sorted_cells;
-        cell** block_ptr = m_cells;
-        cell*  cell_ptr;
 
-        unsigned nb = m_num_cells >> cell_block_shift;
+    //------------------------------------------------------------------------
+    // LSD radix sort of the cells of one scanline by X, 8 bits per pass.
+    // The keys are the offsets from the left edge of the bounding box,
+    // so that shapes narrower than 256 cells are sorted in one pass.
+    template<class Cell> 
+    static void radix_sort_cells(Cell* start, unsigned num, Cell* tmp, 
+                                 int min_x, unsigned passes)
+    {
+        unsigned count[256];
+        Cell*    src = start;
+        Cell*    dst = tmp;
+        unsigned shift = 0;
         unsigned i;
 
-        while(nb--)
+        while(passes--)
         {
-            cell_ptr = *block_ptr++;
-            i = cell_block_size;
-            while(i--) 
+            memset(count, 0, sizeof(count));
+            for(i = 0; i < num; i++)
+            {
+                count[(unsigned(src[i].x() - min_x) >> shift) & 0xFF]++;
+            }
+
+            unsigned sum = 0;
+            for(i = 0; i < 256; i++)
+            {
+                unsigned c = count[i];
+                count[i] = sum;
+                sum += c;
+            }
+
+            for(i = 0; i < num; i++)
             {
-                *sorted_ptr++ = cell_ptr++;
+                const Cell& c = src[i];
+                dst[count[(unsigned(c.x() - min_x) >> shift) & 0xFF]++] = c;
             }
+
+            Cell* t = src;
+            src = dst;
+            dst = t;
+            shift += 8;
         }
 
-        cell_ptr = *block_ptr++;
-        i = m_num_cells & cell_block_mask;
-        while(i--) 
+        if(src != start)
         {
-            *sorted_ptr++ = cell_ptr++;
+            memcpy(start, src, num * sizeof(Cell));
         }
-        m_sorted_cells[m_num_cells] = 0;
-        qsort_cells(m_sorted_cells, m_num_cells);
     }
 
 
-
-
     //------------------------------------------------------------------------
-    const cell* const* outline::cells()
+    // The sorted cells don't fit the arena. They're dropped all together,
+    // the same as the ones that don't fit the blocks.
+    template<int Shift, class Coord>
+    void outline_aa<Shift, Coord>::drop_cells()
     {
+        m_num_dropped += m_num_cells;
+        AGG_STATS_ADD(dropped_cells, m_num_cells);
+        m_num_cells = 0;
+    }
+
+
+    //------------------------------------------------------------------------
+    // The cells are sorted in two steps. First, they are distributed into
+    // scanline buckets with a counting sort by Y - the range of Y is known
+    // from the bounding box. Then each scanline is sorted by X, by insertion
+    // for short ones and by radix sort for long ones. It's O(n) in general 
+    // and it never compares cells of different scanlines. The cells are 
+    // moved themselves, so that the sweep reads them sequentially.
+    template<int Shift, class Coord>
+    void outline_aa<Shift, Coord>::sort_cells()
+    {
+        if(m_num_cells == 0) return;
+
+        // The scanlines are at the end of the scratch area, so that they
+        // stay in place when it grows for the cells below
+        unsigned num_rows = unsigned(m_max_y - m_min_y + 1);
+        unsigned rows_size = num_rows * sizeof(sorted_y);
+        m_sorted_y = (sorted_y*)m_arena->scratch(rows_size);
+        if(m_sorted_y == 0)
+        {
+            drop_cells();
+            return;
+        }
+        memset(m_sorted_y, 0, num_rows * sizeof(sorted_y));
+
+        cell_type* cell_ptr = 0;
+        unsigned i;
+
+        // Build the Y-histogram
+        for(i = 0; i < m_num_cells; i++)
+        {
+            if((i & cell_block_mask) == 0) 
+            {
+                cell_ptr = (cell_type*)m_arena->block(i / cell_block_size);
+            }
+            m_sorted_y[cell_ptr->y() - m_min_y].start++;
+            cell_ptr++;
+        }
+
+        // Convert the histogram into the starting indexes
+        unsigned start = 0;
+        unsigned max_num = 0;
+        for(i = 0; i < num_rows; i++)
+        {
+            unsigned v = m_sorted_y[i].start;
+            m_sorted_y[i].start = start;
+            start += v;
+            if(v > max_num) max_num = v;
+        }
+
+        // The memory of the radix sort, the sorted cells and the scanlines
+        unsigned radix_size = 0;
+        if(max_num > insertion_sort_threshold) 
+        {
+            radix_size = (max_num * sizeof(cell_type) + 7) & ~7u;
+        }
+        unsigned cells_size = (m_num_cells * sizeof(cell_type) + 7) & ~7u;
+        cell_type* radix_cells = 0;
+        if(m_num_cells <= (0xFFFFFFFFu - rows_size - radix_size) / sizeof(cell_type))
+        {
+            radix_cells = (cell_type*)m_arena->scratch(radix_size + 
+                                                       cells_size + 
+                                                       rows_size);
+        }
+        if(radix_cells == 0)
+        {
+            drop_cells();
+            return;
+        }
+        m_sorted_cells = (cell_type*)((int8u*)radix_cells + radix_size);
+        m_sorted_y = (sorted_y*)((int8u*)m_sorted_cells + cells_size);
+
+        // Distribute the cells into the scanlines
+        for(i = 0; i < m_num_cells; i++)
+        {
+            if((i & cell_block_mask) == 0) 
+            {
+                cell_ptr = (cell_type*)m_arena->block(i / cell_block_size);
+            }
+            sorted_y& cur_y = m_sorted_y[cell_ptr->y() - m_min_y];
+            m_sorted_cells[cur_y.start + cur_y.num++] = *cell_ptr;
+            cell_ptr++;
+        }
+
+        // Sort each scanline by X
+        unsigned passes = 1;
+        while(passes < 4 && unsigned(m_max_x - m_min_x) >> (passes * 8))
+        {
+            passes++;
+        }
+        AGG_STATS_ADD(sorted_cells, m_num_cells);
+        for(i = 0; i < num_rows; i++)
+        {
+            const sorted_y& cur_y = m_sorted_y[i];
+            if(cur_y.num > insertion_sort_threshold)
+            {
+                AGG_STATS_ADD(radix_passes, passes);
+                radix_sort_cells(m_sorted_cells + cur_y.start, 
+                                 cur_y.num, 
+                                 radix_cells, 
+                                 m_min_x, 
+                                 passes);
+            }
+            else
+            if(cur_y.num > 1)
+            {
+                insertion_sort_cells(m_sorted_cells + cur_y.start, cur_y.num);
+            }
+        }
+    }
+
+
+
+
+    //------------------------------------------------------------------------
+    // The same as close_cells(), but the outline stays open for the next
+    // shape. The current cell is replaced by the empty one, so that the 
+    // first cell of the next shape starts anew.
+    template<int Shift, class Coord>
+    void outline_aa<Shift, Coord>::close_shape()
+    {
+        if(m_flags & cells_closed) return;
+        if(m_acc_cells) store_acc_cells();
+        if(m_clipper.clipping())
+        {
+            clipped_sink sink(this);
+            m_clipper.close_polygon(sink);
+        }
         if(m_flags & not_closed)
         {
-            line_to(m_close_x, m_close_y);
+            line_to_clipped(m_close_x, m_close_y);
             m_flags &= ~not_closed;
         }
+        add_cur_cell();
+        m_cur_cell.set(0x7FFF, 0x7FFF, 0, 0);
+        m_flags |= sort_required;
+    }
+
+
+
+    //------------------------------------------------------------------------
+    template<int Shift, class Coord>
+    void outline_aa<Shift, Coord>::close_cells()
+    {
+        if(m_clipper.clipping() && (m_flags & cells_closed) == 0)
+        {
+            clipped_sink sink(this);
+            m_clipper.close_polygon(sink);
+        }
+        if(m_flags & not_closed)
+        {
+            line_to_clipped(m_close_x, m_close_y);
+            m_flags &= ~not_closed;
+        }
+        if((m_flags & cells_closed) == 0)
+        {
+            add_cur_cell();
+            m_flags |= cells_closed;
+        }
+    }
+
+
+
+    //------------------------------------------------------------------------
+    template<int Shift, class Coord>
+    const typename outline_aa<Shift, Coord>::cell_type* 
+    outline_aa<Shift, Coord>::cells()
+    {
+        close_cells();
+        if(m_acc_cells) store_acc_cells();
+        if(m_num_cells == 0) return 0;
 
         //Perform sort only the first time.
         if(m_flags & sort_required)
         {
-            add_cur_cell();
-            if(m_num_cells == 0) return 0;
+            AGG_STATS_TIMER_START(t);
             sort_cells();
             m_flags &= ~sort_required;
+            AGG_STATS_TIMER_STOP(t, sort_cycles);
+        }
+        return m_num_cells ? m_sorted_cells : 0;
+    }
+
+
+
+    //------------------------------------------------------------------------
+    template<int Shift, class Coord>
+    const typename outline_aa<Shift, Coord>::cell_type* 
+    outline_aa<Shift, Coord>::block_cells(unsigned nb, unsigned* num) const
+    {
+        *num = cell_block_size;
+        if(nb == m_num_cells / cell_block_size)
+        {
+            *num = m_num_cells & cell_block_mask;
+        }
+        return (const cell_type*)m_arena->block(nb);
+    }
+
+
+
+    //------------------------------------------------------------------------
+    template<int Shift, class Coord>
+    const typename outline_aa<Shift, Coord>::acc_cell* 
+    outline_aa<Shift, Coord>::accumulate_cells()
+    {
+        close_cells();
+        if(m_acc_cells) return m_acc_cells;
+        if(m_num_cells == 0) return 0;
+
+        unsigned width = unsigned(m_max_x - m_min_x + 1);
+        unsigned height = unsigned(m_max_y - m_min_y + 1);
+        if(width > 0xFFFFFFFFu / sizeof(acc_cell) / height) return 0;
+
+        unsigned size = width * height;
+        acc_cell* acc_cells = (acc_cell*)m_arena->scratch(size * sizeof(acc_cell));
+        if(acc_cells == 0) return 0;
+        m_flags |= sort_required;
+        memset(acc_cells, 0, size * sizeof(acc_cell));
+
+        unsigned nb;
+        for(nb = 0; nb < num_blocks(); nb++)
+        {
+            unsigned num;
+            const cell_type* cur_cell = block_cells(nb, &num);
+            while(num--)
+            {
+                acc_cell* acc = acc_cells + 
+                                unsigned(cur_cell->y() - m_min_y) * width + 
+                                unsigned(cur_cell->x() - m_min_x);
+                acc->cover += cur_cell->cover();
+                acc->area  += cur_cell->area();
+                ++cur_cell;
+            }
         }
-        return m_sorted_cells;
+        return acc_cells;
     }
 
 
 
     //------------------------------------------------------------------------
-    void rasterizer::gamma(double g)
+    template<int Shift, class Coord>
+    void rasterizer_aa<Shift, Coord>::gamma(double g)
     {
         unsigned i;
         for(i = 0; i < 256; i++)
         {
             m_gamma[i] = (unsigned char)(pow(double(i) / 255.0, g) * 255.0);
         }
+        build_alpha();
     }
 
 
     //------------------------------------------------------------------------
-    void rasterizer::gamma(const int8u* g)
+    template<int Shift, class Coord>
+    void rasterizer_aa<Shift, Coord>::gamma(const int8u* g)
     {
         memcpy(m_gamma, g, sizeof(m_gamma));
+        build_alpha();
     }
 
 
     //------------------------------------------------------------------------
-    bool rasterizer::hit_test(int tx, int ty)
+    // Index i of the table is the scaled area modulo aa_2num. The coverage
+    // is the distance to the nearest multiple of aa_2num, clamped and 
+    // passed through the gamma, which is also the even-odd rule. For the 
+    // non-zero rule it's the same while the area doesn't exceed aa_num.
+    template<int Shift, class Coord>
+    void rasterizer_aa<Shift, Coord>::build_alpha()
     {
-        const cell* const* cells = m_outline.cells();
-        if(m_outline.num_cells() == 0) return false;
+        unsigned i;
+        m_linear_gamma = true;
+        for(i = 0; i < 256; i++)
+        {
+            if(m_gamma[i] != i) m_linear_gamma = false;
+        }
+        for(i = 0; i < aa_2num; i++)
+        {
+            unsigned cover = (i > aa_num) ? aa_2num - i : i;
+            if(cover > aa_mask) cover = aa_mask;
+            m_alpha[i] = m_gamma[cover];
+        }
+    }
 
-        int x, y;
+
+    //------------------------------------------------------------------------
+    // Sweeps the cells of row ty up to tx. The cover is accumulated from the
+    // left, so the cells before tx are still visited, but no other row is.
+    template<int Shift, class Coord>
+    bool rasterizer_aa<Shift, Coord>::hit_test_row(int tx, int ty) const
+    {
+        if(tx < m_outline.min_x() || tx > m_outline.max_x() ||
+           ty < m_outline.min_y() || ty > m_outline.max_y()) return false;
+
+        unsigned num_cells = m_outline.scanline_num_cells(ty);
+        if(num_cells == 0) return false;
+
+        const cell_type* cur_cell = m_outline.scanline_cells(ty);
+        const cell_type* end_cell = cur_cell + num_cells;
+        int x;
         int cover;
-        int alpha;
         int area;
 
+        if(cur_cell->x() > tx) return false;
+
         cover = 0;
-        const cell* cur_cell = *cells++;
         for(;;)
         {
-            const cell* start_cell = cur_cell;
+            typename cell_type::key_type key = cur_cell->key;
+            x = cur_cell->x();
+
+            area   = cur_cell->area();
+            cover += cur_cell->cover();
+
+            while(++cur_cell != end_cell)
+            {
+                if(cur_cell->key != key) break;
+                area  += cur_cell->area();
+                cover += cur_cell->cover();
+            }
+
+            if(area)
+            {
+                if(x == tx) 
+                {
+                    return calculate_alpha((cover << (subpixel_shift + 1)) - area) != 0;
+                }
+                x++;
+            }
+
+            if(cur_cell == end_cell) return false;
+
+            // The span [x...next cell) has the same cover
+            if(tx < cur_cell->x())
+            {
+                return calculate_alpha(cover << (subpixel_shift + 1)) != 0;
+            }
+        }
+    }
+
+
+    //------------------------------------------------------------------------
+    template<int Shift, class Coord>
+    bool rasterizer_aa<Shift, Coord>::hit_test(int tx, int ty)
+    {
+        if(!sort()) return false;
+        return hit_test_row(tx, ty);
+    }
+
+
+    //------------------------------------------------------------------------
+    template<int Shift, class Coord>
+    unsigned rasterizer_aa<Shift, Coord>::hit_test(const int* x, 
+                                                   const int* y, 
+                                                   unsigned num, 
+                                                   int8u* hits)
+    {
+        unsigned i;
+        if(!sort())
+        {
+            for(i = 0; i < num; i++) hits[i] = 0;
+            return 0;
+        }
+
+        unsigned num_hits = 0;
+        for(i = 0; i < num; i++)
+        {
+            hits[i] = hit_test_row(x[i], y[i]);
+            num_hits += hits[i];
+        }
+        return num_hits;
+    }
+
+
+
+    //------------------------------------------------------------------------
+    // The configurations compiled into the library, see the typedefs in 
+    // agg.h. Any other one needs its lines here.
+    template class outline_aa<poly_base_shift, int16>;
+    template class outline_aa<poly_base_shift, int32>;
+    template class rasterizer_aa<poly_base_shift, int16>;
+    template class rasterizer_aa<poly_base_shift, int32>;
+    template class outline_aa<low_base_shift, int16>;
+    template class rasterizer_aa<low_base_shift, int16>;
 
-            int coord  = cur_cell->packed_coord;
-            x = cur_cell->x;
-            y = cur_cell->y;
 
-            if(y > ty) return false;
 
-            area   = start_cell->area;
-            cover += start_cell->cover;
+    //========================================================================
 
-            while((cur_cell = *cells++) != 0)
+    //------------------------------------------------------------------------
+    template<class T> static void grow_array(T*& arr, unsigned& max_size, 
+                                             unsigned size)
+    {
+        if(size > max_size)
+        {
+            unsigned new_size = max_size * 2;
+            if(new_size < size) new_size = size;
+            T* new_arr = new T [new_size];
+            if(arr)
+            {
+                memcpy(new_arr, arr, max_size * sizeof(T));
+                delete [] arr;
+            }
+            arr = new_arr;
+            max_size = new_size;
+        }
+    }
+
+
+    //------------------------------------------------------------------------
+    // The same within a budget: "allocated" is the total size of the arrays
+    // that are counted against it. Returns false if the array can't grow.
+    template<class T> static bool grow_array(T*& arr, unsigned& max_size, 
+                                             unsigned size,
+                                             unsigned& allocated, 
+                                             unsigned budget)
+    {
+        if(size > max_size)
+        {
+            unsigned limit = max_size + (budget - allocated) / sizeof(T);
+            if(size > limit) return false;
+            unsigned new_size = max_size * 2;
+            if(new_size < size)  new_size = size;
+            if(new_size > limit) new_size = limit;
+            T* new_arr = new T [new_size];
+            if(arr)
             {
-                if(cur_cell->packed_coord != coord) break;
-                area  += cur_cell->area;
-                cover += cur_cell->cover;
+                memcpy(new_arr, arr, max_size * sizeof(T));
+                delete [] arr;
             }
+            allocated += (new_size - max_size) * sizeof(T);
+            arr = new_arr;
+            max_size = new_size;
+        }
+        return true;
+    }
+
+
+    //------------------------------------------------------------------------
+    batch_rasterizer::~batch_rasterizer()
+    {
+        delete [] m_cursors;
+        delete [] m_active;
+        delete [] m_shapes;
+        delete [] m_rows;
+        delete [] m_cells;
+    }
 
+
+    //------------------------------------------------------------------------
+    batch_rasterizer::batch_rasterizer(unsigned budget) :
+        m_cells(0),
+        m_num_cells(0),
+        m_max_cells(0),
+        m_rows(0),
+        m_num_rows(0),
+        m_max_rows(0),
+        m_shapes(0),
+        m_num_shapes(0),
+        m_max_shapes(0),
+        m_active(0),
+        m_cursors(0),
+        m_max_active(0),
+        m_budget(budget),
+        m_allocated(0),
+        m_num_dropped(0),
+        m_min_y(0x7FFFFFFF),
+        m_max_y(-0x7FFFFFFF)
+    {
+        memcpy(m_gamma, rasterizer::s_default_gamma, sizeof(m_gamma));
+    }
+
+
+    //------------------------------------------------------------------------
+    void batch_rasterizer::reset()
+    {
+        m_outline.reset();
+        m_num_cells  = 0;
+        m_num_rows   = 0;
+        m_num_shapes = 0;
+        m_num_dropped = 0;
+        m_min_y =  0x7FFFFFFF;
+        m_max_y = -0x7FFFFFFF;
+    }
+
+
+    //------------------------------------------------------------------------
+    void batch_rasterizer::gamma(double g)
+    {
+        unsigned i;
+        for(i = 0; i < 256; i++)
+        {
+            m_gamma[i] = (unsigned char)(pow(double(i) / 255.0, g) * 255.0);
+        }
+    }
+
+
+    //------------------------------------------------------------------------
+    void batch_rasterizer::gamma(const int8u* g)
+    {
+        memcpy(m_gamma, g, sizeof(m_gamma));
+    }
+
+
+    //------------------------------------------------------------------------
+    void batch_rasterizer::add(const rgba8& c, filling_rule_e filling_rule)
+    {
+        const cell* cells = m_outline.cells();
+        unsigned num_cells = m_outline.num_cells();
+        if(num_cells)
+        {
+            int min_y = m_outline.min_y();
+            int max_y = m_outline.max_y();
+            unsigned num_rows = unsigned(max_y - min_y + 1);
+
+            if(grow_array(m_cells, m_max_cells, m_num_cells + num_cells, 
+                          m_allocated, m_budget) &&
+               grow_array(m_rows,  m_max_rows,  m_num_rows + num_rows, 
+                          m_allocated, m_budget))
+            {
+                grow_array(m_shapes, m_max_shapes, m_num_shapes + 1);
+
+                memcpy(m_cells + m_num_cells, cells, num_cells * sizeof(cell));
+
+                row* cur_row = m_rows + m_num_rows;
+                int y;
+                for(y = min_y; y <= max_y; y++, cur_row++)
+                {
+                    cur_row->start = m_num_cells + 
+                                     unsigned(m_outline.scanline_cells(y) - cells);
+                    cur_row->num   = m_outline.scanline_num_cells(y);
+                }
+
+                shape& sh = m_shapes[m_num_shapes++];
+                sh.color        = c;
+                sh.filling_rule = filling_rule;
+                sh.min_x        = m_outline.min_x();
+                sh.min_y        = min_y;
+                sh.max_x        = m_outline.max_x();
+                sh.max_y        = max_y;
+                sh.rows         = m_num_rows;
+
+                if(min_y < m_min_y) m_min_y = min_y;
+                if(max_y > m_max_y) m_max_y = max_y;
+
+                m_num_cells += num_cells;
+                m_num_rows  += num_rows;
+            }
+            else
+            {
+                // The copy doesn't fit the budget, the shape is dropped
+                m_num_dropped += num_cells;
+                AGG_STATS_ADD(dropped_cells, num_cells);
+            }
+        }
+        m_num_dropped += m_outline.num_dropped_cells();
+        m_outline.reset();
+    }
+
+
+    //------------------------------------------------------------------------
+    unsigned batch_rasterizer::activate_shapes(int ty1, int ty2, int width)
+    {
+        unsigned num_active = 0;
+        unsigned i;
+        for(i = 0; i < m_num_shapes; i++)
+        {
+            const shape& sh = m_shapes[i];
+            if(sh.max_y < ty1 || sh.min_y > ty2) continue;
+            if(sh.max_x < 0   || sh.min_x >= width) continue;
+
+            if(num_active >= m_max_active)
+            {
+                unsigned max_cursors = m_max_active * tile_size;
+                grow_array(m_active, m_max_active, num_active + 1);
+                grow_array(m_cursors, max_cursors, m_max_active * tile_size);
+            }
+            m_active[num_active] = i;
+
+            int y1 = sh.min_y > ty1 ? sh.min_y : ty1;
+            int y2 = sh.max_y < ty2 ? sh.max_y : ty2;
+            cursor* cur = m_cursors + num_active * tile_size + (y1 - ty1);
+            for(; y1 <= y2; y1++, cur++)
+            {
+                cur->idx   = 0;
+                cur->x     = sh.min_x;
+                cur->cover = 0;
+            }
+            num_active++;
+        }
+        return num_active;
+    }
+
+
+    //------------------------------------------------------------------------
+    // The same sweep as in rasterizer::render(), but it produces only the 
+    // pixels within [x1...x2) and leaves the cursor at the first cell that
+    // belongs to the next tiles. A span that crosses the right border is 
+    // continued by the next tile from the same cursor.
+    void batch_rasterizer::sweep_tile(const shape& sh, int y, cursor& cur, 
+                                      int x1, int x2)
+    {
+        const row&  rw    = m_rows[sh.rows + (y - sh.min_y)];
+        const cell* cells = m_cells + rw.start;
+        unsigned i     = cur.idx;
+        int      x     = cur.x;
+        int      cover = cur.cover;
+        unsigned alpha;
+
+        for(;;)
+        {
+            int next_x = (i < rw.num) ? cells[i].x() : x;
+            if(next_x > x)
+            {
+                int sx1 = x > x1 ? x : x1;
+                int sx2 = next_x < x2 ? next_x : x2;
+                if(sx2 > sx1)
+                {
+                    alpha = rasterizer::calculate_alpha(cover << (poly_base_shift + 1), 
+                                                        sh.filling_rule);
+                    if(alpha)
+                    {
+                        m_scanline.add_span(sx1, y, sx2 - sx1, m_gamma[alpha]);
+                    }
+                }
+            }
+            if(i == rw.num || next_x >= x2) break;
+
+            int32u key = cells[i].key;
+            int area   = cells[i].area();
+            cover     += cells[i].cover();
+            while(++i < rw.num && cells[i].key == key)
+            {
+                area  += cells[i].area();
+                cover += cells[i].cover();
+            }
+
+            x = next_x;
             if(area)
             {
-                alpha = calculate_alpha((cover << (poly_base_shift + 1)) - area);
-                if(alpha)
+                if(x >= x1)
                 {
-                    if(tx == x && ty == y) return true;
+                    alpha = rasterizer::calculate_alpha((cover << (poly_base_shift + 1)) - area, 
+                                                        sh.filling_rule);
+                    if(alpha)
+                    {
+                        m_scanline.add_cell(x, y, m_gamma[alpha]);
+                    }
                 }
                 x++;
             }
+        }
+
+        cur.idx   = i;
+        cur.x     = x;
+        cur.cover = cover;
+    }
+
+
+
 
-            if(!cur_cell) break;
+    //========================================================================
+
+    //------------------------------------------------------------------------
+    compound_rasterizer::~compound_rasterizer()
+    {
+        delete [] m_covers;
+        delete [] m_mask;
+        delete [] m_pixels;
+        delete [] m_styles;
+    }
 
-            if(cur_cell->x > x)
+
+    //------------------------------------------------------------------------
+    compound_rasterizer::compound_rasterizer(unsigned budget) :
+        m_arena(budget),
+        m_outline(m_arena),
+        m_sorted_cells(0),
+        m_rows(0),
+        m_styles(0),
+        m_num_styles(0),
+        m_max_styles(0),
+        m_pixels(0),
+        m_max_pixels(0),
+        m_mask(0),
+        m_covers(0),
+        m_max_width(0),
+        m_num_dropped(0),
+        m_sorted(false)
+    {
+        memcpy(m_gamma, rasterizer::s_default_gamma, sizeof(m_gamma));
+    }
+
+
+    //------------------------------------------------------------------------
+    void compound_rasterizer::reset()
+    {
+        m_outline.reset();
+        m_rows        = 0;
+        m_num_styles  = 0;
+        m_num_dropped = 0;
+        m_sorted      = false;
+    }
+
+
+    //------------------------------------------------------------------------
+    void compound_rasterizer::gamma(double g)
+    {
+        unsigned i;
+        for(i = 0; i < 256; i++)
+        {
+            m_gamma[i] = (unsigned char)(pow(double(i) / 255.0, g) * 255.0);
+        }
+    }
+
+
+    //------------------------------------------------------------------------
+    void compound_rasterizer::gamma(const int8u* g)
+    {
+        memcpy(m_gamma, g, sizeof(m_gamma));
+    }
+
+
+    //------------------------------------------------------------------------
+    void compound_rasterizer::add(const rgba8& c, filling_rule_e filling_rule)
+    {
+        m_outline.close_shape();
+        grow_array(m_styles, m_max_styles, m_num_styles + 1);
+        style_info& st = m_styles[m_num_styles++];
+        st.color        = c;
+        st.filling_rule = filling_rule;
+        st.end          = m_outline.num_cells();
+        m_sorted = false;
+    }
+
+
+    //------------------------------------------------------------------------
+    // All the cells are sorted at once in the scratch area of the arena, 
+    // the same way as by outline::cells(), except that the scanlines are
+    // ordered by the style first. The counting sort by Y is stable, so the
+    // cells of every scanline are already in the order of the styles and
+    // only the cells of each style have to be sorted by X.
+    bool compound_rasterizer::sort_cells(int width, unsigned pix_width)
+    {
+        if(m_num_styles == 0) return false;
+
+        if(unsigned(width) > m_max_width)
+        {
+            delete [] m_covers;
+            delete [] m_mask;
+            m_max_width = unsigned(width);
+            m_mask   = new int8u [m_max_width];
+            m_covers = new int8u [m_max_width];
+            memset(m_mask, 0, m_max_width);
+        }
+
+        if(unsigned(width) * pix_width > m_max_pixels)
+        {
+            delete [] m_pixels;
+            m_max_pixels = unsigned(width) * pix_width;
+            m_pixels = new int8u [m_max_pixels];
+        }
+
+        if(m_sorted) return m_rows != 0;
+        m_sorted = true;
+        m_rows   = 0;
+
+        // The styles beyond max_styles are dropped, the cells after the 
+        // last add() aren't a shape yet
+        unsigned num_styles = m_num_styles;
+        if(num_styles > unsigned(max_styles)) num_styles = max_styles;
+        unsigned num_cells = m_styles[num_styles - 1].end;
+        m_num_dropped = m_styles[m_num_styles - 1].end - num_cells;
+        AGG_STATS_ADD(dropped_cells, m_num_dropped);
+        if(num_cells == 0) return false;
+
+        int min_x = m_outline.min_x();
+        int min_y = m_outline.min_y();
+        unsigned num_rows = unsigned(m_outline.max_y() - min_y + 1);
+        unsigned rows_size = num_rows * sizeof(row);
+        row* rows = (row*)m_arena.scratch(rows_size);
+        if(rows == 0)
+        {
+            m_num_dropped += num_cells;
+            AGG_STATS_ADD(dropped_cells, num_cells);
+            return false;
+        }
+        memset(rows, 0, rows_size);
+
+        const cell* c;
+        unsigned nb;
+        unsigned num;
+        unsigned left;
+        unsigned i;
+
+        // Build the Y-histogram
+        for(nb = 0, left = num_cells; left; nb++)
+        {
+            c = m_outline.block_cells(nb, &num);
+            if(num > left) num = left;
+            left -= num;
+            for(; num; --num, ++c)
             {
-                alpha = calculate_alpha(cover << (poly_base_shift + 1));
-                if(alpha)
+                rows[c->y() - min_y].start++;
+            }
+        }
+
+        unsigned start = 0;
+        unsigned max_num = 0;
+        for(i = 0; i < num_rows; i++)
+        {
+            unsigned v = rows[i].start;
+            rows[i].start = start;
+            start += v;
+            if(v > max_num) max_num = v;
+        }
+
+        // The memory of the radix sort, the sorted cells and the scanlines
+        unsigned radix_size = 0;
+        if(max_num > insertion_sort_threshold) radix_size = max_num * sizeof(cell);
+        unsigned cells_size = num_cells * sizeof(cell);
+        cell* radix_cells = (cell*)m_arena.scratch(radix_size + 
+                                                   cells_size + 
+                                                   rows_size);
+        if(radix_cells == 0)
+        {
+            m_num_dropped += num_cells;
+            AGG_STATS_ADD(dropped_cells, num_cells);
+            return false;
+        }
+        m_sorted_cells = (cell*)((int8u*)radix_cells + radix_size);
+        rows = (row*)((int8u*)m_sorted_cells + cells_size);
+
+        // Distribute the cells into the scanlines, the style replaces Y
+        unsigned style = 0;
+        for(nb = 0, left = num_cells, i = 0; left; nb++)
+        {
+            c = m_outline.block_cells(nb, &num);
+            if(num > left) num = left;
+            left -= num;
+            for(; num; --num, ++c, ++i)
+            {
+                while(i == m_styles[style].end) style++;
+                row& rw = rows[c->y() - min_y];
+                cell& dst = m_sorted_cells[rw.start + rw.num++];
+                dst.key = (cell::key_type(style) << cell::coord_bits) | 
+                          (c->key & ((cell::key_type(1) << cell::coord_bits) - 1));
+                dst.cover_area = c->cover_area;
+            }
+        }
+
+        // Sort the cells of every style by X
+        unsigned passes = 1;
+        while(passes < 4 && unsigned(m_outline.max_x() - min_x) >> (passes * 8))
+        {
+            passes++;
+        }
+        AGG_STATS_ADD(sorted_cells, num_cells);
+        for(i = 0; i < num_rows; i++)
+        {
+            cell* cur = m_sorted_cells + rows[i].start;
+            cell* end = cur + rows[i].num;
+            while(cur != end)
+            {
+                cell::key_type key = cur->key >> cell::coord_bits;
+                cell* last = cur + 1;
+                while(last != end && (last->key >> cell::coord_bits) == key) last++;
+
+                unsigned n = unsigned(last - cur);
+                if(n > insertion_sort_threshold)
                 {
-                    if(ty == y && tx >= x && tx <= cur_cell->x) return true;
+                    AGG_STATS_ADD(radix_passes, passes);
+                    radix_sort_cells(cur, n, radix_cells, min_x, passes);
                 }
+                else
+                if(n > 1)
+                {
+                    insertion_sort_cells(cur, n);
+                }
+                cur = last;
             }
         }
-        return false;
+        m_rows = rows;
+        return true;
     }
 
 
+    //------------------------------------------------------------------------
+    // The pixels of row y that can be covered, from the first cell to the
+    // last one of all the styles, clipped to the buffer.
+    bool compound_rasterizer::row_range(int y, int width, int* x1, int* x2) const
+    {
+        const row& rw = m_rows[y - m_outline.min_y()];
+        if(rw.num == 0) return false;
+
+        const cell* c   = m_sorted_cells + rw.start;
+        const cell* end = c + rw.num;
+        int min_x =  0x7FFFFFFF;
+        int max_x = -0x7FFFFFFF;
+        for(; c != end; c++)
+        {
+            int x = c->x();
+            if(x < min_x) min_x = x;
+            if(x > max_x) max_x = x;
+        }
 
-}
+        if(min_x < 0) min_x = 0;
+        if(max_x > width - 1) max_x = width - 1;
+        *x1 = min_x;
+        *x2 = max_x;
+        return min_x <= max_x;
+    }
 
 
+    //------------------------------------------------------------------------
+    // Sweeps the cells of every style of row y like rasterizer::render() 
+    // and blends the result into the copy of the pixels [x1...x2], marking
+    // them in m_mask. The covers of the adjacent partial cells of a style 
+    // are collected and blended with one render() of the span.
+    void compound_rasterizer::composite_row(const blender& b, 
+                                            int y, int x1, int x2)
+    {
+        const row& rw = m_rows[y - m_outline.min_y()];
+        const cell* cells = m_sorted_cells + rw.start;
+        const cell* end   = cells + rw.num;
+        unsigned alpha;
 
+        while(cells != end)
+        {
+            cell::key_type style = cells->key >> cell::coord_bits;
+            const style_info& st = m_styles[style];
+            const cell* last = cells + 1;
+            while(last != end && (last->key >> cell::coord_bits) == style) last++;
+
+            int cover = 0;
+            int start_x = 0;
+            unsigned num_covers = 0;
+            for(;;)
+            {
+                int x      = cells->x();
+                int32u key = cells->key;
+                int area   = cells->area();
+                cover     += cells->cover();
+                while(++cells != last && cells->key == key)
+                {
+                    area  += cells->area();
+                    cover += cells->cover();
+                }
+
+                if(area)
+                {
+                    if(x >= x1 && x <= x2)
+                    {
+                        alpha = rasterizer::calculate_alpha((cover << (poly_base_shift + 1)) - area,
+                                                            st.filling_rule);
+                        if(alpha)
+                        {
+                            if(num_covers && start_x + int(num_covers) != x)
+                            {
+                                b.render(m_pixels, start_x, num_covers, m_covers, st.color);
+                                memset(m_mask + start_x, 1, num_covers);
+                                num_covers = 0;
+                            }
+                            if(num_covers == 0) start_x = x;
+                            m_covers[num_covers++] = m_gamma[alpha];
+                        }
+                    }
+                    x++;
+                }
 
+                if(cells == last) break;
 
+                int sx1 = (x > x1) ? x : x1;
+                int sx2 = (cells->x() <= x2) ? cells->x() : x2 + 1;
+                if(sx2 > sx1)
+                {
+                    alpha = rasterizer::calculate_alpha(cover << (poly_base_shift + 1),
+                                                        st.filling_rule);
+                    if(alpha)
+                    {
+                        b.blend_hline(m_pixels, sx1, unsigned(sx2 - sx1), 
+                                      st.color, m_gamma[alpha]);
+                        memset(m_mask + sx1, 1, unsigned(sx2 - sx1));
+                    }
+                }
+            }
+            if(num_covers)
+            {
+                b.render(m_pixels, start_x, num_covers, m_covers, st.color);
+                memset(m_mask + start_x, 1, num_covers);
+            }
+        }
+    }
+
+}
@@ -0,0 +1,635 @@
+//----------------------------------------------------------------------------
+// The cell-by-cell test of the edge stepping of outline_aa. Random shapes
+// are made into cells by the outline and by a copy of the original
+// render_line()/render_scanline() below, which divide with / and %. The
+// cover and the area of every cell must be the same. Built and run on
+// the host with "make -f Makefile.host test":
+//
+//     host/agg_cells_test [shapes]
+//
+//----------------------------------------------------------------------------
+#include <stdio.h>
+#include <stdlib.h>
+#include "agg.h"
+
+
+//----------------------------------------------------------------------------
+// Xorshift, the same sequence everywhere
+class test_random
+{
+public:
+    test_random(unsigned seed) : m_state(seed ? seed : 1) {}
+
+    unsigned next()
+    {
+        m_state ^= m_state << 13;
+        m_state ^= m_state >> 17;
+        m_state ^= m_state << 5;
+        return m_state;
+    }
+
+    // [lo...hi]
+    int uniform(int lo, int hi)
+    {
+        return lo + int(next() % unsigned(hi - lo + 1));
+    }
+
+private:
+    unsigned m_state;
+};
+
+
+//----------------------------------------------------------------------------
+struct test_cell
+{
+    int x;
+    int y;
+    int cover;
+    int area;
+};
+
+static int compare_cells(const void* a, const void* b)
+{
+    const test_cell* c1 = (const test_cell*)a;
+    const test_cell* c2 = (const test_cell*)b;
+    if(c1->y != c2->y) return (c1->y < c2->y) ? -1 : 1;
+    if(c1->x != c2->x) return (c1->x < c2->x) ? -1 : 1;
+    return 0;
+}
+
+// Sorts the cells and adds up the ones with the same coordinates. The
+// non-empty sums are moved to the front, returns their number.
+static unsigned merge_cells(agg::pod_vector<test_cell>& cells)
+{
+    if(cells.size() == 0) return 0;
+    qsort(&cells[0], cells.size(), sizeof(test_cell), compare_cells);
+    unsigned n = 0;
+    unsigned i;
+    for(i = 0; i < cells.size(); )
+    {
+        test_cell c = cells[i++];
+        while(i < cells.size() && cells[i].x == c.x && cells[i].y == c.y)
+        {
+            c.cover += cells[i].cover;
+            c.area  += cells[i].area;
+            i++;
+        }
+        if(c.cover | c.area) cells[n++] = c;
+    }
+    return n;
+}
+
+
+//----------------------------------------------------------------------------
+// The edge stepping of outline_aa before the divisions were replaced by
+// the reciprocals. Every add_cover() becomes a test_cell.
+template<class CalcType> class reference_outline
+{
+public:
+    enum
+    {
+        subpixel_shift = agg::poly_base_shift,
+        subpixel_size  = 1 << subpixel_shift,
+        subpixel_mask  = subpixel_size - 1
+    };
+
+    reference_outline(agg::pod_vector<test_cell>& cells) :
+        m_cells(&cells), m_cur_x(0), m_cur_y(0) {}
+
+    void render_line(int x1, int y1, int x2, int y2)
+    {
+        int ey1 = y1 >> subpixel_shift;
+        int ey2 = y2 >> subpixel_shift;
+        int fy1 = y1 & subpixel_mask;
+        int fy2 = y2 & subpixel_mask;
+
+        int dx, dy, x_from, x_to;
+        int rem, mod, lift, delta, first, incr;
+        CalcType p;
+
+        set_cur_cell(x1 >> subpixel_shift, ey1);
+
+        dx = x2 - x1;
+        dy = y2 - y1;
+
+        if(ey1 == ey2)
+        {
+            render_scanline(ey1, x1, fy1, x2, fy2);
+            return;
+        }
+
+        incr  = 1;
+        if(dx == 0)
+        {
+            int ex = x1 >> subpixel_shift;
+            int two_fx = (x1 - (ex << subpixel_shift)) << 1;
+            int area;
+
+            first = subpixel_size;
+            if(dy < 0)
+            {
+                first = 0;
+                incr  = -1;
+            }
+
+            delta = first - fy1;
+            add_cover(delta, two_fx * delta);
+
+            ey1 += incr;
+            set_cur_cell(ex, ey1);
+
+            delta = first + first - subpixel_size;
+            area = two_fx * delta;
+            while(ey1 != ey2)
+            {
+                add_cover(delta, area);
+                ey1 += incr;
+                set_cur_cell(ex, ey1);
+            }
+            delta = fy2 - subpixel_size + first;
+            add_cover(delta, two_fx * delta);
+            return;
+        }
+
+        p     = (subpixel_size - fy1) * CalcType(dx);
+        first = subpixel_size;
+
+        if(dy < 0)
+        {
+            p     = fy1 * CalcType(dx);
+            first = 0;
+            incr  = -1;
+            dy    = -dy;
+        }
+
+        delta = int(p / dy);
+        mod   = int(p % dy);
+
+        if(mod < 0)
+        {
+            delta--;
+            mod += dy;
+        }
+
+        x_from = x1 + delta;
+        render_scanline(ey1, x1, fy1, x_from, first);
+
+        ey1 += incr;
+        set_cur_cell(x_from >> subpixel_shift, ey1);
+
+        if(ey1 != ey2)
+        {
+            p     = subpixel_size * CalcType(dx);
+            lift  = int(p / dy);
+            rem   = int(p % dy);
+
+            if(rem < 0)
+            {
+                lift--;
+                rem += dy;
+            }
+            mod -= dy;
+
+            while(ey1 != ey2)
+            {
+                delta = lift;
+                mod  += rem;
+                if (mod >= 0)
+                {
+                    mod -= dy;
+                    delta++;
+                }
+
+                x_to = x_from + delta;
+                render_scanline(ey1, x_from, subpixel_size - first, x_to, first);
+                x_from = x_to;
+
+                ey1 += incr;
+                set_cur_cell(x_from >> subpixel_shift, ey1);
+            }
+        }
+        render_scanline(ey1, x_from, subpixel_size - first, x2, fy2);
+    }
+
+private:
+    void set_cur_cell(int x, int y)
+    {
+        m_cur_x = x;
+        m_cur_y = y;
+    }
+
+    void add_cover(int cover, int area)
+    {
+        test_cell c;
+        c.x     = m_cur_x;
+        c.y     = m_cur_y;
+        c.cover = cover;
+        c.area  = area;
+        m_cells->add(c);
+    }
+
+    void render_scanline(int ey, int x1, int y1, int x2, int y2)
+    {
+        int ex1 = x1 >> subpixel_shift;
+        int ex2 = x2 >> subpixel_shift;
+        int fx1 = x1 & subpixel_mask;
+        int fx2 = x2 & subpixel_mask;
+
+        int delta, p, first, dx;
+        int incr, lift, mod, rem;
+
+        if(y1 == y2)
+        {
+            set_cur_cell(ex2, ey);
+            return;
+        }
+
+        if(ex1 == ex2)
+        {
+            delta = y2 - y1;
+            add_cover(delta, (fx1 + fx2) * delta);
+            return;
+        }
+
+        p     = (subpixel_size - fx1) * (y2 - y1);
+        first = subpixel_size;
+        incr  = 1;
+
+        dx = x2 - x1;
+
+        if(dx < 0)
+        {
+            p     = fx1 * (y2 - y1);
+            first = 0;
+            incr  = -1;
+            dx    = -dx;
+        }
+
+        delta = p / dx;
+        mod   = p % dx;
+
+        if(mod < 0)
+        {
+            delta--;
+            mod += dx;
+        }
+
+        add_cover(delta, (fx1 + first) * delta);
+
+        ex1 += incr;
+        set_cur_cell(ex1, ey);
+        y1  += delta;
+
+        if(ex1 != ex2)
+        {
+            p     = subpixel_size * (y2 - y1 + delta);
+            lift  = p / dx;
+            rem   = p % dx;
+
+            if (rem < 0)
+            {
+                lift--;
+                rem += dx;
+            }
+
+            mod -= dx;
+
+            while (ex1 != ex2)
+            {
+                delta = lift;
+                mod  += rem;
+                if(mod >= 0)
+                {
+                    mod -= dx;
+                    delta++;
+                }
+
+                add_cover(delta, (subpixel_size) * delta);
+                y1  += delta;
+                ex1 += incr;
+                set_cur_cell(ex1, ey);
+            }
+        }
+        delta = y2 - y1;
+        add_cover(delta, (fx2 + subpixel_size - first) * delta);
+    }
+
+private:
+    agg::pod_vector<test_cell>* m_cells;
+    int m_cur_x;
+    int m_cur_y;
+};
+
+
+//----------------------------------------------------------------------------
+// A closed polygon of num vertices around (cx, cy), in subpixels. The
+// kinds make steep, shallow, thin and long edges.
+static void make_polygon(test_random& rnd, int* xy, unsigned num,
+                         int cx, int cy, int size)
+{
+    unsigned kind = rnd.next() % 4;
+    unsigned i;
+    for(i = 0; i < num; i++)
+    {
+        int dx = rnd.uniform(-size, size);
+        int dy = rnd.uniform(-size, size);
+        switch(kind)
+        {
+        case 1: dx >>= 6; break;                    // Steep
+        case 2: dy >>= 6; break;                    // Shallow
+        case 3: if(i & 1) { dx >>= 8; dy >>= 8; }   // Thin spikes
+                break;
+        }
+        xy[i * 2]     = cx + dx;
+        xy[i * 2 + 1] = cy + dy;
+    }
+}
+
+
+//----------------------------------------------------------------------------
+// Returns the number of the shapes whose cells differ
+template<class Outline, class CalcType>
+unsigned test_outline(const char* name, unsigned num_shapes,
+                      int max_center, int max_size)
+{
+    agg::cell_arena arena(64 * 1024 * 1024);
+    Outline outline(arena);
+    agg::pod_vector<test_cell> cells;
+    agg::pod_vector<test_cell> ref_cells;
+    test_random rnd(12345);
+    int xy[16 * 2];
+    unsigned num_failed  = 0;
+    unsigned num_dropped = 0;
+    unsigned long long num_cells = 0;
+    unsigned i;
+
+    for(i = 0; i < num_shapes; i++)
+    {
+        unsigned num = 3 + rnd.next() % 14;
+        int size = 1 << rnd.uniform(4, max_size);
+        make_polygon(rnd, xy, num,
+                     rnd.uniform(-max_center, max_center),
+                     rnd.uniform(-max_center, max_center),
+                     size);
+
+        outline.reset();
+        outline.move_to(xy[0], xy[1]);
+        unsigned j;
+        for(j = 1; j < num; j++) outline.line_to(xy[j * 2], xy[j * 2 + 1]);
+
+        const typename Outline::cell_type* c = outline.cells();
+        if(outline.num_dropped_cells())
+        {
+            num_dropped++;
+            continue;
+        }
+        cells.remove_all();
+        for(j = 0; j < outline.num_cells(); j++, c++)
+        {
+            test_cell tc;
+            tc.x     = c->x();
+            tc.y     = c->y();
+            tc.cover = c->cover();
+            tc.area  = c->area();
+            cells.add(tc);
+        }
+
+        ref_cells.remove_all();
+        reference_outline<CalcType> ref(ref_cells);
+        for(j = 0; j < num; j++)
+        {
+            unsigned k = (j + 1) % num;
+            ref.render_line(xy[j * 2], xy[j * 2 + 1], xy[k * 2], xy[k * 2 + 1]);
+        }
+
+        unsigned n1 = merge_cells(cells);
+        unsigned n2 = merge_cells(ref_cells);
+        num_cells += n1;
+
+        bool same = n1 == n2;
+        for(j = 0; same && j < n1; j++)
+        {
+            const test_cell& c1 = cells[j];
+            const test_cell& c2 = ref_cells[j];
+            same = c1.x == c2.x && c1.y == c2.y &&
+                   c1.cover == c2.cover && c1.area == c2.area;
+        }
+        if(!same)
+        {
+            if(num_failed == 0)
+            {
+                printf("%s: shape %u differs, %u cells, %u expected\n",
+                       name, i, n1, n2);
+            }
+            num_failed++;
+        }
+    }
+
+    printf("%-14s %6u shapes %10llu cells  %s",
+           name, num_shapes, num_cells, num_failed ? "FAILED" : "ok");
+    if(num_dropped) printf(" (%u skipped, out of cells)", num_dropped);
+    printf("\n");
+    return num_failed;
+}
+
+
+//----------------------------------------------------------------------------
+// The cells accumulated straight from the edges must be the same as the 
+// stored ones added up in the buffer, and, once they are stored because of 
+// an edge outside the box or line_to(), the same as the cells of the edges.
+// Returns the number of the shapes that differ.
+static unsigned test_accumulation(unsigned num_shapes)
+{
+    agg::outline acc;
+    agg::outline ref;
+    acc.accumulation_threshold(64 * 64);
+    test_random rnd(54321);
+    int xy[16 * 2];
+    unsigned num_failed = 0;
+    unsigned num_acc = 0;
+    unsigned i;
+
+    for(i = 0; i < num_shapes; i++)
+    {
+        unsigned num = 3 + rnd.next() % 14;
+        make_polygon(rnd, xy, num, 
+                     rnd.uniform(-100, 100) * agg::poly_base_size,
+                     rnd.uniform(-100, 100) * agg::poly_base_size,
+                     1 << rnd.uniform(4, 13));
+
+        // Another one inside, then maybe an edge beyond the box
+        unsigned mode = rnd.next() % 4;
+        acc.reset();
+        ref.reset();
+        acc.add_poly(xy, num, true);
+        ref.add_poly(xy, num, true);
+        if(mode == 1)
+        {
+            acc.add_poly(xy + 2, num - 1, false);
+            ref.add_poly(xy + 2, num - 1, false);
+        }
+        if(acc.accumulating()) num_acc++;
+        if(mode == 2)
+        {
+            acc.line_to(xy[0] + 20000, xy[1]);
+            ref.line_to(xy[0] + 20000, xy[1]);
+        }
+        if(mode == 3)
+        {
+            acc.add_poly(xy, 1, false);
+            ref.add_poly(xy, 1, false);
+        }
+
+        bool same = true;
+        if(acc.accumulating())
+        {
+            // Without the cells there's no buffer of the stored ones
+            const agg::outline::acc_cell* a = acc.accumulate_cells();
+            const agg::outline::acc_cell* b = ref.accumulate_cells();
+            unsigned num_cells = unsigned(acc.max_x() - acc.min_x() + 1) * 
+                                 unsigned(acc.max_y() - acc.min_y() + 1);
+            same = a && (b || ref.num_cells() == 0) &&
+                   acc.min_x() == ref.min_x() && acc.min_y() == ref.min_y() &&
+                   acc.max_x() == ref.max_x() && acc.max_y() == ref.max_y();
+            unsigned j;
+            for(j = 0; same && j < num_cells; j++)
+            {
+                same = b ? a[j].cover == b[j].cover && a[j].area == b[j].area
+                         : (a[j].cover | a[j].area) == 0;
+            }
+        }
+
+        const agg::cell* c1 = acc.cells();
+        const agg::cell* c2 = ref.cells();
+        agg::pod_vector<test_cell> cells1;
+        agg::pod_vector<test_cell> cells2;
+        unsigned j;
+        for(j = 0; c1 && j < acc.num_cells(); j++, c1++)
+        {
+            test_cell tc = { c1->x(), c1->y(), c1->cover(), c1->area() };
+            cells1.add(tc);
+        }
+        for(j = 0; c2 && j < ref.num_cells(); j++, c2++)
+        {
+            test_cell tc = { c2->x(), c2->y(), c2->cover(), c2->area() };
+            cells2.add(tc);
+        }
+        unsigned n1 = merge_cells(cells1);
+        unsigned n2 = merge_cells(cells2);
+        same = same && n1 == n2;
+        for(j = 0; same && j < n1; j++)
+        {
+            same = cells1[j].x == cells2[j].x && cells1[j].y == cells2[j].y &&
+                   cells1[j].cover == cells2[j].cover && 
+                   cells1[j].area == cells2[j].area;
+        }
+        if(!same)
+        {
+            if(num_failed == 0)
+            {
+                printf("accumulation: shape %u differs\n", i);
+            }
+            num_failed++;
+        }
+    }
+
+    printf("%-14s %6u shapes %10u accumulated  %s\n",
+           "accumulation", num_shapes, num_acc, num_failed ? "FAILED" : "ok");
+    return num_failed;
+}
+
+
+//----------------------------------------------------------------------------
+// The sorted copy of the cells and the accumulation buffer take the memory
+// beside the blocks. If the sorted cells don't fit the buffer or the budget,
+// the shape must be dropped and counted as a whole, if the accumulation 
+// buffer doesn't, the cells must be kept for the sorted sweep.
+static const int test_diamond[] = 
+{
+    300 * agg::poly_base_size, 20 * agg::poly_base_size,
+    580 * agg::poly_base_size, 300 * agg::poly_base_size,
+    300 * agg::poly_base_size, 580 * agg::poly_base_size,
+    20 * agg::poly_base_size, 300 * agg::poly_base_size
+};
+
+static unsigned test_arena_memory(agg::cell_arena& arena, unsigned num_cells,
+                                  bool fits)
+{
+    agg::outline outline(arena);
+    outline.add_poly(test_diamond, 4, true);
+    if(outline.accumulate_cells() != 0 || 
+       outline.num_cells() != num_cells) return 1;
+
+    const agg::cell* c = outline.cells();
+    if(fits)
+    {
+        return (c && outline.num_cells() == num_cells &&
+                outline.num_dropped_cells() == 0) ? 0 : 1;
+    }
+    return (c == 0 && outline.num_cells() == 0 &&
+            outline.num_dropped_cells() == num_cells) ? 0 : 1;
+}
+
+static unsigned test_arena()
+{
+    agg::outline roomy;
+    roomy.add_poly(test_diamond, 4, true);
+    roomy.close_cells();
+    unsigned num_cells = roomy.num_cells();
+    unsigned blocks = roomy.num_blocks() * agg::cell_arena::block_size;
+
+    // The blocks, the sorted cells, the radix sort and the scanlines
+    unsigned tight = blocks + num_cells * sizeof(agg::cell) / 2;
+    unsigned enough = blocks + num_cells * sizeof(agg::cell) * 2 + 
+                      (580 - 20 + 1) * 8 + 64;
+
+    static agg::int64 buf[1024 * 1024 / 8];
+    unsigned num_failed = 0;
+    {
+        agg::cell_arena arena(buf, tight);
+        num_failed += test_arena_memory(arena, num_cells, false);
+    }
+    {
+        agg::cell_arena arena(buf, enough);
+        num_failed += test_arena_memory(arena, num_cells, true);
+    }
+    {
+        agg::cell_arena arena(tight);
+        num_failed += test_arena_memory(arena, num_cells, false);
+    }
+    {
+        agg::cell_arena arena(enough);
+        num_failed += test_arena_memory(arena, num_cells, true);
+    }
+
+    printf("%-14s %6u shapes %10u cells  %s\n",
+           "arena", 4u, num_cells, num_failed ? "FAILED" : "ok");
+    return num_failed;
+}
+
+
+//----------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+    unsigned num_shapes = (argc > 1) ? unsigned(atoi(argv[1])) : 20000;
+    unsigned num_failed = 0;
+
+    // Within a frame, then up to the limits of int16 with long edges
+    num_failed += test_outline<agg::outline, int>("int16", num_shapes,
+                                                  2000 * agg::poly_base_size, 14);
+    num_failed += test_outline<agg::outline, int>("int16 large", num_shapes / 10,
+                                                  16000 * agg::poly_base_size, 21);
+
+    // The 64-bit products of the edges wider than 2^23 subpixels
+    num_failed += test_outline<agg::outline_int32, agg::int64>("int32", num_shapes,
+                                                               2000 * agg::poly_base_size, 14);
+    num_failed += test_outline<agg::outline_int32, agg::int64>("int32 wide", num_shapes / 50,
+                                                               1000000 * agg::poly_base_size, 24);
+
+    // The shapes accumulated without the cells
+    num_failed += test_accumulation(num_shapes);
+
+    // The sort and the accumulation within the memory of the arena
+    num_failed += test_arena();
+    return num_failed ? 1 : 0;
+}
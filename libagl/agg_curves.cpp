@@ -0,0 +1,247 @@
+//----------------------------------------------------------------------------
+// Anti-Grain Geometry - Version 2.1 Lite
+// Copyright (C) 2002-2003 Maxim Shemanarev (McSeem)
+//
+// Permission to copy, use, modify, sell and distribute this software
+// is granted provided this copyright notice appears in all copies.
+// This software is provided "as is" without express or implied
+// warranty, and with no claim as to its suitability for any purpose.
+//
+//----------------------------------------------------------------------------
+//
+// Classes ellipse, arc, curve3, curve4 - implementation.
+//
+// Everything is integer: the sine and cosine of the start angle and of
+// the step are calculated once per curve by a Taylor series, and the
+// number of steps comes from an integer square root.
+//
+//----------------------------------------------------------------------------
+
+#include "agg_curves.h"
+
+
+namespace agg
+{
+
+    //------------------------------------------------------------------------
+    static const int64 half_pi_q30 = pi_q30 / 2;
+    static const int64 two_pi_q30  = pi_q30 * 2;
+
+    //------------------------------------------------------------------------
+    unsigned isqrt(int64u v)
+    {
+        int64u root = 0;
+        int64u bit  = int64u(1) << 62;
+        while(bit > v) bit >>= 2;
+        while(bit)
+        {
+            if(v >= root + bit)
+            {
+                v    -= root + bit;
+                root  = (root >> 1) + bit;
+            }
+            else
+            {
+                root >>= 1;
+            }
+            bit >>= 2;
+        }
+        return unsigned(root);
+    }
+
+    //------------------------------------------------------------------------
+    static inline int iabs(int v) { return (v < 0) ? -v : v; }
+
+    //------------------------------------------------------------------------
+    static unsigned vector_length(int64 dx, int64 dy)
+    {
+        return isqrt(int64u(dx * dx + dy * dy));
+    }
+
+    //------------------------------------------------------------------------
+    // The angle is reduced to [-Pi/4...Pi/4], where the Taylor series up 
+    // to the 13th power is exact to the last bit.
+    void sin_cos(int64 a, int* s, int* c)
+    {
+        int64 q = (a >= 0) ?  (( a + half_pi_q30 / 2) / half_pi_q30) :
+                             -((-a + half_pi_q30 / 2) / half_pi_q30);
+        int64 r  = a - q * half_pi_q30;
+        int64 r2 = (r * r) >> 30;
+
+        int64 sum_s  = r;
+        int64 sum_c  = int64(1) << 30;
+        int64 term_s = r;
+        int64 term_c = int64(1) << 30;
+        int k;
+        for(k = 1; k <= 6; k++)
+        {
+            term_s = -((term_s * r2) >> 30) / ((2*k) * (2*k + 1));
+            term_c = -((term_c * r2) >> 30) / ((2*k - 1) * (2*k));
+            sum_s += term_s;
+            sum_c += term_c;
+        }
+
+        int vs = int(sum_s);
+        int vc = int(sum_c);
+        switch(int(q) & 3)
+        {
+        case 0: *s =  vs; *c =  vc; break;
+        case 1: *s =  vc; *c = -vs; break;
+        case 2: *s = -vs; *c = -vc; break;
+        case 3: *s = -vc; *c =  vs; break;
+        }
+    }
+
+    //------------------------------------------------------------------------
+    // The sagitta of a chord, r*(1-cos(da/2)) ~ r*da*da/8, must not exceed
+    // the tolerance, so the number of chords is a * sqrt(r / (8*tolerance)).
+    unsigned arc_steps(int64 a, int r, int tolerance)
+    {
+        if(tolerance < 1) tolerance = 1;
+        unsigned k = isqrt(int64u((int64(r) << 16) / (8 * tolerance)));
+        return unsigned((a * k) >> 38) + 1;
+    }
+
+    //------------------------------------------------------------------------
+    // The number of segments for a Bezier curve whose second derivative
+    // doesn't exceed d: the chord of a segment of length 1/n deviates from
+    // the curve by at most d/(8*n*n).
+    static unsigned bezier_steps(unsigned d, int tolerance, unsigned max_steps)
+    {
+        if(tolerance < 1) tolerance = 1;
+        unsigned n = (isqrt((int64u(d) << 8) / (8 * unsigned(tolerance))) + 15) >> 4;
+        if(n < 1) n = 1;
+        if(n > max_steps) n = max_steps;
+        return n;
+    }
+
+
+
+    //------------------------------------------------------------------------
+    void ellipse::init(int x, int y, int rx, int ry,
+                       unsigned num_steps,
+                       int tolerance)
+    {
+        m_x  = x;
+        m_y  = y;
+        m_rx = rx;
+        m_ry = ry;
+        m_num_steps = num_steps;
+        if(m_num_steps == 0)
+        {
+            m_num_steps = arc_steps(two_pi_q30, (iabs(rx) + iabs(ry)) / 2, tolerance);
+        }
+        if(m_num_steps < 4) m_num_steps = 4;
+        sin_cos(two_pi_q30 / m_num_steps, &m_step_sin, &m_step_cos);
+        rewind(0);
+    }
+
+
+
+    //------------------------------------------------------------------------
+    void arc::init(int x, int y, int rx, int ry, int a1, int a2,
+                   bool ccw,
+                   int tolerance)
+    {
+        m_x  = x;
+        m_y  = y;
+        m_rx = rx;
+        m_ry = ry;
+
+        int64 start = int64(a1) << (30 - curve_angle_shift);
+        int64 end   = int64(a2) << (30 - curve_angle_shift);
+        if(ccw) { while(end < start) end += two_pi_q30; }
+        else    { while(end > start) end -= two_pi_q30; }
+
+        int64 sweep = end - start;
+        m_num_steps = arc_steps((sweep < 0) ? -sweep : sweep,
+                                (iabs(rx) + iabs(ry)) / 2,
+                                tolerance);
+
+        sin_cos(start, &m_start_sin, &m_start_cos);
+        sin_cos(sweep / m_num_steps, &m_step_sin, &m_step_cos);
+
+        int s;
+        int c;
+        sin_cos(end, &s, &c);
+        m_end_x = x + int((int64(rx) * c + (1 << 29)) >> 30);
+        m_end_y = y + int((int64(ry) * s + (1 << 29)) >> 30);
+        rewind(0);
+    }
+
+
+
+    //------------------------------------------------------------------------
+    // p(t) = a*t^2 + b*t + p1, a = p1 - 2*p2 + p3, b = 2*(p2 - p1).
+    // With the step h = 1/n: df = a*h^2 + b*h, ddf = 2*a*h^2.
+    void curve3::init(int x1, int y1,
+                      int x2, int y2,
+                      int x3, int y3,
+                      int tolerance)
+    {
+        m_start_x = x1;
+        m_start_y = y1;
+        m_end_x   = x3;
+        m_end_y   = y3;
+
+        int64 ax = int64(x1) - 2 * int64(x2) + x3;
+        int64 ay = int64(y1) - 2 * int64(y2) + y3;
+        int64 bx = 2 * (int64(x2) - x1);
+        int64 by = 2 * (int64(y2) - y1);
+
+        // p'' = 2*a, the deviation is 2*|a|/(8*n*n)
+        m_num_steps = bezier_steps(2 * vector_length(ax, ay), tolerance, max_steps);
+
+        int64 n  = m_num_steps;
+        int64 n2 = n * n;
+        m_start_dfx = (ax << 28) / n2 + (bx << 28) / n;
+        m_start_dfy = (ay << 28) / n2 + (by << 28) / n;
+        m_ddfx      = (ax << 29) / n2;
+        m_ddfy      = (ay << 29) / n2;
+        rewind(0);
+    }
+
+
+
+    //------------------------------------------------------------------------
+    // p(t) = a*t^3 + b*t^2 + c*t + p1, a = 3*(p2 - p3) - p1 + p4,
+    // b = 3*(p1 - 2*p2 + p3), c = 3*(p2 - p1). With the step h = 1/n:
+    // df = a*h^3 + b*h^2 + c*h, ddf = 6*a*h^3 + 2*b*h^2, dddf = 6*a*h^3.
+    void curve4::init(int x1, int y1,
+                      int x2, int y2,
+                      int x3, int y3,
+                      int x4, int y4,
+                      int tolerance)
+    {
+        m_start_x = x1;
+        m_start_y = y1;
+        m_end_x   = x4;
+        m_end_y   = y4;
+
+        int64 ax = 3 * (int64(x2) - x3) - x1 + x4;
+        int64 ay = 3 * (int64(y2) - y3) - y1 + y4;
+        int64 tx = int64(x1) - 2 * int64(x2) + x3;
+        int64 ty = int64(y1) - 2 * int64(y2) + y3;
+        int64 cx = 3 * (int64(x2) - x1);
+        int64 cy = 3 * (int64(y2) - y1);
+
+        // p'' = 6*((1-t)*(p1 - 2*p2 + p3) + t*(p2 - 2*p3 + p4))
+        unsigned d1 = vector_length(tx, ty);
+        unsigned d2 = vector_length(int64(x2) - 2 * int64(x3) + x4,
+                                    int64(y2) - 2 * int64(y3) + y4);
+        m_num_steps = bezier_steps(6 * ((d1 > d2) ? d1 : d2), tolerance, max_steps);
+
+        int64 n  = m_num_steps;
+        int64 n2 = n * n;
+        int64 n3 = n2 * n;
+        m_start_dfx  = (ax << 28) / n3 + ((3 * tx) << 28) / n2 + (cx << 28) / n;
+        m_start_dfy  = (ay << 28) / n3 + ((3 * ty) << 28) / n2 + (cy << 28) / n;
+        m_start_ddfx = ((6 * ax) << 28) / n3 + ((6 * tx) << 28) / n2;
+        m_start_ddfy = ((6 * ay) << 28) / n3 + ((6 * ty) << 28) / n2;
+        m_dddfx      = ((6 * ax) << 28) / n3;
+        m_dddfy      = ((6 * ay) << 28) / n3;
+        rewind(0);
+    }
+
+}
+
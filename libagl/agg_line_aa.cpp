@@ -0,0 +1,134 @@
+//----------------------------------------------------------------------------
+// Anti-Grain Geometry - Version 2.1 Lite
+// Copyright (C) 2002-2003 Maxim Shemanarev (McSeem)
+//
+// Permission to copy, use, modify, sell and distribute this software
+// is granted provided this copyright notice appears in all copies.
+// This software is provided "as is" without express or implied
+// warranty, and with no claim as to its suitability for any purpose.
+//
+//----------------------------------------------------------------------------
+//
+// Class line_aa - implementation.
+//
+//----------------------------------------------------------------------------
+
+#include <math.h>
+#include "agg_line_aa.h"
+#include "agg_curves.h"
+
+
+namespace agg
+{
+
+    //------------------------------------------------------------------------
+    // The gamma of the rasterizer, so that the lines match the filled shapes
+    line_aa::line_aa() : m_width(poly_base_size)
+    {
+        memcpy(m_gamma, rasterizer::s_default_gamma, sizeof(m_gamma));
+    }
+
+
+    //------------------------------------------------------------------------
+    void line_aa::gamma(double g)
+    {
+        unsigned i;
+        for(i = 0; i < 256; i++)
+        {
+            m_gamma[i] = (unsigned char)(pow(double(i) / 255.0, g) * 255.0);
+        }
+    }
+
+
+    //------------------------------------------------------------------------
+    void line_aa::gamma(const int8u* g)
+    {
+        memcpy(m_gamma, g, sizeof(m_gamma));
+    }
+
+
+    //------------------------------------------------------------------------
+    // The only divisions and the square root of a line. The range along the
+    // major axis is clipped to the buffer and to where the line is within
+    // a margin of the buffer along the minor one, so the 16.16 values of
+    // the minor axis can't overflow.
+    bool line_aa::setup(segment& s, int x1, int y1, int x2, int y2,
+                        int w, int h) const
+    {
+        int dx = x2 - x1;
+        int dy = y2 - y1;
+        if(dx < 0) dx = -dx;
+        if(dy < 0) dy = -dy;
+        if((dx | dy) == 0 || m_width <= 0) return false;
+
+        s.vertical = dy > dx;
+
+        int a1, b1, a2, b2, len_a, len_b;
+        if(s.vertical)
+        {
+            a1 = y1; b1 = x1; a2 = y2; b2 = x2;
+            len_a = h;
+            len_b = w;
+        }
+        else
+        {
+            a1 = x1; b1 = y1; a2 = x2; b2 = y2;
+            len_a = w;
+            len_b = h;
+        }
+        if(a1 > a2)
+        {
+            int t;
+            t = a1; a1 = a2; a2 = t;
+            t = b1; b1 = b2; b2 = t;
+        }
+
+        int64 da = a2 - a1;
+        int64 db = b2 - b1;
+        int64 half = int64(m_width) * 128 * isqrt(int64u(da * da + db * db)) / da;
+
+        int first = a1 >> poly_base_shift;
+        int last  = (a2 - 1) >> poly_base_shift;
+        unsigned cover1 = ((first + 1) << poly_base_shift) - a1;
+        unsigned cover2 = a2 - (last << poly_base_shift);
+        if(first == last)
+        {
+            cover1 = unsigned(da);
+            cover2 = poly_base_size;
+        }
+
+        int64 margin = (half >> 8) + 2 * poly_base_size;
+        int64 lo = -margin;
+        int64 hi = int64(len_b) * poly_base_size + margin;
+        if(db == 0)
+        {
+            if(b1 < lo || b1 > hi) return false;
+        }
+        else
+        {
+            int64 al = a1 + (lo - b1) * da / db;
+            int64 ah = a1 + (hi - b1) * da / db;
+            if(al > ah) { int64 t = al; al = ah; ah = t; }
+            al >>= poly_base_shift;
+            ah >>= poly_base_shift;
+            if(al > first) { first = (al > last) ? last + 1 : int(al); cover1 = poly_base_size; }
+            if(ah < last)  { last = (ah < first) ? first - 1 : int(ah); cover2 = poly_base_size; }
+        }
+        if(first < 0)      { first = 0;         cover1 = poly_base_size; }
+        if(last >= len_a)  { last = len_a - 1;  cover2 = poly_base_size; }
+        if(first > last) return false;
+
+        s.first  = first;
+        s.last   = last;
+        s.cover1 = cover1;
+        s.cover2 = cover2;
+        s.half   = int(half);
+        s.step   = int((db << 16) / da);
+        s.center = int((int64(b1) << 8) +
+                       ((int64(first) * poly_base_size +
+                         poly_base_size / 2 - a1) * db << 8) / da);
+        return true;
+    }
+
+}
+
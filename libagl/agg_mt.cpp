@@ -0,0 +1,213 @@
+//----------------------------------------------------------------------------
+// Anti-Grain Geometry - Version 2.1 Lite
+// Copyright (C) 2002-2003 Maxim Shemanarev (McSeem)
+//
+// Permission to copy, use, modify, sell and distribute this software
+// is granted provided this copyright notice appears in all copies.
+// This software is provided "as is" without express or implied
+// warranty, and with no claim as to its suitability for any purpose.
+//
+//----------------------------------------------------------------------------
+//
+// Class thread_pool - implementation. Host builds only.
+//
+//----------------------------------------------------------------------------
+
+#include <unistd.h>
+#include "agg_mt.h"
+
+
+namespace agg
+{
+
+    //------------------------------------------------------------------------
+    // A range of jobs is packed into one 64-bit word, the front in the low
+    // half and the back in the high half, so that both the owner and the
+    // thieves can update it with a single compare-and-swap.
+    static inline unsigned long long make_range(unsigned front, unsigned back)
+    {
+        return (unsigned long long)front | ((unsigned long long)back << 32);
+    }
+
+
+    //------------------------------------------------------------------------
+    thread_pool::~thread_pool()
+    {
+        pthread_mutex_lock(&m_mutex);
+        m_quit = true;
+        pthread_cond_broadcast(&m_start);
+        pthread_mutex_unlock(&m_mutex);
+
+        unsigned i;
+        for(i = 1; i < m_num_threads; i++)
+        {
+            pthread_join(m_workers[i].thread, 0);
+        }
+
+        pthread_cond_destroy(&m_done);
+        pthread_cond_destroy(&m_start);
+        pthread_mutex_destroy(&m_mutex);
+        delete [] m_ranges;
+        delete [] m_workers;
+    }
+
+
+    //------------------------------------------------------------------------
+    thread_pool::thread_pool(unsigned num_threads) :
+        m_num_threads(num_threads),
+        m_workers(0),
+        m_ranges(0),
+        m_generation(0),
+        m_busy(0),
+        m_quit(false),
+        m_func(0),
+        m_arg(0)
+    {
+        if(m_num_threads == 0)
+        {
+            long n = sysconf(_SC_NPROCESSORS_ONLN);
+            m_num_threads = (n > 0) ? unsigned(n) : 1;
+        }
+
+        pthread_mutex_init(&m_mutex, 0);
+        pthread_cond_init(&m_start, 0);
+        pthread_cond_init(&m_done, 0);
+
+        m_workers = new worker [m_num_threads];
+        m_ranges  = new unsigned long long [m_num_threads];
+
+        unsigned i;
+        for(i = 0; i < m_num_threads; i++)
+        {
+            m_workers[i].pool  = this;
+            m_workers[i].index = i;
+            m_ranges[i] = 0;
+        }
+
+        // Thread 0 is the caller of run()
+        for(i = 1; i < m_num_threads; i++)
+        {
+            pthread_create(&m_workers[i].thread, 0, thread_entry, m_workers + i);
+        }
+    }
+
+
+    //------------------------------------------------------------------------
+    void* thread_pool::thread_entry(void* arg)
+    {
+        worker* w = (worker*)arg;
+        thread_pool* pool = w->pool;
+        unsigned generation = 0;
+
+        pthread_mutex_lock(&pool->m_mutex);
+        for(;;)
+        {
+            while(pool->m_generation == generation && !pool->m_quit)
+            {
+                pthread_cond_wait(&pool->m_start, &pool->m_mutex);
+            }
+            if(pool->m_quit) break;
+            generation = pool->m_generation;
+            pthread_mutex_unlock(&pool->m_mutex);
+
+            pool->work(w->index);
+
+            pthread_mutex_lock(&pool->m_mutex);
+            if(--pool->m_busy == 0)
+            {
+                pthread_cond_signal(&pool->m_done);
+            }
+        }
+        pthread_mutex_unlock(&pool->m_mutex);
+        return 0;
+    }
+
+
+    //------------------------------------------------------------------------
+    void thread_pool::run(job_func func, void* arg, unsigned num_jobs)
+    {
+        if(num_jobs == 0) return;
+
+        unsigned i;
+        for(i = 0; i < m_num_threads; i++)
+        {
+            m_ranges[i] = make_range(unsigned((unsigned long long)num_jobs * i /
+                                              m_num_threads),
+                                     unsigned((unsigned long long)num_jobs * (i + 1) /
+                                              m_num_threads));
+        }
+
+        pthread_mutex_lock(&m_mutex);
+        m_func = func;
+        m_arg  = arg;
+        m_busy = m_num_threads - 1;
+        m_generation++;
+        pthread_cond_broadcast(&m_start);
+        pthread_mutex_unlock(&m_mutex);
+
+        work(0);
+
+        pthread_mutex_lock(&m_mutex);
+        while(m_busy)
+        {
+            pthread_cond_wait(&m_done, &m_mutex);
+        }
+        pthread_mutex_unlock(&m_mutex);
+    }
+
+
+    //------------------------------------------------------------------------
+    void thread_pool::work(unsigned thread)
+    {
+        unsigned job;
+        while(take(thread, &job) || steal(thread, &job))
+        {
+            m_func(m_arg, job, thread);
+        }
+    }
+
+
+    //------------------------------------------------------------------------
+    bool thread_pool::take(unsigned thread, unsigned* job)
+    {
+        volatile unsigned long long* range = m_ranges + thread;
+        for(;;)
+        {
+            unsigned long long r = *range;
+            unsigned front = unsigned(r);
+            unsigned back  = unsigned(r >> 32);
+            if(front >= back) return false;
+            if(__sync_bool_compare_and_swap(range, r, make_range(front + 1, back)))
+            {
+                *job = front;
+                return true;
+            }
+        }
+    }
+
+
+    //------------------------------------------------------------------------
+    bool thread_pool::steal(unsigned thread, unsigned* job)
+    {
+        unsigned i;
+        for(i = 1; i < m_num_threads; i++)
+        {
+            volatile unsigned long long* range =
+                m_ranges + (thread + i) % m_num_threads;
+            for(;;)
+            {
+                unsigned long long r = *range;
+                unsigned front = unsigned(r);
+                unsigned back  = unsigned(r >> 32);
+                if(front >= back) break;
+                if(__sync_bool_compare_and_swap(range, r, make_range(front, back - 1)))
+                {
+                    *job = back - 1;
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+}
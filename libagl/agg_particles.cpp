@@ -0,0 +1,202 @@
+//----------------------------------------------------------------------------
+// Anti-Grain Geometry - Version 2.1 Lite
+// Copyright (C) 2002-2003 Maxim Shemanarev (McSeem)
+//
+// Permission to copy, use, modify, sell and distribute this software
+// is granted provided this copyright notice appears in all copies.
+// This software is provided "as is" without express or implied
+// warranty, and with no claim as to its suitability for any purpose.
+//
+//----------------------------------------------------------------------------
+//
+// Class particle_masks - implementation.
+//
+//----------------------------------------------------------------------------
+
+#include <string.h>
+#include "agg_particles.h"
+#include "agg_curves.h"
+
+
+namespace agg
+{
+
+    //------------------------------------------------------------------------
+    // Collects the scanlines of the rasterizer in a buffer of covers
+    class particle_mask_buffer
+    {
+    public:
+        particle_mask_buffer(int8u* buf, int size) : m_buf(buf), m_size(size) {}
+
+        void render(const scanline& sl, const rgba8&)
+        {
+            int y = sl.y();
+            if(y < 0 || y >= m_size) return;
+            int base_x = sl.base_x();
+            unsigned num_spans = sl.num_spans();
+            scanline::iterator span(sl);
+            do
+            {
+                int x = span.next() + base_x;
+                int num_pix = span.num_pix();
+                const int8u* covers = span.covers();
+                int n = (num_pix < 0) ? -num_pix : num_pix;
+                for(; n; --n, ++x)
+                {
+                    if(x >= 0 && x < m_size)
+                    {
+                        m_buf[y * m_size + x] = *covers;
+                    }
+                    if(num_pix > 0) ++covers;
+                }
+            }
+            while(--num_spans);
+        }
+
+    private:
+        int8u* m_buf;
+        int    m_size;
+    };
+
+
+
+    //------------------------------------------------------------------------
+    particle_masks::particle_masks() :
+        m_num_radii(0),
+        m_radius_shift(0),
+        m_offset_shift(0)
+    {
+    }
+
+
+    //------------------------------------------------------------------------
+    void particle_masks::init(int max_radius,
+                              unsigned radius_shift,
+                              unsigned offset_shift)
+    {
+        if(max_radius > max_radius_limit) max_radius = max_radius_limit;
+        if(offset_shift > max_offset_shift) offset_shift = max_offset_shift;
+
+        m_masks.remove_all();
+        m_rows.remove_all();
+        m_covers.remove_all();
+        m_radius_shift = radius_shift;
+        m_offset_shift = offset_shift;
+        m_num_radii    = (max_radius > 0) ? unsigned(max_radius) >> radius_shift : 0;
+
+        unsigned num_offsets = 1 << offset_shift;
+        int      offset_step = poly_base_size >> offset_shift;
+        unsigned ri;
+        for(ri = 1; ri <= m_num_radii; ri++)
+        {
+            unsigned oy;
+            for(oy = 0; oy < num_offsets; oy++)
+            {
+                unsigned ox;
+                for(ox = 0; ox < num_offsets; ox++)
+                {
+                    add_mask(int(ri << radius_shift),
+                             int(ox) * offset_step,
+                             int(oy) * offset_step);
+                }
+            }
+        }
+    }
+
+
+    //------------------------------------------------------------------------
+    // Renders the disc of radius r with the center at (cx, cy) subpixels
+    // of the pixel (0, 0) and adds its rows.
+    void particle_masks::add_mask(int r, int cx, int cy)
+    {
+        int pad  = (r >> poly_base_shift) + 2;
+        int size = pad * 2;
+        int8u* buf = new int8u [size * size];
+        memset(buf, 0, size * size);
+
+        particle_mask_buffer mb(buf, size);
+        rasterizer ras;
+        ellipse e(pad * poly_base_size + cx, pad * poly_base_size + cy, r, r);
+        ras.add_path(e);
+        ras.render(mb, rgba8(0, 0, 0));
+
+        mask m;
+        m.y        = 0;
+        m.x1       = size;
+        m.x2       = 0;
+        m.num_rows = 0;
+        m.rows     = m_rows.size();
+
+        int y1 = -1;
+        int y2 = -1;
+        int y;
+        for(y = 0; y < size; y++)
+        {
+            const int8u* p = buf + y * size;
+            int x;
+            for(x = 0; x < size; x++)
+            {
+                if(p[x])
+                {
+                    if(y1 < 0) y1 = y;
+                    y2 = y;
+                    break;
+                }
+            }
+        }
+
+        for(y = y1; y >= 0 && y <= y2; y++)
+        {
+            const int8u* p = buf + y * size;
+            int xl = 0;
+            int xr = size - 1;
+            while(xl < size && p[xl] == 0) ++xl;
+            while(xr > xl && p[xr] == 0) --xr;
+
+            row rw;
+            rw.x         = int16(xl - pad);
+            rw.num_left  = 0;
+            rw.num_solid = 0;
+            rw.num_right = 0;
+            rw.covers    = m_covers.size();
+            if(xl < size)
+            {
+                // The run of the full cover, if it's the only one
+                int s = xl;
+                while(s <= xr && p[s] != 255) ++s;
+                int e = xr;
+                while(e > s && p[e] != 255) --e;
+                int i;
+                for(i = s; i <= e; i++) if(p[i] != 255) break;
+                if(s > xr || i <= e) s = e = xr + 1;
+                else ++e;
+
+                rw.num_left  = int16(s - xl);
+                rw.num_solid = int16(e - s);
+                rw.num_right = int16(xr + 1 - e);
+                if(rw.num_left)  memcpy(m_covers.allocate(rw.num_left),  p + xl, rw.num_left);
+                if(rw.num_right) memcpy(m_covers.allocate(rw.num_right), p + e,  rw.num_right);
+
+                if(xl - pad < m.x1)     m.x1 = xl - pad;
+                if(xr + 1 - pad > m.x2) m.x2 = xr + 1 - pad;
+            }
+            m_rows.add(rw);
+            ++m.num_rows;
+        }
+        if(m.num_rows) m.y = y1 - pad;
+        m_masks.add(m);
+
+        delete [] buf;
+    }
+
+
+    //------------------------------------------------------------------------
+    unsigned particle_masks::byte_size() const
+    {
+        return m_masks.size() * sizeof(mask) +
+               m_rows.size()  * sizeof(row) +
+               m_covers.size();
+    }
+
+}
+
@@ -0,0 +1,98 @@
+//----------------------------------------------------------------------------
+// Anti-Grain Geometry - Version 2.1 Lite
+// Copyright (C) 2002-2003 Maxim Shemanarev (McSeem)
+//
+// Permission to copy, use, modify, sell and distribute this software
+// is granted provided this copyright notice appears in all copies.
+// This software is provided "as is" without express or implied
+// warranty, and with no claim as to its suitability for any purpose.
+//
+//----------------------------------------------------------------------------
+//
+// Class path_storage - implementation.
+//
+//----------------------------------------------------------------------------
+
+#include "agg_path_storage.h"
+
+
+namespace agg
+{
+
+    //------------------------------------------------------------------------
+    path_storage::~path_storage()
+    {
+        free_all();
+    }
+
+
+    //------------------------------------------------------------------------
+    path_storage::path_storage() :
+        m_total_vertices(0),
+        m_total_blocks(0),
+        m_max_blocks(0),
+        m_coord_blocks(0),
+        m_cmd_blocks(0),
+        m_iterator(0)
+    {
+    }
+
+
+    //------------------------------------------------------------------------
+    void path_storage::free_all()
+    {
+        unsigned i;
+        for(i = 0; i < m_total_blocks; i++)
+        {
+            delete [] m_coord_blocks[i];
+        }
+        delete [] m_coord_blocks;
+        m_total_vertices = 0;
+        m_total_blocks   = 0;
+        m_max_blocks     = 0;
+        m_coord_blocks   = 0;
+        m_cmd_blocks     = 0;
+        m_iterator       = 0;
+    }
+
+
+    //------------------------------------------------------------------------
+    unsigned path_storage::start_new_path()
+    {
+        if(m_total_vertices && command(m_total_vertices - 1) != path_cmd_stop)
+        {
+            add_vertex(0, 0, path_cmd_stop);
+        }
+        return m_total_vertices;
+    }
+
+
+    //------------------------------------------------------------------------
+    // The coordinates and the commands of a block are one allocation. The
+    // pointers to the blocks are in one array too, the coordinates in the
+    // first half and the commands in the second one.
+    void path_storage::allocate_block(unsigned nb)
+    {
+        if(nb >= m_max_blocks)
+        {
+            int** blocks = new int* [(m_max_blocks + block_pool) * 2];
+            if(m_coord_blocks)
+            {
+                memcpy(blocks, m_coord_blocks, m_max_blocks * sizeof(int*));
+                memcpy(blocks + m_max_blocks + block_pool,
+                       m_cmd_blocks,
+                       m_max_blocks * sizeof(int8u*));
+                delete [] m_coord_blocks;
+            }
+            m_coord_blocks = blocks;
+            m_cmd_blocks   = (int8u**)(blocks + m_max_blocks + block_pool);
+            m_max_blocks  += block_pool;
+        }
+        m_coord_blocks[nb] = new int [block_size * 2 +
+                                      block_size / sizeof(int)];
+        m_cmd_blocks[nb]   = (int8u*)(m_coord_blocks[nb] + block_size * 2);
+        m_total_blocks++;
+    }
+
+}
+
@@ -0,0 +1,99 @@
+//----------------------------------------------------------------------------
+// Anti-Grain Geometry - Version 2.1 Lite
+// Copyright (C) 2002-2003 Maxim Shemanarev (McSeem)
+//
+// Permission to copy, use, modify, sell and distribute this software
+// is granted provided this copyright notice appears in all copies.
+// This software is provided "as is" without express or implied
+// warranty, and with no claim as to its suitability for any purpose.
+//
+//----------------------------------------------------------------------------
+//
+// Class scanline_storage - implementation.
+//
+//----------------------------------------------------------------------------
+
+#include "agg_scanline_storage.h"
+
+
+namespace agg
+{
+
+    //------------------------------------------------------------------------
+    scanline_storage::scanline_storage() :
+        m_min_x( 0x7FFFFFFF),
+        m_min_y( 0x7FFFFFFF),
+        m_max_x(-0x7FFFFFFF),
+        m_max_y(-0x7FFFFFFF)
+    {
+    }
+
+
+    //------------------------------------------------------------------------
+    void scanline_storage::reset()
+    {
+        m_rows.remove_all();
+        m_spans.remove_all();
+        m_covers.remove_all();
+        m_min_x =  0x7FFFFFFF;
+        m_min_y =  0x7FFFFFFF;
+        m_max_x = -0x7FFFFFFF;
+        m_max_y = -0x7FFFFFFF;
+    }
+
+
+    //------------------------------------------------------------------------
+    void scanline_storage::render(const scanline& sl, const rgba8&)
+    {
+        int y = sl.y();
+        int base_x = sl.base_x();
+        unsigned num_spans = sl.num_spans();
+        scanline::iterator span(sl);
+
+        row_info row;
+        row.y         = y;
+        row.start     = m_spans.size();
+        row.num_spans = num_spans;
+        m_rows.add(row);
+
+        if(y < m_min_y) m_min_y = y;
+        if(y > m_max_y) m_max_y = y;
+
+        do
+        {
+            span_info sp;
+            sp.x      = span.next() + base_x;
+            sp.len    = span.num_pix();
+            sp.covers = m_covers.size();
+
+            unsigned num_pix = unsigned((sp.len < 0) ? -sp.len : sp.len);
+            if(sp.len < 0) m_covers.add(*span.covers());
+            else memcpy(m_covers.allocate(num_pix), span.covers(), num_pix);
+            m_spans.add(sp);
+
+            if(sp.x < m_min_x) m_min_x = sp.x;
+            if(sp.x + int(num_pix) - 1 > m_max_x) m_max_x = sp.x + int(num_pix) - 1;
+        }
+        while(--num_spans);
+    }
+
+
+    //------------------------------------------------------------------------
+    unsigned scanline_storage::byte_size() const
+    {
+        return m_rows.size()   * sizeof(row_info) + 
+               m_spans.size()  * sizeof(span_info) + 
+               m_covers.size();
+    }
+
+
+    //------------------------------------------------------------------------
+    unsigned scanline_storage::allocated_size() const
+    {
+        return m_rows.capacity()   * sizeof(row_info) + 
+               m_spans.capacity()  * sizeof(span_info) + 
+               m_covers.capacity();
+    }
+
+}
+
@@ -0,0 +1,359 @@
+//----------------------------------------------------------------------------
+// Anti-Grain Geometry - Version 2.1 Lite
+// Copyright (C) 2002-2003 Maxim Shemanarev (McSeem)
+//
+// Permission to copy, use, modify, sell and distribute this software
+// is granted provided this copyright notice appears in all copies.
+// This software is provided "as is" without express or implied
+// warranty, and with no claim as to its suitability for any purpose.
+//
+//----------------------------------------------------------------------------
+//
+// The SIMD loops of agg_span_simd.h - implementation.
+//
+// The scalar blend of a channel is
+//
+//     d = ((c - x) * alpha + (x << 16)) >> 16 = x + floor((c - x) * alpha / 65536)
+//
+// with alpha = cover * c.a in [0...65025]. The difference fits 16 bits
+// (10-bit channels too), alpha fits 16 bits unsigned, and the floor is
+// the high half of the product. _mm_mulhi_epi16() takes alpha as signed,
+// that is, alpha - 65536 when it's >= 32768, so the high half is less by
+// exactly (c - x) then, which is added back. The result is the same as
+// of the scalar loop, bit by bit. The 10-bit AVX2 loop simply does the
+// scalar arithmetic in 32-bit lanes.
+//
+//----------------------------------------------------------------------------
+
+#include <string.h>
+#include "agg_span_simd.h"
+
+#if defined(__i386__) || defined(__x86_64__)
+#include <immintrin.h>
+#define AGG_SPAN_SIMD_X86
+#endif
+
+
+namespace agg
+{
+
+    //------------------------------------------------------------------------
+    span_simd_funcs span_simd = { 0, 0, 0 };
+
+    static span_simd_e s_level = span_simd_scalar;
+
+
+    //------------------------------------------------------------------------
+    static inline unsigned blend_channel(int c, int x, int alpha)
+    {
+        return unsigned((((c - x) * alpha) + (x << 16)) >> 16);
+    }
+
+    // The pixels that don't make a whole vector
+    static inline void blend32_tail(unsigned char* p, unsigned count,
+                                    const unsigned char* covers,
+                                    const unsigned char* color, unsigned alpha)
+    {
+        for(; count; --count, p += 4)
+        {
+            int a = int(covers ? *covers++ * alpha : alpha);
+            p[0] = (unsigned char)blend_channel(color[0], p[0], a);
+            p[1] = (unsigned char)blend_channel(color[1], p[1], a);
+            p[2] = (unsigned char)blend_channel(color[2], p[2], a);
+            p[3] = (unsigned char)blend_channel(color[3], p[3], a);
+        }
+    }
+
+    static inline void blend101010_tail(unsigned* p, unsigned count,
+                                        const unsigned char* covers,
+                                        unsigned r, unsigned g, unsigned b,
+                                        unsigned alpha)
+    {
+        for(; count; --count, ++p)
+        {
+            int a = int(covers ? *covers++ * alpha : alpha);
+            unsigned dr = blend_channel(r, (*p >> 20) & 0x3ff, a);
+            unsigned dg = blend_channel(g, (*p >> 10) & 0x3ff, a);
+            unsigned db = blend_channel(b, *p & 0x3ff, a);
+            *p = (dr << 20) | (dg << 10) | db;
+        }
+    }
+
+
+#ifdef AGG_SPAN_SIMD_X86
+
+    //------------------------------------------------------------------------
+    // x + floor((c - x) * a / 65536) in 16-bit lanes, a is unsigned
+    __attribute__((target("sse2")))
+    static inline __m128i blend16(__m128i x, __m128i c, __m128i a)
+    {
+        __m128i d = _mm_sub_epi16(c, x);
+        __m128i h = _mm_mulhi_epi16(d, a);
+        h = _mm_add_epi16(h, _mm_and_si128(_mm_srai_epi16(a, 15), d));
+        return _mm_add_epi16(x, h);
+    }
+
+    __attribute__((target("avx2")))
+    static inline __m256i blend16(__m256i x, __m256i c, __m256i a)
+    {
+        __m256i d = _mm256_sub_epi16(c, x);
+        __m256i h = _mm256_mulhi_epi16(d, a);
+        h = _mm256_add_epi16(h, _mm256_and_si256(_mm256_srai_epi16(a, 15), d));
+        return _mm256_add_epi16(x, h);
+    }
+
+
+    //------------------------------------------------------------------------
+    // 4 pixels per step
+    __attribute__((target("sse2")))
+    static void blend32_sse2(unsigned char* p, unsigned count,
+                             const unsigned char* covers,
+                             const unsigned char* color, unsigned alpha)
+    {
+        __m128i zero = _mm_setzero_si128();
+        __m128i c = _mm_setr_epi16(color[0], color[1], color[2], color[3],
+                                   color[0], color[1], color[2], color[3]);
+        __m128i a = _mm_set1_epi16(short(alpha));
+        __m128i a_lo = a;
+        __m128i a_hi = a;
+
+        for(; count >= 4; count -= 4, p += 16)
+        {
+            if(covers)
+            {
+                int cv;
+                memcpy(&cv, covers, 4);
+                covers += 4;
+                __m128i t = _mm_unpacklo_epi8(_mm_cvtsi32_si128(cv), zero);
+                t = _mm_mullo_epi16(t, a);
+                t = _mm_unpacklo_epi16(t, t);
+                a_lo = _mm_unpacklo_epi32(t, t);
+                a_hi = _mm_unpackhi_epi32(t, t);
+            }
+            __m128i v  = _mm_loadu_si128((const __m128i*)p);
+            __m128i lo = blend16(_mm_unpacklo_epi8(v, zero), c, a_lo);
+            __m128i hi = blend16(_mm_unpackhi_epi8(v, zero), c, a_hi);
+            _mm_storeu_si128((__m128i*)p, _mm_packus_epi16(lo, hi));
+        }
+        blend32_tail(p, count, covers, color, alpha);
+    }
+
+
+    //------------------------------------------------------------------------
+    // 8 pixels per step. The unpacking works within the 128-bit lanes, so
+    // the low half of a step is the pixels 0, 1, 4, 5 and the high one
+    // 2, 3, 6, 7, and the alphas are shuffled the same way.
+    __attribute__((target("avx2")))
+    static void blend32_avx2(unsigned char* p, unsigned count,
+                             const unsigned char* covers,
+                             const unsigned char* color, unsigned alpha)
+    {
+        __m256i zero = _mm256_setzero_si256();
+        __m256i c = _mm256_setr_epi16(color[0], color[1], color[2], color[3],
+                                      color[0], color[1], color[2], color[3],
+                                      color[0], color[1], color[2], color[3],
+                                      color[0], color[1], color[2], color[3]);
+        __m256i a = _mm256_set1_epi16(short(alpha));
+        __m256i a_lo = a;
+        __m256i a_hi = a;
+        __m256i shuffle_lo = _mm256_setr_epi8( 0, 1, 0, 1, 0, 1, 0, 1,
+                                               2, 3, 2, 3, 2, 3, 2, 3,
+                                               8, 9, 8, 9, 8, 9, 8, 9,
+                                              10,11,10,11,10,11,10,11);
+        __m256i shuffle_hi = _mm256_setr_epi8( 4, 5, 4, 5, 4, 5, 4, 5,
+                                               6, 7, 6, 7, 6, 7, 6, 7,
+                                              12,13,12,13,12,13,12,13,
+                                              14,15,14,15,14,15,14,15);
+
+        for(; count >= 8; count -= 8, p += 32)
+        {
+            if(covers)
+            {
+                __m128i t = _mm_cvtepu8_epi16(_mm_loadl_epi64((const __m128i*)covers));
+                covers += 8;
+                t = _mm_mullo_epi16(t, _mm256_castsi256_si128(a));
+                __m256i t2 = _mm256_broadcastsi128_si256(t);
+                a_lo = _mm256_shuffle_epi8(t2, shuffle_lo);
+                a_hi = _mm256_shuffle_epi8(t2, shuffle_hi);
+            }
+            __m256i v  = _mm256_loadu_si256((const __m256i*)p);
+            __m256i lo = blend16(_mm256_unpacklo_epi8(v, zero), c, a_lo);
+            __m256i hi = blend16(_mm256_unpackhi_epi8(v, zero), c, a_hi);
+            _mm256_storeu_si256((__m256i*)p, _mm256_packus_epi16(lo, hi));
+        }
+        blend32_tail(p, count, covers, color, alpha);
+    }
+
+
+    //------------------------------------------------------------------------
+    // 8 pixels per step, the channels of 10 bits are packed in 16-bit lanes
+    __attribute__((target("sse2")))
+    static void blend101010_sse2(unsigned* p, unsigned count,
+                                 const unsigned char* covers,
+                                 unsigned r, unsigned g, unsigned b,
+                                 unsigned alpha)
+    {
+        __m128i zero = _mm_setzero_si128();
+        __m128i mask = _mm_set1_epi32(0x3ff);
+        __m128i cr = _mm_set1_epi16(short(r));
+        __m128i cg = _mm_set1_epi16(short(g));
+        __m128i cb = _mm_set1_epi16(short(b));
+        __m128i ca = _mm_set1_epi16(short(alpha));
+        __m128i a  = ca;
+
+        for(; count >= 8; count -= 8, p += 8)
+        {
+            if(covers)
+            {
+                __m128i t = _mm_loadl_epi64((const __m128i*)covers);
+                covers += 8;
+                a = _mm_mullo_epi16(_mm_unpacklo_epi8(t, zero), ca);
+            }
+            __m128i v0 = _mm_loadu_si128((const __m128i*)p);
+            __m128i v1 = _mm_loadu_si128((const __m128i*)(p + 4));
+            __m128i x;
+
+            x = _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(v0, 20), mask),
+                                _mm_and_si128(_mm_srli_epi32(v1, 20), mask));
+            __m128i dr = blend16(x, cr, a);
+            x = _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(v0, 10), mask),
+                                _mm_and_si128(_mm_srli_epi32(v1, 10), mask));
+            __m128i dg = blend16(x, cg, a);
+            x = _mm_packs_epi32(_mm_and_si128(v0, mask),
+                                _mm_and_si128(v1, mask));
+            __m128i db = blend16(x, cb, a);
+
+            v0 = _mm_or_si128(_mm_or_si128(_mm_slli_epi32(_mm_unpacklo_epi16(dr, zero), 20),
+                                           _mm_slli_epi32(_mm_unpacklo_epi16(dg, zero), 10)),
+                              _mm_unpacklo_epi16(db, zero));
+            v1 = _mm_or_si128(_mm_or_si128(_mm_slli_epi32(_mm_unpackhi_epi16(dr, zero), 20),
+                                           _mm_slli_epi32(_mm_unpackhi_epi16(dg, zero), 10)),
+                              _mm_unpackhi_epi16(db, zero));
+            _mm_storeu_si128((__m128i*)p, v0);
+            _mm_storeu_si128((__m128i*)(p + 4), v1);
+        }
+        blend101010_tail(p, count, covers, r, g, b, alpha);
+    }
+
+
+    //------------------------------------------------------------------------
+    // 8 pixels per step, the scalar arithmetic in 32-bit lanes
+    __attribute__((target("avx2")))
+    static void blend101010_avx2(unsigned* p, unsigned count,
+                                 const unsigned char* covers,
+                                 unsigned r, unsigned g, unsigned b,
+                                 unsigned alpha)
+    {
+        __m256i mask = _mm256_set1_epi32(0x3ff);
+        __m256i cr = _mm256_set1_epi32(int(r));
+        __m256i cg = _mm256_set1_epi32(int(g));
+        __m256i cb = _mm256_set1_epi32(int(b));
+        __m256i ca = _mm256_set1_epi32(int(alpha));
+        __m256i a  = ca;
+
+        for(; count >= 8; count -= 8, p += 8)
+        {
+            if(covers)
+            {
+                __m128i t = _mm_loadl_epi64((const __m128i*)covers);
+                covers += 8;
+                a = _mm256_mullo_epi32(_mm256_cvtepu8_epi32(t), ca);
+            }
+            __m256i v = _mm256_loadu_si256((const __m256i*)p);
+            __m256i x;
+
+            x = _mm256_and_si256(_mm256_srli_epi32(v, 20), mask);
+            __m256i dr = _mm256_srai_epi32(_mm256_add_epi32(_mm256_mullo_epi32(_mm256_sub_epi32(cr, x), a),
+                                                            _mm256_slli_epi32(x, 16)), 16);
+            x = _mm256_and_si256(_mm256_srli_epi32(v, 10), mask);
+            __m256i dg = _mm256_srai_epi32(_mm256_add_epi32(_mm256_mullo_epi32(_mm256_sub_epi32(cg, x), a),
+                                                            _mm256_slli_epi32(x, 16)), 16);
+            x = _mm256_and_si256(v, mask);
+            __m256i db = _mm256_srai_epi32(_mm256_add_epi32(_mm256_mullo_epi32(_mm256_sub_epi32(cb, x), a),
+                                                            _mm256_slli_epi32(x, 16)), 16);
+
+            v = _mm256_or_si256(_mm256_or_si256(_mm256_slli_epi32(dr, 20),
+                                                _mm256_slli_epi32(dg, 10)), db);
+            _mm256_storeu_si256((__m256i*)p, v);
+        }
+        blend101010_tail(p, count, covers, r, g, b, alpha);
+    }
+
+
+    //------------------------------------------------------------------------
+    __attribute__((target("sse2")))
+    static void fill32_sse2(unsigned* p, unsigned count, unsigned v)
+    {
+        __m128i c = _mm_set1_epi32(int(v));
+        for(; count >= 4; count -= 4, p += 4) _mm_storeu_si128((__m128i*)p, c);
+        for(; count; --count) *p++ = v;
+    }
+
+    __attribute__((target("avx2")))
+    static void fill32_avx2(unsigned* p, unsigned count, unsigned v)
+    {
+        __m256i c = _mm256_set1_epi32(int(v));
+        for(; count >= 8; count -= 8, p += 8) _mm256_storeu_si256((__m256i*)p, c);
+        for(; count; --count) *p++ = v;
+    }
+
+#endif
+
+
+    //------------------------------------------------------------------------
+    static span_simd_e cpu_level()
+    {
+#ifdef AGG_SPAN_SIMD_X86
+        __builtin_cpu_init();
+        if(__builtin_cpu_supports("avx2")) return span_simd_avx2;
+        if(__builtin_cpu_supports("sse2")) return span_simd_sse2;
+#endif
+        return span_simd_scalar;
+    }
+
+
+    //------------------------------------------------------------------------
+    span_simd_e span_simd_level()
+    {
+        return s_level;
+    }
+
+
+    //------------------------------------------------------------------------
+    span_simd_e span_simd_select(span_simd_e level)
+    {
+        span_simd_e cpu = cpu_level();
+        if(level > cpu) level = cpu;
+
+        span_simd.blend32     = 0;
+        span_simd.blend101010 = 0;
+        span_simd.fill32      = 0;
+#ifdef AGG_SPAN_SIMD_X86
+        if(level == span_simd_sse2)
+        {
+            span_simd.blend32     = blend32_sse2;
+            span_simd.blend101010 = blend101010_sse2;
+            span_simd.fill32      = fill32_sse2;
+        }
+        if(level == span_simd_avx2)
+        {
+            span_simd.blend32     = blend32_avx2;
+            span_simd.blend101010 = blend101010_avx2;
+            span_simd.fill32      = fill32_avx2;
+        }
+#endif
+        s_level = level;
+        return level;
+    }
+
+
+    //------------------------------------------------------------------------
+    // Until it's done the pointers are 0 and the scalar loops are used,
+    // so the order of the static initialization doesn't matter.
+    static struct span_simd_init
+    {
+        span_simd_init() { span_simd_select(span_simd_avx2); }
+    } s_span_simd_init;
+
+}
+
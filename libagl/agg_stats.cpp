@@ -0,0 +1,63 @@
+//----------------------------------------------------------------------------
+// Anti-Grain Geometry - Version 2.1 Lite
+// Copyright (C) 2002-2003 Maxim Shemanarev (McSeem)
+//
+// Permission to copy, use, modify, sell and distribute this software
+// is granted provided this copyright notice appears in all copies.
+// This software is provided "as is" without express or implied
+// warranty, and with no claim as to its suitability for any purpose.
+//
+//----------------------------------------------------------------------------
+//
+// The counters of agg_stats.h - implementation.
+//
+//----------------------------------------------------------------------------
+
+#include <string.h>
+#include "agg_stats.h"
+
+
+AGG_STATS_THREAD struct agg_stats agg_stats_counters;
+
+
+//----------------------------------------------------------------------------
+void agg_stats_reset(void)
+{
+    memset(&agg_stats_counters, 0, sizeof(agg_stats_counters));
+}
+
+
+//----------------------------------------------------------------------------
+void agg_stats_read(struct agg_stats* s)
+{
+    memcpy(s, &agg_stats_counters, sizeof(agg_stats_counters));
+}
+
+
+//----------------------------------------------------------------------------
+void agg_stats_add(struct agg_stats* s, const struct agg_stats* a)
+{
+    s->edges          += a->edges;
+    s->cells          += a->cells;
+    s->dropped_cells  += a->dropped_cells;
+    s->sorted_cells   += a->sorted_cells;
+    s->sort_compares  += a->sort_compares;
+    s->radix_passes   += a->radix_passes;
+    s->scanlines      += a->scanlines;
+    s->spans          += a->spans;
+    s->solid_pixels   += a->solid_pixels;
+    s->partial_pixels += a->partial_pixels;
+    s->sort_cycles    += a->sort_cycles;
+    s->sweep_cycles   += a->sweep_cycles;
+}
+
+
+//----------------------------------------------------------------------------
+int agg_stats_enabled(void)
+{
+#ifdef AGG_STATS
+    return 1;
+#else
+    return 0;
+#endif
+}
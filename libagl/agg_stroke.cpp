@@ -0,0 +1,437 @@
+//----------------------------------------------------------------------------
+// Anti-Grain Geometry - Version 2.1 Lite
+// Copyright (C) 2002-2003 Maxim Shemanarev (McSeem)
+//
+// Permission to copy, use, modify, sell and distribute this software
+// is granted provided this copyright notice appears in all copies.
+// This software is provided "as is" without express or implied
+// warranty, and with no claim as to its suitability for any purpose.
+//
+//----------------------------------------------------------------------------
+//
+// Class stroker - implementation.
+//
+// Every segment gets its unit normal n in 2.30. The "left" side of a
+// polyline is offset by n * width/2, the right one is the left side of
+// the reversed polyline, so one function makes the joins of both sides.
+// A join is the outer one if the polyline turns away from n.
+//
+//----------------------------------------------------------------------------
+
+#include "agg_stroke.h"
+
+
+namespace agg
+{
+
+    //------------------------------------------------------------------------
+    static inline int mul_q30(int64 a, int b)
+    {
+        return int((a * b + (1 << 29)) >> 30);
+    }
+
+
+    //------------------------------------------------------------------------
+    stroker::stroker() :
+        m_width(poly_base_size),
+        m_half_width(poly_base_size / 2),
+        m_line_join(miter_join),
+        m_line_cap(butt_cap),
+        m_miter_den(0),
+        m_tolerance(curve_tolerance),
+        m_arc_steps(0),
+        m_arc_cos(0),
+        m_arc_sin(0),
+        m_ready(false),
+        m_contour_start(0),
+        m_out_vertex(0)
+    {
+        miter_limit(4.0);
+        calc_steps();
+    }
+
+
+    //------------------------------------------------------------------------
+    void stroker::width(int w)
+    {
+        m_width      = w;
+        m_half_width = w / 2;
+        m_ready      = false;
+        calc_steps();
+    }
+
+
+    //------------------------------------------------------------------------
+    // The ratio of the miter length to the half width is
+    // sqrt(2 / (1 + cos(a))), where a is the angle between the normals.
+    void stroker::miter_limit(double ml)
+    {
+        m_miter_den = int64(2.0 / (ml * ml) * double(1 << 30));
+        m_ready     = false;
+    }
+
+
+    //------------------------------------------------------------------------
+    void stroker::tolerance(int t)
+    {
+        m_tolerance = t;
+        m_ready     = false;
+        calc_steps();
+    }
+
+
+    //------------------------------------------------------------------------
+    void stroker::calc_steps()
+    {
+        m_arc_steps = arc_steps(pi_q30, m_half_width, m_tolerance);
+        if(m_arc_steps < 2) m_arc_steps = 2;
+        sin_cos(pi_q30 / m_arc_steps, &m_arc_sin, &m_arc_cos);
+    }
+
+
+    //------------------------------------------------------------------------
+    void stroker::remove_all()
+    {
+        m_src.remove_all();
+        m_polylines.remove_all();
+        m_ready = false;
+    }
+
+
+    //------------------------------------------------------------------------
+    void stroker::move_to(int x, int y)
+    {
+        polyline pl;
+        pl.start        = m_src.size();
+        pl.num_vertices = 1;
+        pl.closed       = false;
+        m_polylines.add(pl);
+
+        src_vertex v;
+        v.x = x;
+        v.y = y;
+        m_src.add(v);
+        m_ready = false;
+    }
+
+
+    //------------------------------------------------------------------------
+    void stroker::line_to(int x, int y)
+    {
+        if(m_polylines.size() == 0)
+        {
+            move_to(x, y);
+            return;
+        }
+
+        // The coinciding vertices don't make any segment
+        const src_vertex& last = m_src.last();
+        if(last.x == x && last.y == y) return;
+
+        src_vertex v;
+        v.x = x;
+        v.y = y;
+        m_src.add(v);
+        m_polylines.last().num_vertices++;
+        m_ready = false;
+    }
+
+
+    //------------------------------------------------------------------------
+    void stroker::close_polygon()
+    {
+        if(m_polylines.size())
+        {
+            m_polylines.last().closed = true;
+            m_ready = false;
+        }
+    }
+
+
+    //------------------------------------------------------------------------
+    void stroker::rewind(unsigned)
+    {
+        if(!m_ready)
+        {
+            m_out.remove_all();
+            m_contour_start = 0;
+            if(m_half_width > 0)
+            {
+                unsigned i;
+                for(i = 0; i < m_polylines.size(); i++)
+                {
+                    stroke(m_polylines[i]);
+                }
+            }
+            m_ready = true;
+        }
+        m_out_vertex = 0;
+    }
+
+
+    //------------------------------------------------------------------------
+    void stroker::add_point(int x, int y)
+    {
+        unsigned size = m_out.size();
+        if(size > m_contour_start)
+        {
+            const out_vertex& last = m_out.last();
+            if(last.x == x && last.y == y) return;
+        }
+
+        out_vertex v;
+        v.x   = x;
+        v.y   = y;
+        v.cmd = (size == m_contour_start) ? path_cmd_move_to : path_cmd_line_to;
+        m_out.add(v);
+    }
+
+
+    //------------------------------------------------------------------------
+    void stroker::add_offset(int x, int y, int nx, int ny)
+    {
+        add_point(x + mul_q30(m_half_width, nx),
+                  y + mul_q30(m_half_width, ny));
+    }
+
+
+    //------------------------------------------------------------------------
+    void stroker::end_contour()
+    {
+        unsigned size = m_out.size();
+        if(size > m_contour_start + 1)
+        {
+            const out_vertex& first = m_out[m_contour_start];
+            const out_vertex& last  = m_out.last();
+            if(first.x == last.x && first.y == last.y) m_out.remove_last();
+        }
+
+        if(m_out.size() < m_contour_start + 3)
+        {
+            // Nothing to fill
+            while(m_out.size() > m_contour_start) m_out.remove_last();
+            return;
+        }
+
+        out_vertex v;
+        v.x   = 0;
+        v.y   = 0;
+        v.cmd = path_cmd_end_poly | path_flags_close;
+        m_out.add(v);
+        m_contour_start = m_out.size();
+    }
+
+
+    //------------------------------------------------------------------------
+    // Goes around v from the normal n1 to n2 in the positive direction
+    void stroker::calc_arc(const src_vertex& v,
+                           int nx1, int ny1,
+                           int nx2, int ny2)
+    {
+        add_offset(v.x, v.y, nx1, ny1);
+
+        int nx = nx1;
+        int ny = ny1;
+        unsigned i;
+        for(i = 0; i < m_arc_steps * 2; i++)
+        {
+            int t = nx;
+            nx = int((int64(t)  * m_arc_cos - int64(ny) * m_arc_sin + (1 << 29)) >> 30);
+            ny = int((int64(ny) * m_arc_cos + int64(t)  * m_arc_sin + (1 << 29)) >> 30);
+
+            // Stop as soon as (nx, ny) passes n2
+            if(int64(nx) * ny2 - int64(ny) * nx2 <= 0 &&
+               int64(nx) * nx2 + int64(ny) * ny2 > 0) break;
+
+            add_offset(v.x, v.y, nx, ny);
+        }
+
+        add_offset(v.x, v.y, nx2, ny2);
+    }
+
+
+    //------------------------------------------------------------------------
+    // From the normal n to -n around the end of the polyline
+    void stroker::calc_cap(const src_vertex& v, int nx, int ny)
+    {
+        switch(m_line_cap)
+        {
+        case butt_cap:
+            add_offset(v.x, v.y,  nx,  ny);
+            add_offset(v.x, v.y, -nx, -ny);
+            break;
+
+        case square_cap:
+            {
+                // The direction of the polyline is (-ny, nx)
+                int ox = mul_q30(m_half_width, nx);
+                int oy = mul_q30(m_half_width, ny);
+                add_point(v.x + ox - oy, v.y + oy + ox);
+                add_point(v.x - ox - oy, v.y - oy + ox);
+            }
+            break;
+
+        case round_cap:
+            calc_arc(v, nx, ny, -nx, -ny);
+            break;
+        }
+    }
+
+
+    //------------------------------------------------------------------------
+    void stroker::calc_join(const src_vertex& v,
+                            int nx1, int ny1,
+                            int nx2, int ny2,
+                            unsigned min_len)
+    {
+        int64 cross = int64(nx1) * ny2 - int64(ny1) * nx2;
+        int64 dot   = (int64(nx1) * nx2 + int64(ny1) * ny2) >> 30;
+
+        // 1 + cos(a) in 2.30. The miter is v + (n1 + n2) * width/2 / den.
+        int64 den = (int64(1) << 30) + dot;
+
+        if(cross < 0)
+        {
+            // The inner join. The miter point is used if its projection
+            // on the adjacent segments, width/2 * tan(a/2), falls within 
+            // their first halves. Otherwise the offset lines of the 
+            // segments around may cross each other, which turns the inner 
+            // side of a closed polyline inside out, so the side goes 
+            // through v itself.
+            int64 sin_a = (-cross) >> 30;
+            if(2 * int64(m_half_width) * sin_a <= int64(min_len) * den)
+            {
+                add_point(v.x + int(int64(nx1 + int64(nx2)) * m_half_width / den),
+                          v.y + int(int64(ny1 + int64(ny2)) * m_half_width / den));
+                return;
+            }
+            add_offset(v.x, v.y, nx1, ny1);
+            add_point(v.x, v.y);
+            add_offset(v.x, v.y, nx2, ny2);
+            return;
+        }
+
+        if(cross == 0 && dot > 0)
+        {
+            // Collinear
+            add_offset(v.x, v.y, nx1, ny1);
+            return;
+        }
+
+        switch(m_line_join)
+        {
+        case miter_join:
+            if(den >= m_miter_den && den > 0)
+            {
+                add_point(v.x + int(int64(nx1 + int64(nx2)) * m_half_width / den),
+                          v.y + int(int64(ny1 + int64(ny2)) * m_half_width / den));
+                break;
+            }
+            // Too long, bevel it
+            // fall through
+        case bevel_join:
+            add_offset(v.x, v.y, nx1, ny1);
+            add_offset(v.x, v.y, nx2, ny2);
+            break;
+
+        case round_join:
+            calc_arc(v, nx1, ny1, nx2, ny2);
+            break;
+        }
+    }
+
+
+    //------------------------------------------------------------------------
+    void stroker::stroke(const polyline& pl)
+    {
+        const src_vertex* v = &m_src[pl.start];
+        unsigned n = pl.num_vertices;
+        bool closed = pl.closed;
+
+        if(closed && n > 1 && v[n - 1].x == v[0].x && v[n - 1].y == v[0].y) n--;
+        if(n < 3) closed = false;
+
+        if(n == 1)
+        {
+            // A dot, only the caps
+            if(m_line_cap != butt_cap)
+            {
+                calc_cap(v[0], 0, -(1 << 30));
+                calc_cap(v[0], 0,   1 << 30);
+                end_contour();
+            }
+            return;
+        }
+
+        // The normals. The squared length is scaled up, so that the square
+        // root keeps at least 25 bits.
+        unsigned num_segments = closed ? n : n - 1;
+        unsigned i;
+        m_segments.remove_all();
+        for(i = 0; i < num_segments; i++)
+        {
+            const src_vertex& v1 = v[i];
+            const src_vertex& v2 = v[(i + 1 == n) ? 0 : i + 1];
+            int64 dx = int64(v2.x) - v1.x;
+            int64 dy = int64(v2.y) - v1.y;
+            int64u d2 = int64u(dx * dx + dy * dy);
+            int shift = 0;
+            while(d2 < (int64u(1) << 50))
+            {
+                d2 <<= 2;
+                shift++;
+            }
+            unsigned len = isqrt(d2);
+
+            segment seg;
+            seg.nx  = int(((dy << shift) << 30) / len);
+            seg.ny  = int(((-dx << shift) << 30) / len);
+            seg.len = len >> shift;
+            m_segments.add(seg);
+        }
+
+        const segment* s = &m_segments[0];
+        if(closed)
+        {
+            // Two contours: the left side forward, the right side backward
+            for(i = 0; i < n; i++)
+            {
+                const segment& s1 = s[(i == 0) ? n - 1 : i - 1];
+                const segment& s2 = s[i];
+                calc_join(v[i], s1.nx, s1.ny, s2.nx, s2.ny,
+                          (s1.len < s2.len) ? s1.len : s2.len);
+            }
+            end_contour();
+
+            for(i = n; i > 0; i--)
+            {
+                unsigned k = (i == n) ? 0 : i;
+                const segment& s1 = s[k];
+                const segment& s2 = s[(k == 0) ? n - 1 : k - 1];
+                calc_join(v[k], -s1.nx, -s1.ny, -s2.nx, -s2.ny,
+                          (s1.len < s2.len) ? s1.len : s2.len);
+            }
+            end_contour();
+            return;
+        }
+
+        // One contour: the left side, the end cap, the right side
+        // backward and the start cap
+        add_offset(v[0].x, v[0].y, s[0].nx, s[0].ny);
+        for(i = 1; i < n - 1; i++)
+        {
+            calc_join(v[i], s[i - 1].nx, s[i - 1].ny, s[i].nx, s[i].ny,
+                      (s[i - 1].len < s[i].len) ? s[i - 1].len : s[i].len);
+        }
+        calc_cap(v[n - 1], s[n - 2].nx, s[n - 2].ny);
+        for(i = n - 2; i > 0; i--)
+        {
+            calc_join(v[i], -s[i].nx, -s[i].ny, -s[i - 1].nx, -s[i - 1].ny,
+                      (s[i - 1].len < s[i].len) ? s[i - 1].len : s[i].len);
+        }
+        calc_cap(v[0], -s[0].nx, -s[0].ny);
+        end_contour();
+    }
+
+}
+
@@ -0,0 +1,72 @@
+//----------------------------------------------------------------------------
+// Anti-Grain Geometry - Version 2.1 Lite
+// Copyright (C) 2002-2003 Maxim Shemanarev (McSeem)
+//
+// Permission to copy, use, modify, sell and distribute this software
+// is granted provided this copyright notice appears in all copies.
+// This software is provided "as is" without express or implied
+// warranty, and with no claim as to its suitability for any purpose.
+//
+//----------------------------------------------------------------------------
+//
+// Class trans_affine - implementation.
+//
+//----------------------------------------------------------------------------
+
+#include "agg_trans_affine.h"
+
+
+namespace agg
+{
+
+    //------------------------------------------------------------------------
+    static inline int mul_affine(int a, int b)
+    {
+        return int((int64(a) * b + (1 << (affine_shift - 1))) >> affine_shift);
+    }
+
+
+    //------------------------------------------------------------------------
+    const trans_affine& trans_affine::multiply(const trans_affine& m)
+    {
+        int t0 = mul_affine(sx,  m.sx) + mul_affine(shy, m.shx);
+        int t2 = mul_affine(shx, m.sx) + mul_affine(sy,  m.shx);
+        int t4 = mul_affine(tx,  m.sx) + mul_affine(ty,  m.shx) + m.tx;
+        shy    = mul_affine(sx,  m.shy) + mul_affine(shy, m.sy);
+        sy     = mul_affine(shx, m.shy) + mul_affine(sy,  m.sy);
+        ty     = mul_affine(tx,  m.shy) + mul_affine(ty,  m.sy) + m.ty;
+        sx     = t0;
+        shx    = t2;
+        tx     = t4;
+        return *this;
+    }
+
+
+    //------------------------------------------------------------------------
+    const trans_affine& trans_affine::premultiply(const trans_affine& m)
+    {
+        trans_affine t = m;
+        *this = t.multiply(*this);
+        return *this;
+    }
+
+
+    //------------------------------------------------------------------------
+    // sin_cos() gives 2.30, the matrix is 16.16
+    trans_affine_rotation::trans_affine_rotation(int a)
+    {
+        int s;
+        int c;
+        sin_cos(int64(a) << (30 - curve_angle_shift), &s, &c);
+        s = (s + (1 << (29 - affine_shift))) >> (30 - affine_shift);
+        c = (c + (1 << (29 - affine_shift))) >> (30 - affine_shift);
+        sx  = c;
+        shy = s;
+        shx = -s;
+        sy  = c;
+        tx  = 0;
+        ty  = 0;
+    }
+
+}
+
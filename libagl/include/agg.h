@@ -20,6 +20,10 @@
 #define AGG_INCLUDED
 
 #include <string.h>
+#include "agg_stats.h"
+#ifdef AGG_SPAN_SIMD
+#include "agg_span_simd.h"
+#endif
 
 namespace agg
 {
@@ -30,7 +34,67 @@ namespace agg
     typedef unsigned short int16u;
     typedef signed int     int32;
     typedef unsigned int   int32u;
+    typedef signed long long   int64;
+    typedef unsigned long long int64u;
+
+
+
+    //========================================================================
+    // A simple growing array of POD values
+    //------------------------------------------------------------------------
+    template<class T> class pod_vector
+    {
+    public:
+        ~pod_vector() { delete [] m_array; }
+        pod_vector() : m_array(0), m_size(0), m_capacity(0) {}
+
+        void remove_all() { m_size = 0; }
+
+        void add(const T& v)
+        {
+            if(m_size >= m_capacity) grow(m_size + 1);
+            m_array[m_size++] = v;
+        }
+
+        // Appends num elements without initializing them
+        T* allocate(unsigned num)
+        {
+            if(m_size + num > m_capacity) grow(m_size + num);
+            T* p = m_array + m_size;
+            m_size += num;
+            return p;
+        }
+
+        void remove_last() { if(m_size) --m_size; }
 
+        unsigned size()     const { return m_size; }
+        unsigned capacity() const { return m_capacity; }
+
+        T&       operator [] (unsigned i)       { return m_array[i]; }
+        const T& operator [] (unsigned i) const { return m_array[i]; }
+
+        T&       last()       { return m_array[m_size - 1]; }
+        const T& last() const { return m_array[m_size - 1]; }
+
+    private:
+        pod_vector(const pod_vector<T>&);
+        const pod_vector<T>& operator = (const pod_vector<T>&);
+
+        void grow(unsigned size)
+        {
+            unsigned capacity = m_capacity ? m_capacity * 2 : 64;
+            if(capacity < size) capacity = size;
+            T* array = new T [capacity];
+            if(m_size) memcpy(array, m_array, m_size * sizeof(T));
+            delete [] m_array;
+            m_array    = array;
+            m_capacity = capacity;
+        }
+
+        T*       m_array;
+        unsigned m_size;
+        unsigned m_capacity;
+    };
 
 
     //========================================================================
@@ -199,6 +263,9 @@ namespace agg
     // Each span has initial X, length, and an array of bytes that determine the 
     // alpha-values for each pixel. So, the restriction of using this class is 256 
     // levels of Anti-Aliasing, which is quite enough for any practical purpose.
+    // The spans of add_span() are kept as runs: a negative length and only 
+    // one cover value for all the pixels, so that the interiors of the 
+    // shapes don't go through the array of covers at all.
     // Before using this class you should know the minimal and maximal pixel 
     // coordinates of your scanline. The protocol of using is:
     // 1. reset(min_x, max_x)
@@ -244,10 +311,11 @@ namespace agg
     //     const int8u covers* = span.covers(); // The array of the cover values
     //
     //     int num_pix = span.num_pix();        // Number of pixels of the span.
-    //                                          // Always greater than 0, still we
-    //                                          // shoud use "int" instead of 
-    //                                          // "unsigned" because it's more
-    //                                          // convenient for clipping
+    //                                          // Negative for a solid span, 
+    //                                          // whose cover for all the -num_pix
+    //                                          // pixels is *covers. Never 0.
+    //
+    //     ...Solid spans go to Span::blend_hline() here...
     //
     //     **************************************
     //     ...Perform horizontal clipping here...
@@ -295,12 +363,12 @@ namespace agg
                 return int(*m_cur_start_ptr - m_covers);
             }
 
-            int num_pix() const { return int(*m_cur_count); }
+            int num_pix() const { return *m_cur_count; }
             const int8u* covers() const { return *m_cur_start_ptr; }
 
         private:
             const int8u*        m_covers;
-            const int16u*       m_cur_count;
+            const int*          m_cur_count;
             const int8u* const* m_cur_start_ptr;
         };
 
@@ -324,26 +392,26 @@ namespace agg
         const scanline& operator = (const scanline&);
 
     private:
-        int      m_min_x;
-        unsigned m_max_len;
-        int      m_dx;
-        int      m_dy;
-        int      m_last_x;
-        int      m_last_y;
-        int8u*   m_covers;
-        int8u**  m_start_ptrs;
-        int16u*  m_counts;
-        unsigned m_num_spans;
-        int8u**  m_cur_start_ptr;
-        int16u*  m_cur_count;
+        int       m_min_x;
+        unsigned  m_max_len;
+        int       m_dx;
+        int       m_dy;
+        int       m_last_x;
+        int       m_last_y;
+        int8u*    m_covers;
+        int8u**   m_start_ptrs;
+        int*      m_counts;
+        unsigned  m_num_spans;
+        int8u**   m_cur_start_ptr;
+        int*      m_cur_count;
     };
 
 
     //------------------------------------------------------------------------
     inline void scanline::reset_spans()
     {
-        m_last_x        = 0x7FFF;
-        m_last_y        = 0x7FFF;
+        m_last_x        = 0x7FFFFFF0;
+        m_last_y        = 0x7FFFFFF0;
         m_cur_count     = m_counts;
         m_cur_start_ptr = m_start_ptrs;
         m_num_spans     = 0;
@@ -355,7 +423,7 @@ namespace agg
     {
         x -= m_min_x;
         m_covers[x] = (unsigned char)cover;
-        if(x == m_last_x+1)
+        if(x == m_last_x+1 && *m_cur_count > 0)
         {
             (*m_cur_count)++;
         }
@@ -406,6 +474,9 @@ namespace agg
     template<class Span> class renderer
     {
     public:
+        typedef Span span_type;
+        enum { pix_width = Span::pix_width };
+
         //--------------------------------------------------------------------
         renderer(rendering_buffer& rbuf) : m_rbuf(&rbuf)
         {
@@ -452,17 +523,20 @@ namespace agg
             int base_x = sl.base_x();
             unsigned char* row = m_rbuf->row(sl.y());
             scanline::iterator span(sl);
+            AGG_STATS_ADD(scanlines, 1);
 
             do
             {
                 int x = span.next() + base_x;
                 const int8u* covers = span.covers();
                 int num_pix = span.num_pix();
+                bool solid = num_pix < 0;
+                if(solid) num_pix = -num_pix;
                 if(x < 0)
                 {
                     num_pix += x;
                     if(num_pix <= 0) continue;
-                    covers -= x;
+                    if(!solid) covers -= x;
                     x = 0;
                 }
                 if(x + num_pix >= int(m_rbuf->width()))
@@ -470,11 +544,91 @@ namespace agg
                     num_pix = m_rbuf->width() - x;
                     if(num_pix <= 0) continue;
                 }
-                m_span.render(row, x, num_pix, covers, c);
+                AGG_STATS_ADD(spans, 1);
+                if(solid) AGG_STATS_ADD(solid_pixels, num_pix);
+                else      AGG_STATS_ADD(partial_pixels, num_pix);
+                if(solid) m_span.blend_hline(row, x, num_pix, c, *covers);
+                else      m_span.render(row, x, num_pix, covers, c);
             }
             while(--num_spans);
         }
 
+        //--------------------------------------------------------------------
+        // A span of covers and a solid span, see scanline, clipped to the 
+        // buffer. Used to replay the stored scanlines, see scanline_storage.
+        void blend_span(int x, int y, unsigned count, 
+                        const int8u* covers, const rgba8& c)
+        {
+            if(y < 0 || y >= int(m_rbuf->height())) return;
+            int num_pix = int(count);
+            if(x < 0)
+            {
+                num_pix += x;
+                if(num_pix <= 0) return;
+                covers -= x;
+                x = 0;
+            }
+            if(x + num_pix >= int(m_rbuf->width()))
+            {
+                num_pix = m_rbuf->width() - x;
+                if(num_pix <= 0) return;
+            }
+            AGG_STATS_ADD(spans, 1);
+            AGG_STATS_ADD(partial_pixels, num_pix);
+            m_span.render(m_rbuf->row(y), x, num_pix, covers, c);
+        }
+
+        void blend_hline(int x, int y, unsigned count, 
+                         unsigned cover, const rgba8& c)
+        {
+            if(y < 0 || y >= int(m_rbuf->height())) return;
+            int num_pix = int(count);
+            if(x < 0)
+            {
+                num_pix += x;
+                if(num_pix <= 0) return;
+                x = 0;
+            }
+            if(x + num_pix >= int(m_rbuf->width()))
+            {
+                num_pix = m_rbuf->width() - x;
+                if(num_pix <= 0) return;
+            }
+            AGG_STATS_ADD(spans, 1);
+            AGG_STATS_ADD(solid_pixels, num_pix);
+            m_span.blend_hline(m_rbuf->row(y), x, num_pix, c, cover);
+        }
+
+        // One pixel, clipped. Used by the renderers that step along the
+        // lines, see renderer_line_aa.
+        void blend_pixel(int x, int y, unsigned cover, const rgba8& c)
+        {
+            if(m_rbuf->inbox(x, y))
+            {
+                AGG_STATS_ADD(partial_pixels, 1);
+                m_span.blend_hline(m_rbuf->row(y), x, 1, c, cover);
+            }
+        }
+
+        //--------------------------------------------------------------------
+        // Copy the pixels [x...x+count) of row y to and from a row of the
+        // same pixel format, at the same offset, without clipping. Used by
+        // compound_rasterizer, which blends all the shapes of a pixel in
+        // the copy with the functions of the span and writes it back once.
+        void read_hline(int x, int y, unsigned count, int8u* row) const
+        {
+            memcpy(row + x * pix_width, 
+                   m_rbuf->row(y) + x * pix_width, 
+                   count * pix_width);
+        }
+
+        void write_hline(int x, int y, unsigned count, const int8u* row)
+        {
+            memcpy(m_rbuf->row(y) + x * pix_width, 
+                   row + x * pix_width, 
+                   count * pix_width);
+        }
+
         //--------------------------------------------------------------------
         rendering_buffer& rbuf() { return *m_rbuf; }
 
@@ -485,16 +639,17 @@ namespace agg
 
 
     //------------------------------------------------------------------------
-    // These constants determine the subpixel accuracy, to be more precise, 
-    // the number of bits of the fractional part of the coordinates. 
-    // The possible coordinate capacity in bits can be calculated by formula:
-    // sizeof(int) * 8 - poly_base_shift * 2, i.e, for 32-bit integers and
-    // 8-bits fractional part the capacity is 16 bits or [-32768...32767].
+    // These constants determine the default subpixel accuracy, to be more
+    // precise, the number of bits of the fractional part of the coordinates.
+    // The rasterizer can be instantiated with another accuracy, see
+    // rasterizer_aa; poly_base_shift is the one of the typedef "rasterizer",
+    // low_base_shift the one of "rasterizer_low".
     enum
     {
         poly_base_shift = 8,
         poly_base_size  = 1 << poly_base_shift,
-        poly_base_mask  = poly_base_size - 1
+        poly_base_mask  = poly_base_size - 1,
+        low_base_shift  = 6
     };
     
     //------------------------------------------------------------------------
@@ -503,293 +658,1749 @@ namespace agg
         return int(c * poly_base_size);
     }
 
+    //------------------------------------------------------------------------
+    // The types of the cell coordinates the outline can be instantiated
+    // with. The key of a cell keeps both coordinates, so it's twice as
+    // wide as the coordinate, and calc_type must hold the products of the
+    // subpixel size and a coordinate difference.
+    // 
+    // With int16 the pixel coordinates are limited to [-32768...32767],
+    // which is enough for any framebuffer and keeps the cells in 8 bytes.
+    // With int32 the limit is the range of the differences of the subpixel
+    // coordinates, i.e. about [-2^22...2^22] pixels with 8 bits of
+    // subpixel accuracy. The cells take 16 bytes and the line stepping
+    // uses 64-bit products, so it's meant for offline rendering only.
+    template<class Coord> struct coord_traits;
+
+    template<> struct coord_traits<int16>
+    {
+        typedef int32u key_type;
+        typedef int    calc_type;
+        enum { coord_bits = 16 };
+    };
+
+    template<> struct coord_traits<int32>
+    {
+        typedef int64u key_type;
+        typedef int64  calc_type;
+        enum { coord_bits = 32 };
+    };
+
     //------------------------------------------------------------------------
     // A pixel cell. There're no constructors defined and it was done 
     // intentionally in order to avoid extra overhead when allocating an 
     // array of cells.
-    struct cell
+    //
+    // The coordinates make a key that sorts in the scanline order (by Y,
+    // then by X), and the cover and the area share one 32-bit word. The
+    // cover of a single edge is within [-subpixel_size...subpixel_size]
+    // and its area fits 2*Shift+2 bits, so there is a lot of room; the rare
+    // accumulated values that don't fit are split by the outline into
+    // several cells with the same coordinates.
+    template<int Shift, class Coord> struct cell_aa
     {
-        int16 x;
-        int16 y;
-        int   packed_coord;
-        int   cover;
-        int   area;
-
-        void set(int x, int y, int c, int a);
-        void set_coord(int x, int y);
-        void set_cover(int c, int a);
-        void add_cover(int c, int a);
+        typedef typename coord_traits<Coord>::key_type key_type;
+
+        enum
+        {
+            coord_bits  = coord_traits<Coord>::coord_bits,
+            cover_bits  = Shift + 2,
+            cover_mask  = (1 << cover_bits) - 1,
+            cover_limit = 1 << (cover_bits - 1),
+            area_limit  = 1 << (32 - cover_bits - 1)
+        };
+
+        key_type key;
+        int32u   cover_area;
+
+        // The sign bit of a coordinate is inverted, so that the keys
+        // compare as unsigned numbers.
+        static int32u coord_sign() { return int32u(1) << (coord_bits - 1); }
+
+        static key_type make_key(int x, int y)
+        {
+            return (key_type(int32u(y) ^ coord_sign()) << coord_bits) |
+                   (key_type(int32u(x) ^ coord_sign()) &
+                    ((key_type(1) << coord_bits) - 1));
+        }
+
+        int x()     const { return Coord(int32u(key) ^ coord_sign()); }
+        int y()     const { return Coord(int32u(key >> coord_bits) ^ coord_sign()); }
+        int cover() const { return int32(cover_area << (32 - cover_bits)) >> 
+                                   (32 - cover_bits); }
+        int area()  const { return int32(cover_area) >> cover_bits; }
+
+        void set(key_type k, int c, int a)
+        {
+            key = k;
+            cover_area = (int32u(a) << cover_bits) | (int32u(c) & cover_mask);
+        }
     };
 
 
+    //========================================================================
+    // The memory of an outline: the blocks of block_size bytes for the
+    // cells, handed out by index, and one contiguous scratch area for
+    // everything that is made of them - the sorted cells, the index of
+    // the scanlines and the accumulation buffer. Nothing is freed until
+    // the arena is destroyed, so an outline reuses the memory from shape
+    // to shape and from frame to frame without touching the heap. The
+    // arena either allocates the memory from the heap on demand, up to a
+    // budget, or carves it out of a buffer supplied by the caller and
+    // never allocates anything. Either way the blocks and the scratch area
+    // together stay within the budget or the buffer. When the memory is
+    // exhausted the outline drops the cells and counts them, see
+    // outline_aa::num_dropped_cells().
+    //
+    // An arena serves one outline at a time, i.e., the rasterizers that
+    // are used in the same frame need separate arenas.
     //------------------------------------------------------------------------
-    // An internal class that implements the main rasterization algorithm.
-    // Used in the rasterizer. Should not be used direcly.
-    class outline
+    class cell_arena
     {
+    public:
         enum
         {
-            cell_block_shift = 12,
-            cell_block_size  = 1 << cell_block_shift,
-            cell_block_mask  = cell_block_size - 1,
-            cell_block_pool  = 256,
-            cell_block_limit = 1024
+            block_size     = 32768,
+            default_budget = 4 * 1024 * 1024
         };
 
-    public:
+        ~cell_arena();
 
-        ~outline();
-        outline();
+        // Allocates the memory from the heap, at most "budget" bytes
+        cell_arena(unsigned budget = default_budget);
 
-        void reset();
+        // Uses the buffer only. It must be aligned for the cells (8 bytes).
+        cell_arena(void* buf, unsigned size);
 
-        void move_to(int x, int y);
-        void line_to(int x, int y);
+        //--------------------------------------------------------------------
+        // Returns 0 if the block doesn't fit the memory. The blocks are
+        // requested in order, from 0, after rewind().
+        int8u* block(unsigned nb)
+        {
+            if(nb < m_num_used)
+            {
+                return m_buf ? m_buf + nb * block_size : m_blocks[nb];
+            }
+            return allocate_block(nb);
+        }
 
-        int min_x() const { return m_min_x; }
-        int min_y() const { return m_min_y; }
-        int max_x() const { return m_max_x; }
-        int max_y() const { return m_max_y; }
+        //--------------------------------------------------------------------
+        // The scratch area of size bytes, rounded up to 8, or 0 if it
+        // doesn't fit the memory beside the blocks in use. The area is
+        // anchored at its end: when it grows, its previous content is
+        // kept at the end and the rest is undefined.
+        int8u* scratch(unsigned size);
+
+        // Releases the blocks and the scratch area for the next shape,
+        // keeping the memory
+        void rewind()
+        {
+            m_num_used = 0;
+            m_scratch_size = 0;
+        }
 
-        unsigned num_cells() const {return m_num_cells; }
-        const cell* const* cells();
+        // The blocks allocated and the ones in use since rewind()
+        unsigned num_blocks() const { return m_num_blocks; }
+        unsigned num_used_blocks() const { return m_num_used; }
+
+        // The memory taken from the heap or the buffer, in bytes
+        unsigned allocated_size() const;
 
     private:
-        outline(const outline&);
-        const outline& operator = (const outline&);
+        cell_arena(const cell_arena&);
+        const cell_arena& operator = (const cell_arena&);
 
-        void set_cur_cell(int x, int y);
-        void add_cur_cell();
-        void sort_cells();
-        void render_scanline(int ey, int x1, int y1, int x2, int y2);
-        void render_line(int x1, int y1, int x2, int y2);
-        void allocate_block();
-        
-        static void qsort_cells(cell** start, unsigned num);
+        int8u* allocate_block(unsigned nb);
 
     private:
-        unsigned  m_num_blocks;
-        unsigned  m_max_blocks;
-        unsigned  m_cur_block;
-        unsigned  m_num_cells;
-        cell**    m_cells;
-        cell*     m_cur_cell_ptr;
-        cell**    m_sorted_cells;
-        unsigned  m_sorted_size;
-        cell      m_cur_cell;
-        int       m_cur_x;
-        int       m_cur_y;
-        int       m_close_x;
-        int       m_close_y;
-        int       m_min_x;
-        int       m_min_y;
-        int       m_max_x;
-        int       m_max_y;
-        unsigned  m_flags;
+        int8u*   m_buf;
+        unsigned m_buf_size;
+        int8u**  m_blocks;
+        unsigned m_num_blocks;
+        unsigned m_max_blocks;
+        unsigned m_num_used;
+        unsigned m_budget;
+        int8u*   m_scratch;
+        unsigned m_scratch_capacity;
+        unsigned m_scratch_size;
     };
 
 
-    //------------------------------------------------------------------------
-    enum filling_rule_e
-    {
-        fill_non_zero,
-        fill_even_odd
-    };
-    
-
     //========================================================================
-    // Polygon rasterizer that is used to render filled polygons with 
-    // high-quality Anti-Aliasing. Internally, by default, the class uses 
-    // integer coordinates in format 24.8, i.e. 24 bits for integer part 
-    // and 8 bits for fractional - see poly_base_shift. This class can be 
-    // used in the following  way:
-    //
-    // 1. filling_rule(filling_rule_e ft) - optional.
-    //
-    // 2. gamma() - optional.
-    //
-    // 3. reset()
-    //
-    // 4. move_to(x, y) / line_to(x, y) - make the polygon. One can create 
-    //    more than one contour, but each contour must consist of at least 3
-    //    vertices, i.e. move_to(x1, y1); line_to(x2, y2); line_to(x3, y3);
-    //    is the absolute minimum of vertices that define a triangle.
-    //    The algorithm does not check either the number of vertices nor
-    //    coincidence of their coordinates, but in the worst case it just 
-    //    won't draw anything.
-    //    The orger of the vertices (clockwise or counterclockwise) 
-    //    is important when using the non-zero filling rule (fill_non_zero).
-    //    In this case the vertex order of all the contours must be the same
-    //    if you want your intersecting polygons to be without "holes".
-    //    You actually can use different vertices order. If the contours do not 
-    //    intersect each other the order is not important anyway. If they do, 
-    //    contours with the same vertex order will be rendered without "holes" 
-    //    while the intersecting contours with different orders will have "holes".
+    // Clips polygons to a rectangle in the integer subpixel coordinates. 
+    // The parts of the edges above or below the box are dropped. The parts 
+    // to the left or to the right of it are replaced by vertical edges on
+    // the border, so that the winding of the pixels inside the box stays 
+    // the same. Consecutive vertical edges on the same border are merged 
+    // into one and those that go back and forth cancel out, so a polygon 
+    // that is entirely outside the box produces nothing but move_to().
     //
-    // filling_rule() and gamma() can be called anytime before "sweeping".
+    // The result is sent to a Sink that has move_to(x, y) and line_to(x, y).
+    // The contours are closed implicitly, like in the rasterizer: move_to() 
+    // closes the previous one and close_polygon() closes the last one. 
+    // A contour doesn't call Sink::move_to() until it has a visible part.
     //------------------------------------------------------------------------
-    class rasterizer
+    class polygon_clipper
     {
-    public:
         enum
         {
-            aa_shift = scanline::aa_shift,
-            aa_num   = 1 << aa_shift,
-            aa_mask  = aa_num - 1,
-            aa_2num  = aa_num * 2,
-            aa_2mask = aa_2num - 1
+            clip_x2 = 1,
+            clip_y2 = 2,
+            clip_x1 = 4,
+            clip_y1 = 8,
+            clip_x  = clip_x1 | clip_x2,
+            clip_y  = clip_y1 | clip_y2
         };
 
-        rasterizer() :
-            m_filling_rule(fill_non_zero)
+    public:
+        polygon_clipper() : 
+            m_clip_x1(0), m_clip_y1(0), m_clip_x2(0), m_clip_y2(0),
+            m_clipping(false), m_open(false), m_moved(false), m_pending(false)
         {
-            memcpy(m_gamma, s_default_gamma, sizeof(m_gamma));
         }
 
         //--------------------------------------------------------------------
-        void reset() { m_outline.reset(); }
-
-        //--------------------------------------------------------------------
-        void filling_rule(filling_rule_e filling_rule) 
-        { 
-            m_filling_rule = filling_rule; 
+        void clip_box(int x1, int y1, int x2, int y2)
+        {
+            if(x1 > x2) { int t = x1; x1 = x2; x2 = t; }
+            if(y1 > y2) { int t = y1; y1 = y2; y2 = t; }
+            m_clip_x1  = x1;
+            m_clip_y1  = y1;
+            m_clip_x2  = x2;
+            m_clip_y2  = y2;
+            m_clipping = true;
         }
 
-        //--------------------------------------------------------------------
-        void gamma(double g);
-        void gamma(const int8u* g);
+        void reset_clipping() { m_clipping = false; }
+        bool clipping() const { return m_clipping; }
 
-        //--------------------------------------------------------------------
-        void move_to(int x, int y) { m_outline.move_to(x, y); }
-        void line_to(int x, int y) { m_outline.line_to(x, y); }
+        // The tests of the bounding box of a whole path
+        bool inside(int x1, int y1, int x2, int y2) const
+        {
+            return (flags(x1, y1) | flags(x2, y2)) == 0;
+        }
+        bool outside(int x1, int y1, int x2, int y2) const
+        {
+            return x1 > m_clip_x2 || y1 > m_clip_y2 ||
+                   x2 < m_clip_x1 || y2 < m_clip_y1;
+        }
 
-        //--------------------------------------------------------------------
-        void move_to_d(double x, double y) { m_outline.move_to(poly_coord(x), 
-                                                               poly_coord(y)); }
-        void line_to_d(double x, double y) { m_outline.line_to(poly_coord(x), 
-                                                               poly_coord(y)); }
+        // Forgets the current contour without closing it
+        void reset() { m_open = m_moved = m_pending = false; }
+
+        // Continues the contour that the caller has sent to the sink by
+        // itself, from (x1, y1) to (x2, y2), without clipping. Both points
+        // must be inside the box.
+        void resume(int x1, int y1, int x2, int y2)
+        {
+            m_start_x = x1;
+            m_start_y = y1;
+            m_x1      = x2;
+            m_y1      = y2;
+            m_f1      = 0;
+            m_out_x   = x2;
+            m_open    = true;
+            m_moved   = true;
+            m_pending = false;
+        }
 
         //--------------------------------------------------------------------
-        int min_x() const { return m_outline.min_x(); }
-        int min_y() const { return m_outline.min_y(); }
-        int max_x() const { return m_outline.max_x(); }
-        int max_y() const { return m_outline.max_y(); }
+        template<class Sink> void move_to(Sink& sink, int x, int y)
+        {
+            close_polygon(sink);
+            m_start_x = m_x1 = x;
+            m_start_y = m_y1 = y;
+            m_f1   = flags(x, y);
+            m_open = true;
+        }
 
         //--------------------------------------------------------------------
-        unsigned calculate_alpha(int area) const
+        template<class Sink> void line_to(Sink& sink, int x2, int y2)
         {
-            int cover = area >> (poly_base_shift*2 + 1 - aa_shift);
+            if(!m_open) return;
 
-            if(cover < 0) cover = -cover;
-            if(m_filling_rule == fill_even_odd)
+            int x1 = m_x1;
+            int y1 = m_y1;
+            unsigned f1 = m_f1;
+            unsigned f2 = flags(x2, y2);
+
+            m_x1 = x2;
+            m_y1 = y2;
+            m_f1 = f2;
+
+            // Both ends inside, the most common case. The first one has 
+            // been sent already, unless it's the start of the contour.
+            if((f1 | f2) == 0)
             {
-                cover &= aa_2mask;
-                if(cover > aa_num)
-                {
-                    cover = aa_2num - cover;
-                }
+                if(!m_moved) add_vertex(sink, x1, y1);
+                add_vertex(sink, x2, y2);
+                return;
+            }
+
+            // Both ends above or both below the box
+            if((f1 & clip_y) == (f2 & clip_y) && (f1 & clip_y) != 0) return;
+
+            int y3, y4;
+            switch(((f1 & clip_x) << 1) | (f2 & clip_x))
+            {
+            case 0: // Visible by X
+                clip_y_line(sink, x1, y1, x2, y2, f1, f2);
+                break;
+
+            case 1: // x2 > clip.x2
+                y3 = y1 + mul_div(m_clip_x2 - x1, y2 - y1, x2 - x1);
+                clip_y_line(sink, x1, y1, m_clip_x2, y3, f1, flags_y(y3));
+                clip_y_line(sink, m_clip_x2, y3, m_clip_x2, y2, flags_y(y3), f2);
+                break;
+
+            case 2: // x1 > clip.x2
+                y3 = y1 + mul_div(m_clip_x2 - x1, y2 - y1, x2 - x1);
+                clip_y_line(sink, m_clip_x2, y1, m_clip_x2, y3, f1, flags_y(y3));
+                clip_y_line(sink, m_clip_x2, y3, x2, y2, flags_y(y3), f2);
+                break;
+
+            case 3: // x1 > clip.x2 && x2 > clip.x2
+                clip_y_line(sink, m_clip_x2, y1, m_clip_x2, y2, f1, f2);
+                break;
+
+            case 4: // x2 < clip.x1
+                y3 = y1 + mul_div(m_clip_x1 - x1, y2 - y1, x2 - x1);
+                clip_y_line(sink, x1, y1, m_clip_x1, y3, f1, flags_y(y3));
+                clip_y_line(sink, m_clip_x1, y3, m_clip_x1, y2, flags_y(y3), f2);
+                break;
+
+            case 6: // x1 > clip.x2 && x2 < clip.x1
+                y3 = y1 + mul_div(m_clip_x2 - x1, y2 - y1, x2 - x1);
+                y4 = y1 + mul_div(m_clip_x1 - x1, y2 - y1, x2 - x1);
+                clip_y_line(sink, m_clip_x2, y1, m_clip_x2, y3, f1, flags_y(y3));
+                clip_y_line(sink, m_clip_x2, y3, m_clip_x1, y4, flags_y(y3), flags_y(y4));
+                clip_y_line(sink, m_clip_x1, y4, m_clip_x1, y2, flags_y(y4), f2);
+                break;
+
+            case 8: // x1 < clip.x1
+                y3 = y1 + mul_div(m_clip_x1 - x1, y2 - y1, x2 - x1);
+                clip_y_line(sink, m_clip_x1, y1, m_clip_x1, y3, f1, flags_y(y3));
+                clip_y_line(sink, m_clip_x1, y3, x2, y2, flags_y(y3), f2);
+                break;
+
+            case 9: // x1 < clip.x1 && x2 > clip.x2
+                y3 = y1 + mul_div(m_clip_x1 - x1, y2 - y1, x2 - x1);
+                y4 = y1 + mul_div(m_clip_x2 - x1, y2 - y1, x2 - x1);
+                clip_y_line(sink, m_clip_x1, y1, m_clip_x1, y3, f1, flags_y(y3));
+                clip_y_line(sink, m_clip_x1, y3, m_clip_x2, y4, flags_y(y3), flags_y(y4));
+                clip_y_line(sink, m_clip_x2, y4, m_clip_x2, y2, flags_y(y4), f2);
+                break;
+
+            case 12: // x1 < clip.x1 && x2 < clip.x1
+                clip_y_line(sink, m_clip_x1, y1, m_clip_x1, y2, f1, f2);
+                break;
             }
-            if(cover > aa_mask) cover = aa_mask;
-            return cover;
         }
 
         //--------------------------------------------------------------------
-        template<class Renderer> void render(Renderer& r, 
-                                             const rgba8& c, 
-                                             int dx=0, 
-                                             int dy=0)
+        template<class Sink> void close_polygon(Sink& sink)
         {
-            const cell* const* cells = m_outline.cells();
-            if(m_outline.num_cells() == 0) return;
+            if(!m_open) return;
+            line_to(sink, m_start_x, m_start_y);
+            if(m_pending) sink.line_to(m_out_x, m_pending_y);
+            reset();
+        }
 
-            int x, y;
-            int cover;
-            int alpha;
-            int area;
+    private:
+        //--------------------------------------------------------------------
+        unsigned flags(int x, int y) const
+        {
+            return  (x > m_clip_x2) | 
+                   ((y > m_clip_y2) << 1) | 
+                   ((x < m_clip_x1) << 2) | 
+                   ((y < m_clip_y1) << 3);
+        }
 
-            m_scanline.reset(m_outline.min_x(), m_outline.max_x(), dx, dy);
+        unsigned flags_y(int y) const
+        {
+            return ((y > m_clip_y2) << 1) | ((y < m_clip_y1) << 3);
+        }
 
-            cover = 0;
-            const cell* cur_cell = *cells++;
-            for(;;)
-            {
-                const cell* start_cell = cur_cell;
+        // a * b / c rounded to the nearest, the halves away from zero, so 
+        // the intersection is within half a subpixel of the exact one
+        static int mul_div(int a, int b, int c)
+        {
+            int64 p = int64(a) * b;
+            int64 h = ((c < 0) ? -int64(c) : int64(c)) >> 1;
+            return int((((p < 0) == (c < 0)) ? p + h : p - h) / c);
+        }
 
-                int coord  = cur_cell->packed_coord;
-                x = cur_cell->x;
-                y = cur_cell->y;
+        //--------------------------------------------------------------------
+        template<class Sink> void clip_y_line(Sink& sink, 
+                                              int x1, int y1, 
+                                              int x2, int y2, 
+                                              unsigned f1, unsigned f2)
+        {
+            f1 &= clip_y;
+            f2 &= clip_y;
+            if(f1 | f2)
+            {
+                if(f1 == f2) return;
 
-                area   = start_cell->area;
-                cover += start_cell->cover;
+                int tx1 = x1;
+                int ty1 = y1;
+                int tx2 = x2;
+                int ty2 = y2;
 
-                //accumulate all start cells
-                while((cur_cell = *cells++) != 0)
+                if(f1 & clip_y1)
                 {
-                    if(cur_cell->packed_coord != coord) break;
-                    area  += cur_cell->area;
-                    cover += cur_cell->cover;
+                    tx1 = x1 + mul_div(m_clip_y1 - y1, x2 - x1, y2 - y1);
+                    ty1 = m_clip_y1;
                 }
-
-                if(area)
+                if(f1 & clip_y2)
                 {
-                    alpha = calculate_alpha((cover << (poly_base_shift + 1)) - area);
-                    if(alpha)
-                    {
-                        if(m_scanline.is_ready(y))
-                        {
-                            r.render(m_scanline, c);
-                            m_scanline.reset_spans();
-                        }
-                        m_scanline.add_cell(x, y, m_gamma[alpha]);
-                    }
-                    x++;
+                    tx1 = x1 + mul_div(m_clip_y2 - y1, x2 - x1, y2 - y1);
+                    ty1 = m_clip_y2;
                 }
-
-                if(!cur_cell) break;
-
-                if(cur_cell->x > x)
+                if(f2 & clip_y1)
                 {
-                    alpha = calculate_alpha(cover << (poly_base_shift + 1));
-                    if(alpha)
-                    {
-                        if(m_scanline.is_ready(y))
-                        {
-                            r.render(m_scanline, c);
-                            m_scanline.reset_spans();
-                        }
-                        m_scanline.add_span(x, y, 
-                                            cur_cell->x - x, 
-                                            m_gamma[alpha]);
-                    }
+                    tx2 = x1 + mul_div(m_clip_y1 - y1, x2 - x1, y2 - y1);
+                    ty2 = m_clip_y1;
                 }
-            } 
-        
-            if(m_scanline.num_spans())
-            {
-                r.render(m_scanline, c);
+                if(f2 & clip_y2)
+                {
+                    tx2 = x1 + mul_div(m_clip_y2 - y1, x2 - x1, y2 - y1);
+                    ty2 = m_clip_y2;
+                }
+                x1 = tx1;
+                y1 = ty1;
+                x2 = tx2;
+                y2 = ty2;
             }
+            add_vertex(sink, x1, y1);
+            add_vertex(sink, x2, y2);
         }
 
-
         //--------------------------------------------------------------------
-        bool hit_test(int tx, int ty);
-
-    private:
-        rasterizer(const rasterizer&);
-        const rasterizer& operator = (const rasterizer&);
-
-    private:
-        outline        m_outline;
-        scanline       m_scanline;
-        filling_rule_e m_filling_rule;
+        // A vertex on the same vertical border as the last one sent to 
+        // the sink is kept pending and replaced by the next one, until the 
+        // contour leaves the border.
+        template<class Sink> void add_vertex(Sink& sink, int x, int y)
+        {
+            if(!m_moved)
+            {
+                sink.move_to(x, y);
+                m_out_x = x;
+                m_moved = true;
+                return;
+            }
+            if(x == m_out_x && (x == m_clip_x1 || x == m_clip_x2))
+            {
+                m_pending_y = y;
+                m_pending = true;
+                return;
+            }
+            if(m_pending)
+            {
+                sink.line_to(m_out_x, m_pending_y);
+                m_pending = false;
+            }
+            sink.line_to(x, y);
+            m_out_x = x;
+        }
+
+    private:
+        int      m_clip_x1;
+        int      m_clip_y1;
+        int      m_clip_x2;
+        int      m_clip_y2;
+        int      m_start_x;
+        int      m_start_y;
+        int      m_x1;
+        int      m_y1;
+        unsigned m_f1;
+        int      m_out_x;
+        int      m_pending_y;
+        bool     m_clipping;
+        bool     m_open;
+        bool     m_moved;
+        bool     m_pending;
+    };
+
+
+    //------------------------------------------------------------------------
+    // Division by a multiplication with the reciprocal, for the edge 
+    // stepping of outline_aa. init() does the only real division, then 
+    // div() returns floor(p / d) and the remainder in [0...d) for any int
+    // p with one 32x32->64 product and one correction: the reciprocal is 
+    // less than 2^32/d by at most 1, so the estimate of the quotient is
+    // less than the true one by at most 1 too.
+    //
+    // render_line() makes the reciprocal of dy of an edge and, on the 
+    // first use, the ones of the two widths of its interior scanlines,
+    // which differ by one subpixel, and of the widths of its first and 
+    // last scanline. That's up to 5 real divisions per edge, whatever its
+    // length, rather than one: the cells are made from the rounded ends 
+    // of every scanline, so the widths can't be derived from dy without
+    // changing the cover and area values. With int32 coordinates the 
+    // products of render_line() that don't fit in an int are still 
+    // divided for real, which happens only for edges wider than 2^23 
+    // subpixels.
+    struct divider
+    {
+        int    d;
+        int32u r;
+
+        divider() : d(0), r(0) {}
+
+        void init(int d_)
+        {
+            d = d_;
+            r = 0xFFFFFFFFu / unsigned(d_);
+        }
+
+        int div(int p, int* mod) const
+        {
+            unsigned n = (p < 0) ? 0u - unsigned(p) : unsigned(p);
+            unsigned q = unsigned((int64u(n) * r) >> 32);
+            unsigned m = n - q * unsigned(d);
+            if(m >= unsigned(d))
+            {
+                q++;
+                m -= unsigned(d);
+            }
+            if(p < 0 && m)
+            {
+                *mod = d - int(m);
+                return -int(q) - 1;
+            }
+            *mod = int(m);
+            return (p < 0) ? -int(q) : int(q);
+        }
+    };
+
+
+    class path_storage;   // agg_path_storage.h
+
+    //------------------------------------------------------------------------
+    // An internal class that implements the main rasterization algorithm.
+    // Used in the rasterizer. Should not be used direcly.
+    // 
+    // Shift is the number of bits of the fractional part of the subpixel
+    // coordinates, Coord is the type of the cell coordinates, see
+    // coord_traits. Shift must be at least 4, so that the area has enough
+    // bits for 256 levels of Anti-Aliasing; above 9 the accumulated cells
+    // would often have to be split. The implementation is in agg.cpp,
+    // which instantiates the configurations typedef'ed below.
+    template<int Shift, class Coord> class outline_aa
+    {
+    public:
+        typedef cell_aa<Shift, Coord> cell_type;
+        typedef typename coord_traits<Coord>::calc_type calc_type;
+
+        enum
+        {
+            subpixel_shift = Shift,
+            subpixel_size  = 1 << subpixel_shift,
+            subpixel_mask  = subpixel_size - 1
+        };
+
+    private:
+        enum
+        {
+            cell_block_size  = cell_arena::block_size / sizeof(cell_type),
+            cell_block_mask  = cell_block_size - 1
+        };
+
+        // A scanline bucket of the sorted cells. While sorting, "start" 
+        // is first used to count the cells of the scanline.
+        struct sorted_y
+        {
+            unsigned start;
+            unsigned num;
+        };
+
+        // The cell being accumulated, in full precision.
+        struct cur_cell
+        {
+            int x;
+            int y;
+            int cover;
+            int area;
+
+            void set(int x, int y, int c, int a);
+            void set_cover(int c, int a);
+            void add_cover(int c, int a);
+        };
+
+    public:
+        // A cell of the accumulation buffer, see accumulate_cells()
+        struct acc_cell
+        {
+            int cover;
+            int area;
+        };
+
+        ~outline_aa();
+
+        // The default arena allocates from the heap with the default 
+        // budget. The caller's one must outlive the outline.
+        outline_aa();
+        outline_aa(cell_arena& arena);
+
+        void reset();
+
+        // The number of the cells lost since reset() because the arena
+        // was exhausted. The shape is rendered incorrectly if it's not 0.
+        unsigned num_dropped_cells() const { return m_num_dropped; }
+
+        // The box is in the subpixel coordinates. It should be set before 
+        // the shape, it's kept by reset().
+        void clip_box(int x1, int y1, int x2, int y2) 
+        { 
+            m_clipper.clip_box(x1, y1, x2, y2); 
+        }
+        void reset_clipping() { m_clipper.reset_clipping(); }
+
+        // The shapes of add_poly() and add_path() whose bounding box has at
+        // most this number of cells are added up straight in the 
+        // accumulation buffer, without storing the cells, see 
+        // accumulate_cells(). 0, the default, disables it. It's kept by 
+        // reset().
+        void accumulation_threshold(unsigned num_cells) 
+        { 
+            m_acc_threshold = num_cells; 
+        }
+        unsigned accumulation_threshold() const { return m_acc_threshold; }
+
+        // True while the cells go to the accumulation buffer. The first 
+        // edge outside its box, move_to(), line_to() or cells() store the
+        // accumulated cells in the blocks and go on as usual.
+        bool accumulating() const { return m_acc_cells != 0; }
+
+        void move_to(int x, int y);
+        void line_to(int x, int y);
+
+        // Bulk input. The bounding box of the vertices is calculated once,
+        // if it's inside the clip box, the edges go straight to the cells
+        // without the clipper and the per-edge update of the bounding box,
+        // if it's outside, they're dropped. The result is the same as with
+        // move_to()/line_to(). The contour of add_poly() stays open for
+        // line_to() unless it's closed, the same as the last one of
+        // add_path(), which adds the vertices of the path path_id.
+        void add_poly(const int* xy, unsigned n, bool closed);
+        void add_path(const path_storage& ps, unsigned path_id);
+
+        int min_x() const { return m_min_x; }
+        int min_y() const { return m_min_y; }
+        int max_x() const { return m_max_x; }
+        int max_y() const { return m_max_y; }
+
+        unsigned num_cells() const {return m_num_cells; }
+
+        // Sorts the cells in the scratch area of the arena. If it doesn't 
+        // fit, all the cells are dropped and counted and it returns 0.
+        const cell_type* cells();
+
+        // The cells of one scanline, valid after cells().
+        unsigned scanline_num_cells(int y) const 
+        { 
+            return m_sorted_y[y - m_min_y].num; 
+        }
+        const cell_type* scanline_cells(int y) const
+        { 
+            return m_sorted_cells + m_sorted_y[y - m_min_y].start; 
+        }
+
+        // Closes the current shape and keeps its cells. The next one adds
+        // its cells after them, as a separate shape - their cells are never
+        // merged. The bounding box is the one of all the shapes.
+        void close_shape();
+
+        // Closes the outline without sorting. cells() calls it too. After 
+        // that the cells can be read block by block in the order they were
+        // generated, which is enough for the accumulation buffer.
+        void close_cells();
+        unsigned num_blocks() const 
+        { 
+            return (m_num_cells + cell_block_mask) / cell_block_size; 
+        }
+        const cell_type* block_cells(unsigned nb, unsigned* num) const;
+
+        // Closes the outline and returns the dense buffer of the bounding
+        // box with the cells added up, row by row. If the outline isn't
+        // accumulating(), it's made of the blocks in the scratch area of
+        // the arena, then it returns 0 if it doesn't fit and the cells are
+        // kept. It replaces the sorted cells, they are sorted again by the
+        // next cells().
+        const acc_cell* accumulate_cells();
+
+    private:
+        outline_aa(const outline_aa&);
+        const outline_aa& operator = (const outline_aa&);
+
+        void set_cur_cell(int x, int y);
+        void add_cur_cell();
+        void add_cell(typename cell_type::key_type key, int cover, int area);
+        void split_cur_cell();
+        void sort_cells();
+        void drop_cells();
+        void begin_acc(int x1, int y1, int x2, int y2);
+        void store_acc_cells();
+        void render_scanline(int ey, int x1, int y1, int x2, int y2, 
+                             divider& div);
+        void render_line(int x1, int y1, int x2, int y2);
+        bool allocate_block();
+
+        void move_to_clipped(int x, int y);
+        void line_to_clipped(int x, int y);
+        bool begin_bulk(int x1, int y1, int x2, int y2);
+        void end_bulk();
+        void skip_bulk(int start_x, int start_y, int x, int y);
+
+        // Receives the output of the clipper
+        struct clipped_sink;
+        friend struct clipped_sink;
+        struct clipped_sink
+        {
+            outline_aa* self;
+            clipped_sink(outline_aa* o) : self(o) {}
+            void move_to(int x, int y) { self->move_to_clipped(x, y); }
+            void line_to(int x, int y) { self->line_to_clipped(x, y); }
+        };
+
+    private:
+        cell_arena      m_default_arena;
+        cell_arena*     m_arena;
+        unsigned        m_num_cells;
+        unsigned        m_num_dropped;
+        cell_type*      m_cur_cell_ptr;
+        cell_type*      m_sorted_cells;
+        sorted_y*       m_sorted_y;
+        acc_cell*       m_acc_cells;
+        unsigned        m_acc_width;
+        unsigned        m_acc_threshold;
+        cur_cell        m_cur_cell;
+        polygon_clipper m_clipper;
+        int             m_cur_x;
+        int             m_cur_y;
+        int             m_close_x;
+        int             m_close_y;
+        int             m_min_x;
+        int             m_min_y;
+        int             m_max_x;
+        int             m_max_y;
+        unsigned        m_flags;
+    };
+
+
+    //------------------------------------------------------------------------
+    enum filling_rule_e
+    {
+        fill_non_zero,
+        fill_even_odd
+    };
+
+
+    //------------------------------------------------------------------------
+    // The commands returned by the vertex sources, such as agg::ellipse or
+    // agg::curve4 (see agg_curves.h). A vertex source has two methods:
+    //
+    //     void rewind(unsigned path_id);
+    //     unsigned vertex(int* x, int* y);
+    //
+    // vertex() returns the next command with its coordinates, until 
+    // path_cmd_stop. path_cmd_end_poly ends a contour, path_flags_close 
+    // is set if the contour is closed. The rasterizer closes every contour 
+    // anyway, so it ignores path_cmd_end_poly. It ignores the curves too,
+    // path_cmd_curve3 marks the control point and the end point of a 
+    // quadratic Bezier curve, path_cmd_curve4 the two control points and 
+    // the end point of a cubic one, they're flattened by agg::conv_curve.
+    enum path_commands_e
+    {
+        path_cmd_stop     = 0,
+        path_cmd_move_to  = 1,
+        path_cmd_line_to  = 2,
+        path_cmd_curve3   = 3,
+        path_cmd_curve4   = 4,
+        path_cmd_end_poly = 0x0F,
+        path_cmd_mask     = 0x0F
+    };
+
+    enum path_flags_e
+    {
+        path_flags_none  = 0,
+        path_flags_close = 0x40
+    };
+    
+
+    //========================================================================
+    // Polygon rasterizer that is used to render filled polygons with 
+    // high-quality Anti-Aliasing. Internally, by default, the class uses 
+    // integer coordinates in format 24.8, i.e. 24 bits for integer part 
+    // and 8 bits for fractional - see poly_base_shift. This class can be 
+    // used in the following  way:
+    //
+    // 1. filling_rule(filling_rule_e ft) - optional.
+    //
+    // 2. gamma() - optional.
+    //
+    // 3. reset()
+    //
+    // 4. move_to(x, y) / line_to(x, y) - make the polygon. One can create 
+    //    more than one contour, but each contour must consist of at least 3
+    //    vertices, i.e. move_to(x1, y1); line_to(x2, y2); line_to(x3, y3);
+    //    is the absolute minimum of vertices that define a triangle.
+    //    The algorithm does not check either the number of vertices nor
+    //    coincidence of their coordinates, but in the worst case it just 
+    //    won't draw anything.
+    //    The orger of the vertices (clockwise or counterclockwise) 
+    //    is important when using the non-zero filling rule (fill_non_zero).
+    //    In this case the vertex order of all the contours must be the same
+    //    if you want your intersecting polygons to be without "holes".
+    //    You actually can use different vertices order. If the contours do not 
+    //    intersect each other the order is not important anyway. If they do, 
+    //    contours with the same vertex order will be rendered without "holes" 
+    //    while the intersecting contours with different orders will have "holes".
+    //
+    // filling_rule() and gamma() can be called anytime before "sweeping".
+    // 
+    // The template arguments are the ones of outline_aa. "rasterizer" is
+    // the default 24.8 configuration with 16-bit cell coordinates,
+    // "rasterizer_int32" is the same accuracy with 32-bit cell coordinates
+    // for the canvases that don't fit 16 bits and "rasterizer_low" is the
+    // 26.6 one with 16-bit cell coordinates.
+    //------------------------------------------------------------------------
+    template<int Shift, class Coord> class rasterizer_aa
+    {
+    public:
+        typedef outline_aa<Shift, Coord>          outline_type;
+        typedef typename outline_type::cell_type  cell_type;
+
+        enum
+        {
+            subpixel_shift = Shift,
+            subpixel_size  = 1 << subpixel_shift,
+            subpixel_mask  = subpixel_size - 1
+        };
+
+        enum
+        {
+            aa_shift = scanline::aa_shift,
+            aa_num   = 1 << aa_shift,
+            aa_mask  = aa_num - 1,
+            aa_2num  = aa_num * 2,
+            aa_2mask = aa_2num - 1
+        };
+
+        enum
+        {
+            acc_threshold = 32 * 32
+        };
+
+        rasterizer_aa() :
+            m_filling_rule(fill_non_zero)
+        {
+            m_outline.accumulation_threshold(acc_threshold);
+            memcpy(m_gamma, s_default_gamma, sizeof(m_gamma));
+            build_alpha();
+        }
+
+        // The cells are stored in the caller's arena, see cell_arena
+        rasterizer_aa(cell_arena& arena) :
+            m_outline(arena),
+            m_filling_rule(fill_non_zero)
+        {
+            m_outline.accumulation_threshold(acc_threshold);
+            memcpy(m_gamma, s_default_gamma, sizeof(m_gamma));
+            build_alpha();
+        }
+
+        //--------------------------------------------------------------------
+        void reset() { m_outline.reset(); }
+
+        //--------------------------------------------------------------------
+        // Clips the shapes to the pixels [x1...x2) x [y1...y2) before they 
+        // are converted into cells, see polygon_clipper. The box is in the
+        // coordinates of the vertices, i.e., without the dx/dy of render().
+        // Usually it's clip_box(0, 0, rbuf.width(), rbuf.height()).
+        void clip_box(int x1, int y1, int x2, int y2)
+        {
+            m_outline.clip_box(x1 * subpixel_size, y1 * subpixel_size, 
+                               x2 * subpixel_size, y2 * subpixel_size);
+        }
+        void reset_clipping() { m_outline.reset_clipping(); }
+
+        //--------------------------------------------------------------------
+        // Non-zero if the cell arena was exhausted by the current shape
+        unsigned num_dropped_cells() const 
+        { 
+            return m_outline.num_dropped_cells(); 
+        }
+
+        //--------------------------------------------------------------------
+        void filling_rule(filling_rule_e filling_rule) 
+        { 
+            m_filling_rule = filling_rule; 
+        }
+
+        //--------------------------------------------------------------------
+        void gamma(double g);
+        void gamma(const int8u* g);
+
+        // The gamma of a new rasterizer, also the one of line_aa
+        static const int8u s_default_gamma[256];
+
+        //--------------------------------------------------------------------
+        // Shapes whose bounding box has at most this number of cells are 
+        // rendered through the accumulation buffer, without sorting. 
+        // 0 disables the accumulation buffer.
+        void accumulation_threshold(unsigned num_cells) 
+        { 
+            m_outline.accumulation_threshold(num_cells); 
+        }
+
+        //--------------------------------------------------------------------
+        void move_to(int x, int y) { m_outline.move_to(x, y); }
+        void line_to(int x, int y) { m_outline.line_to(x, y); }
+
+        //--------------------------------------------------------------------
+        void move_to_d(double x, double y) { m_outline.move_to(int(x * subpixel_size),
+                                                               int(y * subpixel_size)); }
+        void line_to_d(double x, double y) { m_outline.line_to(int(x * subpixel_size),
+                                                               int(y * subpixel_size)); }
+
+        //--------------------------------------------------------------------
+        // Adds all the contours of a vertex source, see path_commands_e
+        template<class VertexSource> void add_path(VertexSource& vs, 
+                                                   unsigned path_id = 0)
+        {
+            int x;
+            int y;
+            unsigned cmd;
+            vs.rewind(path_id);
+            while((cmd = vs.vertex(&x, &y)) != path_cmd_stop)
+            {
+                if(cmd == path_cmd_move_to) m_outline.move_to(x, y);
+                else 
+                if(cmd == path_cmd_line_to) m_outline.line_to(x, y);
+            }
+        }
+
+        //--------------------------------------------------------------------
+        // The bulk input, see outline_aa::add_poly(). There are n vertices
+        // in xy, x and y of each one. The path_storage is read block by block
+        // instead of through rewind()/vertex(), the overloads take both a
+        // const and a non-const one, otherwise the template would be chosen
+        // for the latter.
+        void add_poly(const int* xy, unsigned n, bool closed = true)
+        {
+            m_outline.add_poly(xy, n, closed);
+        }
+        void add_path(const path_storage& ps, unsigned path_id = 0)
+        {
+            m_outline.add_path(ps, path_id);
+        }
+        void add_path(path_storage& ps, unsigned path_id = 0)
+        {
+            m_outline.add_path(ps, path_id);
+        }
+
+        //--------------------------------------------------------------------
+        int min_x() const { return m_outline.min_x(); }
+        int min_y() const { return m_outline.min_y(); }
+        int max_x() const { return m_outline.max_x(); }
+        int max_y() const { return m_outline.max_y(); }
+
+        //--------------------------------------------------------------------
+        unsigned calculate_alpha(int area) const
+        {
+            return calculate_alpha(area, m_filling_rule);
+        }
+
+        //--------------------------------------------------------------------
+        static unsigned calculate_alpha(int area, filling_rule_e filling_rule)
+        {
+            int cover = area >> (subpixel_shift*2 + 1 - aa_shift);
+
+            if(cover < 0) cover = -cover;
+            if(filling_rule == fill_even_odd)
+            {
+                cover &= aa_2mask;
+                if(cover > aa_num)
+                {
+                    cover = aa_2num - cover;
+                }
+            }
+            if(cover > aa_mask) cover = aa_mask;
+            return cover;
+        }
+
+        //--------------------------------------------------------------------
+        template<class Renderer> void render(Renderer& r, 
+                                             const rgba8& c, 
+                                             int dx=0, 
+                                             int dy=0)
+        {
+            m_outline.close_cells();
+            if(m_outline.accumulating())
+            {
+                render_acc(r, c, dx, dy);
+                return;
+            }
+            if(m_outline.num_cells() == 0) return;
+
+            // Written as a division, because the product can overflow
+            // with 32-bit coordinates
+            if(unsigned(max_x() - min_x() + 1) <=
+               m_outline.accumulation_threshold() / 
+               unsigned(max_y() - min_y() + 1))
+            {
+                if(render_acc(r, c, dx, dy)) return;
+            }
+
+            const cell_type* cells = m_outline.cells();
+            if(cells == 0) return;
+            m_scanline.reset(m_outline.min_x(), m_outline.max_x(), dx, dy);
+            sweep(r, m_scanline, c, cells, cells + m_outline.num_cells());
+        }
+
+        //--------------------------------------------------------------------
+        // Closes the outline and sorts the cells. Returns false if there's 
+        // nothing to render. Called implicitly by render() and hit_test().
+        bool sort()
+        {
+            return m_outline.cells() != 0;
+        }
+
+        //--------------------------------------------------------------------
+        // Renders only the scanlines [y1...y2] through the given scanline 
+        // object. It doesn't modify the rasterizer, so, after sort(), several 
+        // threads can render different scanlines of the same shape at once,
+        // each one with its own scanline.
+        template<class Renderer> void render_scanlines(Renderer& r, 
+                                                       scanline& sl,
+                                                       const rgba8& c, 
+                                                       int y1,
+                                                       int y2,
+                                                       int dx=0, 
+                                                       int dy=0) const
+        {
+            if(m_outline.num_cells() == 0) return;
+            if(y1 < min_y()) y1 = min_y();
+            if(y2 > max_y()) y2 = max_y();
+            if(y1 > y2) return;
+
+            sl.reset(m_outline.min_x(), m_outline.max_x(), dx, dy);
+            sweep(r, sl, c, 
+                  m_outline.scanline_cells(y1), 
+                  m_outline.scanline_cells(y2) + m_outline.scanline_num_cells(y2));
+        }
+
+
+        //--------------------------------------------------------------------
+        // The sort-free engine for small shapes. The cells are added up in 
+        // a dense buffer that covers the bounding box and every row of it
+        // is swept with a running sum of the covers. The result is exactly
+        // the same as of the sorted sweep, but the cost depends on the area
+        // of the bounding box instead of the number of cells. The shapes of
+        // add_poly() and add_path() are accumulated while their edges are
+        // converted, with no cells stored at all. The ones made with 
+        // move_to()/line_to() don't know the box beforehand, their cells
+        // are stored and added up here. Returns false and renders nothing
+        // if the buffer doesn't fit the arena.
+        template<class Renderer> bool render_acc(Renderer& r, 
+                                                 const rgba8& c, 
+                                                 int dx=0, 
+                                                 int dy=0)
+        {
+            m_outline.close_cells();
+            if(m_outline.num_cells() == 0 && 
+               !m_outline.accumulating()) return true;
+
+            AGG_STATS_TIMER_START(t);
+            const acc_cell* acc = m_outline.accumulate_cells();
+            if(acc == 0) return false;
+
+            if(m_filling_rule == fill_even_odd) sweep_acc(r, c, dx, dy, acc, alpha_even_odd(m_alpha));
+            else
+            if(m_linear_gamma)                  sweep_acc(r, c, dx, dy, acc, alpha_non_zero_linear());
+            else                                sweep_acc(r, c, dx, dy, acc, alpha_non_zero(m_alpha));
+            AGG_STATS_TIMER_STOP(t, sweep_cycles);
+            return true;
+        }
+
+        //--------------------------------------------------------------------
+        // Tests if the pixel (tx, ty) is covered by the shape. The point is 
+        // rejected by the bounding box first, then only the cells of row ty 
+        // are swept, found through the index of the sorted scanlines.
+        bool hit_test(int tx, int ty);
+
+        // Tests num points (x[i], y[i]) against the shape in one pass: the 
+        // cells are sorted once and every point costs the sweep of its row
+        // up to x[i]. Writes 1 or 0 into hits[i] and returns the number of
+        // the hits.
+        unsigned hit_test(const int* x, const int* y, unsigned num, int8u* hits);
+
+    private:
+        rasterizer_aa(const rasterizer_aa&);
+        const rasterizer_aa& operator = (const rasterizer_aa&);
+
+        friend class batch_rasterizer;
+        friend class compound_rasterizer;
+
+    protected:
+        // The sweep and its state are accessible to the variants of the
+        // sweep in the benchmark, see the sweep comparison of agg_bench.
+        typedef typename outline_type::acc_cell acc_cell;
+
+        //--------------------------------------------------------------------
+        // The area of a cell to the coverage, one functor per filling rule.
+        // The fused table of build_alpha() is indexed by the area scaled
+        // to aa_shift bits: for even-odd the wrapping is the index mask, 
+        // for non-zero it only has to be clamped first. With the linear 
+        // gamma the non-zero coverage is calculated without any table. The
+        // even-odd one always uses the table, one lookup is cheaper than
+        // the wrap and the clamp (see the sweep comparison of agg_bench).
+        struct alpha_non_zero
+        {
+            const int8u* table;
+            alpha_non_zero(const int8u* t) : table(t) {}
+            unsigned operator () (int area) const
+            {
+                int cover = area >> (subpixel_shift*2 + 1 - aa_shift);
+                if(unsigned(cover + aa_num) > unsigned(aa_2num)) cover = aa_num;
+                return table[cover & aa_2mask];
+            }
+        };
+
+        struct alpha_even_odd
+        {
+            const int8u* table;
+            alpha_even_odd(const int8u* t) : table(t) {}
+            unsigned operator () (int area) const
+            {
+                return table[(area >> (subpixel_shift*2 + 1 - aa_shift)) & aa_2mask];
+            }
+        };
+
+        struct alpha_non_zero_linear
+        {
+            unsigned operator () (int area) const
+            {
+                int cover = area >> (subpixel_shift*2 + 1 - aa_shift);
+                if(cover < 0) cover = -cover;
+                if(cover > aa_mask) cover = aa_mask;
+                return cover;
+            }
+        };
+
+        struct alpha_even_odd_linear
+        {
+            unsigned operator () (int area) const
+            {
+                int cover = (area >> (subpixel_shift*2 + 1 - aa_shift)) & aa_2mask;
+                if(cover > aa_num) cover = aa_2num - cover;
+                if(cover > aa_mask) cover = aa_mask;
+                return cover;
+            }
+        };
+
+        //--------------------------------------------------------------------
+        // The filling rule and the gamma don't change during a sweep, so 
+        // they are chosen once and the loop is instantiated for each case.
+        template<class Renderer> void sweep(Renderer& r, 
+                                            scanline& sl,
+                                            const rgba8& c, 
+                                            const cell_type* cur_cell,
+                                            const cell_type* end_cell) const
+        { 
+            AGG_STATS_TIMER_START(t);
+            if(m_filling_rule == fill_even_odd) sweep(r, sl, c, cur_cell, end_cell, alpha_even_odd(m_alpha));
+            else
+            if(m_linear_gamma)                  sweep(r, sl, c, cur_cell, end_cell, alpha_non_zero_linear());
+            else                                sweep(r, sl, c, cur_cell, end_cell, alpha_non_zero(m_alpha));
+            AGG_STATS_TIMER_STOP(t, sweep_cycles);
+        }
+
+        //--------------------------------------------------------------------
+        template<class Renderer, class Alpha> void sweep(Renderer& r, 
+                                                         scanline& sl,
+                                                         const rgba8& c, 
+                                                         const cell_type* cur_cell,
+                                                         const cell_type* end_cell,
+                                                         Alpha alpha) const
+        {
+            if(cur_cell == end_cell) return;
+
+            int x, y;
+            int cover;
+            unsigned cov;
+            int area;
+
+            cover = 0;
+            for(;;)
+            {
+                typename cell_type::key_type key = cur_cell->key;
+                x = cur_cell->x();
+                y = cur_cell->y();
+
+                area   = cur_cell->area();
+                cover += cur_cell->cover();
+
+                //accumulate all start cells
+                while(++cur_cell != end_cell)
+                {
+                    if(cur_cell->key != key) break;
+                    area  += cur_cell->area();
+                    cover += cur_cell->cover();
+                }
+
+                if(area)
+                {
+                    cov = alpha((cover << (subpixel_shift + 1)) - area);
+                    if(cov)
+                    {
+                        if(sl.is_ready(y))
+                        {
+                            r.render(sl, c);
+                            sl.reset_spans();
+                        }
+                        sl.add_cell(x, y, cov);
+                    }
+                    x++;
+                }
+
+                if(cur_cell == end_cell) break;
+
+                if(cur_cell->x() > x)
+                {
+                    cov = alpha(cover << (subpixel_shift + 1));
+                    if(cov)
+                    {
+                        if(sl.is_ready(y))
+                        {
+                            r.render(sl, c);
+                            sl.reset_spans();
+                        }
+                        sl.add_span(x, y, 
+                                    cur_cell->x() - x, 
+                                    cov);
+                    }
+                }
+            } 
+        
+            if(sl.num_spans())
+            {
+                r.render(sl, c);
+            }
+        }
+
+        //--------------------------------------------------------------------
+        template<class Renderer, class Alpha> void sweep_acc(Renderer& r, 
+                                                             const rgba8& c, 
+                                                             int dx, 
+                                                             int dy,
+                                                             const acc_cell* cur_cell,
+                                                             Alpha alpha)
+        {
+            int min_x = m_outline.min_x();
+            int max_x = m_outline.max_x();
+            int x, y;
+            int cover;
+            unsigned cov;
+
+            m_scanline.reset(min_x, max_x, dx, dy);
+
+            cover = 0;
+            for(y = m_outline.min_y(); y <= m_outline.max_y(); y++)
+            {
+                x = min_x;
+                while(x <= max_x)
+                {
+                    cover += cur_cell->cover;
+                    if(cur_cell->area)
+                    {
+                        cov = alpha((cover << (subpixel_shift + 1)) - cur_cell->area);
+                        if(cov)
+                        {
+                            if(m_scanline.is_ready(y))
+                            {
+                                r.render(m_scanline, c);
+                                m_scanline.reset_spans();
+                            }
+                            m_scanline.add_cell(x, y, cov);
+                        }
+                        ++cur_cell;
+                        ++x;
+                    }
+                    else
+                    {
+                        //skip all the cells that don't change the cover
+                        int start_x = x;
+                        do
+                        {
+                            ++cur_cell;
+                            ++x;
+                        }
+                        while(x <= max_x && (cur_cell->cover | cur_cell->area) == 0);
+
+                        cov = alpha(cover << (subpixel_shift + 1));
+                        if(cov)
+                        {
+                            if(m_scanline.is_ready(y))
+                            {
+                                r.render(m_scanline, c);
+                                m_scanline.reset_spans();
+                            }
+                            m_scanline.add_span(start_x, y, x - start_x, cov);
+                        }
+                    }
+                }
+            } 
+
+            if(m_scanline.num_spans())
+            {
+                r.render(m_scanline, c);
+            } 
+        }
+
+        void build_alpha();
+        bool hit_test_row(int tx, int ty) const;
+
+        outline_type   m_outline;
+        scanline       m_scanline;
+        filling_rule_e m_filling_rule;
         int8u          m_gamma[256];
-        static const int8u s_default_gamma[256];     
+        int8u          m_alpha[aa_2num];
+        bool           m_linear_gamma;
+    };
+
+
+    //------------------------------------------------------------------------
+    typedef cell_aa<poly_base_shift, int16>       cell;
+    typedef outline_aa<poly_base_shift, int16>    outline;
+    typedef rasterizer_aa<poly_base_shift, int16> rasterizer;
+
+    typedef cell_aa<poly_base_shift, int32>       cell_int32;
+    typedef outline_aa<poly_base_shift, int32>    outline_int32;
+    typedef rasterizer_aa<poly_base_shift, int32> rasterizer_int32;
+
+    // 6 bits of subpixel accuracy, 64 levels of the coverage of an edge
+    // within a pixel. The vertices are in 1/64 of a pixel.
+    typedef cell_aa<low_base_shift, int16>        cell_low;
+    typedef outline_aa<low_base_shift, int16>     outline_low;
+    typedef rasterizer_aa<low_base_shift, int16>  rasterizer_low;
+
+    // These are the only configurations in the library. Another one 
+    // needs its explicit instantiations added at the end of agg.cpp, 
+    // the templates aren't defined in this header.
+
+
+    //========================================================================
+    // Renders a whole frame of filled shapes tile by tile. Each shape is 
+    // made with move_to()/line_to() like in the rasterizer and finished with 
+    // add(), which sorts its cells and keeps them with the color and the 
+    // filling rule. render() then goes over the frame in tiles of 
+    // tile_size x tile_size pixels and composites every tile completely, 
+    // shape by shape in the order of submission, before moving to the next
+    // one. This way the destination pixels stay in the cache, while the 
+    // result is exactly the same as of rendering the shapes one by one. 
+    //
+    // Each row of a shape keeps a cursor in its cells while the tiles of 
+    // one tile row are processed from left to right, so the cells are swept
+    // only once no matter how many tiles the shape covers.
+    //------------------------------------------------------------------------
+    class batch_rasterizer
+    {
+    public:
+        enum
+        {
+            tile_shift = 6,
+            tile_size  = 1 << tile_shift
+        };
+
+        ~batch_rasterizer();
+
+        // The cells of the frame are kept in at most "budget" bytes,
+        // the shapes that don't fit are dropped, see num_dropped_cells()
+        batch_rasterizer(unsigned budget = cell_arena::default_budget);
+
+        //--------------------------------------------------------------------
+        void reset();
+
+        //--------------------------------------------------------------------
+        void gamma(double g);
+        void gamma(const int8u* g);
+
+        //--------------------------------------------------------------------
+        // The same as rasterizer::clip_box()
+        void clip_box(int x1, int y1, int x2, int y2)
+        {
+            m_outline.clip_box(x1 * poly_base_size, y1 * poly_base_size, 
+                               x2 * poly_base_size, y2 * poly_base_size);
+        }
+        void reset_clipping() { m_outline.reset_clipping(); }
+
+        //--------------------------------------------------------------------
+        void move_to(int x, int y) { m_outline.move_to(x, y); }
+        void line_to(int x, int y) { m_outline.line_to(x, y); }
+
+        //--------------------------------------------------------------------
+        void move_to_d(double x, double y) { m_outline.move_to(poly_coord(x), 
+                                                               poly_coord(y)); }
+        void line_to_d(double x, double y) { m_outline.line_to(poly_coord(x), 
+                                                               poly_coord(y)); }
+
+        //--------------------------------------------------------------------
+        // The same as rasterizer::add_path()
+        template<class VertexSource> void add_path(VertexSource& vs, 
+                                                   unsigned path_id = 0)
+        {
+            int x;
+            int y;
+            unsigned cmd;
+            vs.rewind(path_id);
+            while((cmd = vs.vertex(&x, &y)) != path_cmd_stop)
+            {
+                if(cmd == path_cmd_move_to) m_outline.move_to(x, y);
+                else 
+                if(cmd == path_cmd_line_to) m_outline.line_to(x, y);
+            }
+        }
+
+        //--------------------------------------------------------------------
+        // The same as rasterizer::add_poly() and rasterizer::add_path()
+        void add_poly(const int* xy, unsigned n, bool closed = true)
+        {
+            m_outline.add_poly(xy, n, closed);
+        }
+        void add_path(const path_storage& ps, unsigned path_id = 0)
+        {
+            m_outline.add_path(ps, path_id);
+        }
+        void add_path(path_storage& ps, unsigned path_id = 0)
+        {
+            m_outline.add_path(ps, path_id);
+        }
+
+        //--------------------------------------------------------------------
+        void add(const rgba8& c, filling_rule_e filling_rule = fill_non_zero);
+
+        unsigned num_shapes() const { return m_num_shapes; }
+
+        // The number of the cells dropped by all the shapes since reset()
+        unsigned num_dropped_cells() const { return m_num_dropped; }
+
+        //--------------------------------------------------------------------
+        template<class Renderer> void render(Renderer& r)
+        {
+            if(m_num_shapes == 0) return;
+            AGG_STATS_TIMER_START(t);
+
+            int width  = int(r.rbuf().width());
+            int height = int(r.rbuf().height());
+            int min_y  = m_min_y < 0 ? 0 : m_min_y;
+            int max_y  = m_max_y < height ? m_max_y : height - 1;
+            int tx, ty;
+
+            for(ty = min_y & ~(tile_size - 1); ty <= max_y; ty += tile_size)
+            {
+                int ty2 = ty + tile_size - 1;
+                if(ty2 > max_y) ty2 = max_y;
+
+                unsigned num_active = activate_shapes(ty, ty2, width);
+                if(num_active == 0) continue;
+
+                for(tx = 0; tx < width; tx += tile_size)
+                {
+                    int tx2 = tx + tile_size - 1;
+                    if(tx2 >= width) tx2 = width - 1;
+
+                    m_scanline.reset(tx, tx2);
+
+                    unsigned i;
+                    for(i = 0; i < num_active; i++)
+                    {
+                        const shape& sh = m_shapes[m_active[i]];
+                        if(sh.min_x > tx2 || sh.max_x < tx) continue;
+
+                        int y1 = sh.min_y > ty  ? sh.min_y : ty;
+                        int y2 = sh.max_y < ty2 ? sh.max_y : ty2;
+                        cursor* cur = m_cursors + i * tile_size + (y1 - ty);
+                        int y;
+                        for(y = y1; y <= y2; y++, cur++)
+                        {
+                            sweep_tile(sh, y, *cur, tx, tx2 + 1);
+                            if(m_scanline.num_spans())
+                            {
+                                r.render(m_scanline, sh.color);
+                                m_scanline.reset_spans();
+                            }
+                        }
+                    }
+                }
+            }
+            AGG_STATS_TIMER_STOP(t, sweep_cycles);
+        }
+
+    private:
+        batch_rasterizer(const batch_rasterizer&);
+        const batch_rasterizer& operator = (const batch_rasterizer&);
+
+        struct shape
+        {
+            rgba8          color;
+            filling_rule_e filling_rule;
+            int            min_x;
+            int            min_y;
+            int            max_x;
+            int            max_y;
+            unsigned       rows;
+        };
+
+        struct row
+        {
+            unsigned start;
+            unsigned num;
+        };
+
+        // The state of the sweep of one row between the tiles
+        struct cursor
+        {
+            unsigned idx;
+            int      x;
+            int      cover;
+        };
+
+        unsigned activate_shapes(int ty1, int ty2, int width);
+        void sweep_tile(const shape& sh, int y, cursor& cur, int x1, int x2);
+
+    private:
+        outline   m_outline;
+        scanline  m_scanline;
+        int8u     m_gamma[256];
+        cell*     m_cells;
+        unsigned  m_num_cells;
+        unsigned  m_max_cells;
+        row*      m_rows;
+        unsigned  m_num_rows;
+        unsigned  m_max_rows;
+        shape*    m_shapes;
+        unsigned  m_num_shapes;
+        unsigned  m_max_shapes;
+        unsigned* m_active;
+        cursor*   m_cursors;
+        unsigned  m_max_active;
+        unsigned  m_budget;
+        unsigned  m_allocated;
+        unsigned  m_num_dropped;
+        int       m_min_y;
+        int       m_max_y;
+    };
+
+
+
+    //========================================================================
+    // Renders many filled shapes of different colors in one pass. Like in 
+    // batch_rasterizer, each shape is made with move_to()/line_to() and 
+    // finished with add(), which gives it the next style - its color and
+    // filling rule. The cells of all the shapes go to one outline. render()
+    // sorts them once: a counting sort by Y, which keeps the cells of every
+    // scanline in the order of add(), the index of the style replaces Y in
+    // the key, and the cells of every style are sorted by X. Then every 
+    // scanline is composited in a copy of the row: the pixels are read 
+    // once, all the styles that cover them are blended in the order of 
+    // add(), and the changed pixels are written back once. There can be 
+    // at most max_styles styles, the cells of the rest are dropped. All 
+    // the cells of the frame are kept until render(), so it pays off only
+    // when the access to the frame buffer costs more than the sort of the
+    // whole frame, see the compound comparison of agg_bench.
+    //
+    // The copy is in the pixel format of the renderer and the styles are
+    // blended into it with the render() and blend_hline() of its span, so
+    // the result is exactly the same as of rendering the shapes one by 
+    // one, in any pixel format.
+    //------------------------------------------------------------------------
+    class compound_rasterizer
+    {
+    public:
+        enum
+        {
+            max_styles = 1 << cell::coord_bits
+        };
+
+        ~compound_rasterizer();
+
+        // The cells and their sorted copy are kept in an arena of at most
+        // "budget" bytes, see cell_arena
+        compound_rasterizer(unsigned budget = cell_arena::default_budget);
+
+        //--------------------------------------------------------------------
+        void reset();
+
+        //--------------------------------------------------------------------
+        void gamma(double g);
+        void gamma(const int8u* g);
+
+        //--------------------------------------------------------------------
+        // The same as rasterizer::clip_box()
+        void clip_box(int x1, int y1, int x2, int y2)
+        {
+            m_outline.clip_box(x1 * poly_base_size, y1 * poly_base_size, 
+                               x2 * poly_base_size, y2 * poly_base_size);
+        }
+        void reset_clipping() { m_outline.reset_clipping(); }
+
+        //--------------------------------------------------------------------
+        void move_to(int x, int y) { m_outline.move_to(x, y); }
+        void line_to(int x, int y) { m_outline.line_to(x, y); }
+
+        //--------------------------------------------------------------------
+        void move_to_d(double x, double y) { m_outline.move_to(poly_coord(x), 
+                                                               poly_coord(y)); }
+        void line_to_d(double x, double y) { m_outline.line_to(poly_coord(x), 
+                                                               poly_coord(y)); }
+
+        //--------------------------------------------------------------------
+        // The same as rasterizer::add_path()
+        template<class VertexSource> void add_path(VertexSource& vs, 
+                                                   unsigned path_id = 0)
+        {
+            int x;
+            int y;
+            unsigned cmd;
+            vs.rewind(path_id);
+            while((cmd = vs.vertex(&x, &y)) != path_cmd_stop)
+            {
+                if(cmd == path_cmd_move_to) m_outline.move_to(x, y);
+                else 
+                if(cmd == path_cmd_line_to) m_outline.line_to(x, y);
+            }
+        }
+
+        //--------------------------------------------------------------------
+        // The same as rasterizer::add_poly() and rasterizer::add_path()
+        void add_poly(const int* xy, unsigned n, bool closed = true)
+        {
+            m_outline.add_poly(xy, n, closed);
+        }
+        void add_path(const path_storage& ps, unsigned path_id = 0)
+        {
+            m_outline.add_path(ps, path_id);
+        }
+        void add_path(path_storage& ps, unsigned path_id = 0)
+        {
+            m_outline.add_path(ps, path_id);
+        }
+
+        //--------------------------------------------------------------------
+        // Finishes the current shape, its style is the next index
+        void add(const rgba8& c, filling_rule_e filling_rule = fill_non_zero);
+
+        unsigned num_styles() const { return m_num_styles; }
+
+        // The number of the cells dropped by all the shapes since reset()
+        unsigned num_dropped_cells() const 
+        { 
+            return m_outline.num_dropped_cells() + m_num_dropped; 
+        }
+
+        //--------------------------------------------------------------------
+        template<class Renderer> void render(Renderer& r)
+        {
+            int width  = int(r.rbuf().width());
+            int height = int(r.rbuf().height());
+            AGG_STATS_TIMER_START(t1);
+            if(!sort_cells(width, Renderer::pix_width)) return;
+            AGG_STATS_TIMER_STOP(t1, sort_cycles);
+
+            blender b;
+            b.render      = Renderer::span_type::render;
+            b.blend_hline = Renderer::span_type::blend_hline;
+
+            AGG_STATS_TIMER_START(t2);
+            int y1 = (m_outline.min_y() > 0) ? m_outline.min_y() : 0;
+            int y2 = (m_outline.max_y() < height - 1) ? m_outline.max_y() : height - 1;
+            int y;
+            for(y = y1; y <= y2; y++)
+            {
+                int x1;
+                int x2;
+                if(!row_range(y, width, &x1, &x2)) continue;
+
+                r.read_hline(x1, y, unsigned(x2 - x1 + 1), m_pixels);
+                composite_row(b, y, x1, x2);
+
+                // Write back the runs of the changed pixels
+                int x = x1;
+                while(x <= x2)
+                {
+                    if(m_mask[x] == 0)
+                    {
+                        x++;
+                        continue;
+                    }
+                    int start = x;
+                    do m_mask[x++] = 0; while(x <= x2 && m_mask[x]);
+                    r.write_hline(start, y, unsigned(x - start), m_pixels);
+                }
+            }
+            AGG_STATS_TIMER_STOP(t2, sweep_cycles);
+        }
+
+    private:
+        compound_rasterizer(const compound_rasterizer&);
+        const compound_rasterizer& operator = (const compound_rasterizer&);
+
+        // The cells of a style are the ones from the end of the previous 
+        // style to "end" in the order of the outline
+        struct style_info
+        {
+            rgba8          color;
+            filling_rule_e filling_rule;
+            unsigned       end;
+        };
+
+        // The sorted cells of a scanline
+        struct row
+        {
+            unsigned start;
+            unsigned num;
+        };
+
+        // The blending functions of the span of the renderer
+        struct blender
+        {
+            void (*render)(unsigned char* ptr, int x, unsigned count, 
+                           const unsigned char* covers, const rgba8& c);
+            void (*blend_hline)(unsigned char* ptr, int x, unsigned count, 
+                                const rgba8& c, unsigned cover);
+        };
+
+        bool sort_cells(int width, unsigned pix_width);
+        bool row_range(int y, int width, int* x1, int* x2) const;
+        void composite_row(const blender& b, int y, int x1, int x2);
+
+    private:
+        cell_arena  m_arena;
+        outline     m_outline;
+        int8u       m_gamma[256];
+        cell*       m_sorted_cells;
+        row*        m_rows;
+        style_info* m_styles;
+        unsigned    m_num_styles;
+        unsigned    m_max_styles;
+        int8u*      m_pixels;
+        unsigned    m_max_pixels;
+        int8u*      m_mask;
+        int8u*      m_covers;
+        unsigned    m_max_width;
+        unsigned    m_num_dropped;
+        bool        m_sorted;
     };
 
 
     //========================================================================
     struct span_mono8
     {
+        enum { pix_width = 1 };
+
         //--------------------------------------------------------------------
         static unsigned mono8(unsigned r, unsigned g, unsigned b)
         {
@@ -814,6 +2425,30 @@ namespace agg
             while(--count);
         }
 
+        //--------------------------------------------------------------------
+        static void blend_hline(unsigned char* ptr, 
+                                int x,
+                                unsigned count, 
+                                const rgba8& c,
+                                unsigned cover)
+        {
+            int alpha = cover * c.a;
+            if(alpha == 255 * 255)
+            {
+                hline(ptr, x, count, c);
+                return;
+            }
+
+            unsigned char* p = ptr + x;
+            unsigned dst = mono8(c.r, c.g, c.b);
+            do
+            {
+                unsigned src = *p;
+                *p++ = (((dst - src) * alpha) + (src << 16)) >> 16;
+            }
+            while(--count);
+        }
+
         //--------------------------------------------------------------------
         static void hline(unsigned char* ptr, 
                           int x,
@@ -843,6 +2478,8 @@ namespace agg
     //========================================================================
     struct span_rgb555
     {
+        enum { pix_width = 2 };
+
         //--------------------------------------------------------------------
         static int16u rgb555(unsigned r, unsigned g, unsigned b)
         {
@@ -873,6 +2510,36 @@ namespace agg
             while(--count);
         }
 
+        //--------------------------------------------------------------------
+        static void blend_hline(unsigned char* ptr, 
+                                int x,
+                                unsigned count, 
+                                const rgba8& c,
+                                unsigned cover)
+        {
+            int alpha = cover * c.a;
+            if(alpha == 255 * 255)
+            {
+                hline(ptr, x, count, c);
+                return;
+            }
+
+            int16u* p = ((int16u*)ptr) + x;
+            do
+            {
+                int16 rgb = *p;
+
+                int r = (rgb >> 7) & 0xF8;
+                int g = (rgb >> 2) & 0xF8;
+                int b = (rgb << 3) & 0xF8;
+
+                *p++ = (((((c.r - r) * alpha) + (r << 16)) >> 9) & 0x7C00) |
+                       (((((c.g - g) * alpha) + (g << 16)) >> 14) & 0x3E0) |
+                        ((((c.b - b) * alpha) + (b << 16)) >> 19);
+            }
+            while(--count);
+        }
+
         //--------------------------------------------------------------------
         static void hline(unsigned char* ptr, 
                           int x,
@@ -903,6 +2570,8 @@ namespace agg
     //========================================================================
     struct span_rgb565
     {
+        enum { pix_width = 2 };
+
         //--------------------------------------------------------------------
         static int16u rgb565(unsigned r, unsigned g, unsigned b)
         {
@@ -933,6 +2602,36 @@ namespace agg
             while(--count);
         }
 
+        //--------------------------------------------------------------------
+        static void blend_hline(unsigned char* ptr, 
+                                int x,
+                                unsigned count, 
+                                const rgba8& c,
+                                unsigned cover)
+        {
+            int alpha = cover * c.a;
+            if(alpha == 255 * 255)
+            {
+                hline(ptr, x, count, c);
+                return;
+            }
+
+            int16u* p = ((int16u*)ptr) + x;
+            do
+            {
+                int16 rgb = *p;
+
+                int r = (rgb >> 8) & 0xF8;
+                int g = (rgb >> 3) & 0xFC;
+                int b = (rgb << 3) & 0xF8;
+
+                *p++ = (((((c.r - r) * alpha) + (r << 16)) >> 8) & 0xF800) |
+                       (((((c.g - g) * alpha) + (g << 16)) >> 13) & 0x7E0) |
+                        ((((c.b - b) * alpha) + (b << 16)) >> 19);
+            }
+            while(--count);
+        }
+
         //--------------------------------------------------------------------
         static void hline(unsigned char* ptr, 
                           int x,
@@ -962,6 +2661,8 @@ namespace agg
     //========================================================================
     struct span_bgr24
     {
+        enum { pix_width = 3 };
+
         //--------------------------------------------------------------------
         static void render(unsigned char* ptr, 
                            int x,
@@ -983,6 +2684,33 @@ namespace agg
             while(--count);
         }
 
+        //--------------------------------------------------------------------
+        static void blend_hline(unsigned char* ptr, 
+                                int x,
+                                unsigned count, 
+                                const rgba8& c,
+                                unsigned cover)
+        {
+            int alpha = cover * c.a;
+            if(alpha == 255 * 255)
+            {
+                hline(ptr, x, count, c);
+                return;
+            }
+
+            unsigned char* p = ptr + x + x + x;
+            do
+            {
+                int b = p[0];
+                int g = p[1];
+                int r = p[2];
+                *p++ = (((c.b - b) * alpha) + (b << 16)) >> 16;
+                *p++ = (((c.g - g) * alpha) + (g << 16)) >> 16;
+                *p++ = (((c.r - r) * alpha) + (r << 16)) >> 16;
+            }
+            while(--count);
+        }
+
         //--------------------------------------------------------------------
         static void hline(unsigned char* ptr, 
                           int x,
@@ -1011,6 +2739,8 @@ namespace agg
     //========================================================================
     struct span_rgb24
     {
+        enum { pix_width = 3 };
+
         //--------------------------------------------------------------------
         static void render(unsigned char* ptr, 
                            int x,
@@ -1032,6 +2762,33 @@ namespace agg
             while(--count);
         }
 
+        //--------------------------------------------------------------------
+        static void blend_hline(unsigned char* ptr, 
+                                int x,
+                                unsigned count, 
+                                const rgba8& c,
+                                unsigned cover)
+        {
+            int alpha = cover * c.a;
+            if(alpha == 255 * 255)
+            {
+                hline(ptr, x, count, c);
+                return;
+            }
+
+            unsigned char* p = ptr + x + x + x;
+            do
+            {
+                int r = p[0];
+                int g = p[1];
+                int b = p[2];
+                *p++ = (((c.r - r) * alpha) + (r << 16)) >> 16;
+                *p++ = (((c.g - g) * alpha) + (g << 16)) >> 16;
+                *p++ = (((c.b - b) * alpha) + (b << 16)) >> 16;
+            }
+            while(--count);
+        }
+
         //--------------------------------------------------------------------
         static void hline(unsigned char* ptr, 
                           int x,
@@ -1057,9 +2814,51 @@ namespace agg
 
 
 
+#ifdef AGG_SPAN_SIMD
+    //========================================================================
+    // The SIMD loops of agg_span_simd.h for the spans of 4 bytes per pixel,
+    // R, G, B, A are the offsets of the channels in a pixel. They return
+    // false if the span is to be drawn by the scalar loop.
+    //------------------------------------------------------------------------
+    template<unsigned R, unsigned G, unsigned B, unsigned A> struct span_simd32
+    {
+        static bool blend(unsigned char* ptr, int x, unsigned count,
+                          const unsigned char* covers,
+                          const rgba8& c, unsigned alpha)
+        {
+            if(count < span_simd_min_count || span_simd.blend32 == 0) return false;
+            int8u color[4];
+            color[R] = c.r;
+            color[G] = c.g;
+            color[B] = c.b;
+            color[A] = c.a;
+            span_simd.blend32(ptr + (x << 2), count, covers, color, alpha);
+            return true;
+        }
+
+        static bool fill(unsigned char* ptr, int x, unsigned count,
+                         const rgba8& c)
+        {
+            if(count < span_simd_min_count || span_simd.fill32 == 0) return false;
+            int8u color[4];
+            color[R] = c.r;
+            color[G] = c.g;
+            color[B] = c.b;
+            color[A] = c.a;
+            unsigned v;
+            memcpy(&v, color, 4);
+            span_simd.fill32((unsigned*)ptr + x, count, v);
+            return true;
+        }
+    };
+#endif
+
+
     //========================================================================
     struct span_abgr32
     {
+        enum { pix_width = 4 };
+
         //--------------------------------------------------------------------
         static void render(unsigned char* ptr, 
                            int x,
@@ -1067,6 +2866,9 @@ namespace agg
                            const unsigned char* covers, 
                            const rgba8& c)
         {
+#ifdef AGG_SPAN_SIMD
+            if(span_simd32<3, 2, 1, 0>::blend(ptr, x, count, covers, c, c.a)) return;
+#endif
             unsigned char* p = ptr + (x << 2);
             do
             {
@@ -1083,12 +2885,47 @@ namespace agg
             while(--count);
         }
 
+        //--------------------------------------------------------------------
+        static void blend_hline(unsigned char* ptr, 
+                                int x,
+                                unsigned count, 
+                                const rgba8& c,
+                                unsigned cover)
+        {
+            int alpha = cover * c.a;
+            if(alpha == 255 * 255)
+            {
+                hline(ptr, x, count, c);
+                return;
+            }
+#ifdef AGG_SPAN_SIMD
+            if(span_simd32<3, 2, 1, 0>::blend(ptr, x, count, 0, c, alpha)) return;
+#endif
+
+            unsigned char* p = ptr + (x << 2);
+            do
+            {
+                int a = p[0];
+                int b = p[1];
+                int g = p[2];
+                int r = p[3];
+                *p++ = (((c.a - a) * alpha) + (a << 16)) >> 16;
+                *p++ = (((c.b - b) * alpha) + (b << 16)) >> 16;
+                *p++ = (((c.g - g) * alpha) + (g << 16)) >> 16;
+                *p++ = (((c.r - r) * alpha) + (r << 16)) >> 16;
+            }
+            while(--count);
+        }
+
         //--------------------------------------------------------------------
         static void hline(unsigned char* ptr, 
                           int x,
                           unsigned count, 
                           const rgba8& c)
         {
+#ifdef AGG_SPAN_SIMD
+            if(span_simd32<3, 2, 1, 0>::fill(ptr, x, count, c)) return;
+#endif
             unsigned char* p = ptr + (x << 2);
             do { *p++ = c.a; *p++ = c.b; *p++ = c.g; *p++ = c.r; } while(--count);
         }
@@ -1112,6 +2949,8 @@ namespace agg
     //========================================================================
     struct span_argb32
     {
+        enum { pix_width = 4 };
+
         //--------------------------------------------------------------------
         static void render(unsigned char* ptr, 
                            int x,
@@ -1119,6 +2958,9 @@ namespace agg
                            const unsigned char* covers, 
                            const rgba8& c)
         {
+#ifdef AGG_SPAN_SIMD
+            if(span_simd32<1, 2, 3, 0>::blend(ptr, x, count, covers, c, c.a)) return;
+#endif
             unsigned char* p = ptr + (x << 2);
             do
             {
@@ -1135,12 +2977,47 @@ namespace agg
             while(--count);
         }
 
+        //--------------------------------------------------------------------
+        static void blend_hline(unsigned char* ptr, 
+                                int x,
+                                unsigned count, 
+                                const rgba8& c,
+                                unsigned cover)
+        {
+            int alpha = cover * c.a;
+            if(alpha == 255 * 255)
+            {
+                hline(ptr, x, count, c);
+                return;
+            }
+#ifdef AGG_SPAN_SIMD
+            if(span_simd32<1, 2, 3, 0>::blend(ptr, x, count, 0, c, alpha)) return;
+#endif
+
+            unsigned char* p = ptr + (x << 2);
+            do
+            {
+                int a = p[0];
+                int r = p[1];
+                int g = p[2];
+                int b = p[3];
+                *p++ = (((c.a - a) * alpha) + (a << 16)) >> 16;
+                *p++ = (((c.r - r) * alpha) + (r << 16)) >> 16;
+                *p++ = (((c.g - g) * alpha) + (g << 16)) >> 16;
+                *p++ = (((c.b - b) * alpha) + (b << 16)) >> 16;
+            }
+            while(--count);
+        }
+
         //--------------------------------------------------------------------
         static void hline(unsigned char* ptr, 
                           int x,
                           unsigned count, 
                           const rgba8& c)
         {
+#ifdef AGG_SPAN_SIMD
+            if(span_simd32<1, 2, 3, 0>::fill(ptr, x, count, c)) return;
+#endif
             unsigned char* p = ptr + (x << 2);
             do { *p++ = c.a; *p++ = c.r; *p++ = c.g; *p++ = c.b; } while(--count);
         }
@@ -1163,6 +3040,8 @@ namespace agg
     //========================================================================
     struct span_bgra32
     {
+        enum { pix_width = 4 };
+
         //--------------------------------------------------------------------
         static void render(unsigned char* ptr, 
                            int x,
@@ -1170,6 +3049,9 @@ namespace agg
                            const unsigned char* covers, 
                            const rgba8& c)
         {
+#ifdef AGG_SPAN_SIMD
+            if(span_simd32<2, 1, 0, 3>::blend(ptr, x, count, covers, c, c.a)) return;
+#endif
             unsigned char* p = ptr + (x << 2);
             do
             {
@@ -1186,12 +3068,47 @@ namespace agg
             while(--count);
         }
 
+        //--------------------------------------------------------------------
+        static void blend_hline(unsigned char* ptr, 
+                                int x,
+                                unsigned count, 
+                                const rgba8& c,
+                                unsigned cover)
+        {
+            int alpha = cover * c.a;
+            if(alpha == 255 * 255)
+            {
+                hline(ptr, x, count, c);
+                return;
+            }
+#ifdef AGG_SPAN_SIMD
+            if(span_simd32<2, 1, 0, 3>::blend(ptr, x, count, 0, c, alpha)) return;
+#endif
+
+            unsigned char* p = ptr + (x << 2);
+            do
+            {
+                int b = p[0];
+                int g = p[1];
+                int r = p[2];
+                int a = p[3];
+                *p++ = (((c.b - b) * alpha) + (b << 16)) >> 16;
+                *p++ = (((c.g - g) * alpha) + (g << 16)) >> 16;
+                *p++ = (((c.r - r) * alpha) + (r << 16)) >> 16;
+                *p++ = (((c.a - a) * alpha) + (a << 16)) >> 16;
+            }
+            while(--count);
+        }
+
         //--------------------------------------------------------------------
         static void hline(unsigned char* ptr, 
                           int x,
                           unsigned count, 
                           const rgba8& c)
         {
+#ifdef AGG_SPAN_SIMD
+            if(span_simd32<2, 1, 0, 3>::fill(ptr, x, count, c)) return;
+#endif
             unsigned char* p = ptr + (x << 2);
             do { *p++ = c.b; *p++ = c.g; *p++ = c.r; *p++ = c.a; } while(--count);
         }
@@ -1215,6 +3132,8 @@ namespace agg
     //========================================================================
     struct span_rgba32
     {
+        enum { pix_width = 4 };
+
         //--------------------------------------------------------------------
         static void render(unsigned char* ptr, 
                            int x,
@@ -1222,6 +3141,9 @@ namespace agg
                            const unsigned char* covers, 
                            const rgba8& c)
         {
+#ifdef AGG_SPAN_SIMD
+            if(span_simd32<0, 1, 2, 3>::blend(ptr, x, count, covers, c, c.a)) return;
+#endif
             unsigned char* p = ptr + (x << 2);
             do
             {
@@ -1238,12 +3160,47 @@ namespace agg
             while(--count);
         }
 
+        //--------------------------------------------------------------------
+        static void blend_hline(unsigned char* ptr, 
+                                int x,
+                                unsigned count, 
+                                const rgba8& c,
+                                unsigned cover)
+        {
+            int alpha = cover * c.a;
+            if(alpha == 255 * 255)
+            {
+                hline(ptr, x, count, c);
+                return;
+            }
+#ifdef AGG_SPAN_SIMD
+            if(span_simd32<0, 1, 2, 3>::blend(ptr, x, count, 0, c, alpha)) return;
+#endif
+
+            unsigned char* p = ptr + (x << 2);
+            do
+            {
+                int r = p[0];
+                int g = p[1];
+                int b = p[2];
+                int a = p[3];
+                *p++ = (((c.r - r) * alpha) + (r << 16)) >> 16;
+                *p++ = (((c.g - g) * alpha) + (g << 16)) >> 16;
+                *p++ = (((c.b - b) * alpha) + (b << 16)) >> 16;
+                *p++ = (((c.a - a) * alpha) + (a << 16)) >> 16;
+            }
+            while(--count);
+        }
+
         //--------------------------------------------------------------------
         static void hline(unsigned char* ptr, 
                           int x,
                           unsigned count, 
                           const rgba8& c)
         {
+#ifdef AGG_SPAN_SIMD
+            if(span_simd32<0, 1, 2, 3>::fill(ptr, x, count, c)) return;
+#endif
             unsigned char* p = ptr + (x << 2);
             do { *p++ = c.r; *p++ = c.g; *p++ = c.b; *p++ = c.a; } while(--count);
         }
@@ -1266,6 +3223,8 @@ namespace agg
     //========================================================================
     struct span_rgb101010
     {
+        enum { pix_width = 4 };
+
         //--------------------------------------------------------------------
         static void render(unsigned char* ptr, 
                            int x,
@@ -1273,6 +3232,14 @@ namespace agg
                            const unsigned char* covers, 
                            const rgba8& c)
         {
+#ifdef AGG_SPAN_SIMD
+            if(count >= span_simd_min_count && span_simd.blend101010)
+            {
+                span_simd.blend101010((unsigned*)ptr + x, count, covers, 
+                                      c.r << 2, c.g << 2, c.b << 2, c.a);
+                return;
+            }
+#endif
             unsigned int* p = (unsigned int *)ptr + x;
             do
             {
@@ -1291,6 +3258,45 @@ namespace agg
             while(--count);
         }
 
+        //--------------------------------------------------------------------
+        static void blend_hline(unsigned char* ptr, 
+                                int x,
+                                unsigned count, 
+                                const rgba8& c,
+                                unsigned cover)
+        {
+            int alpha = cover * c.a;
+            if(alpha == 255 * 255)
+            {
+                hline(ptr, x, count, c);
+                return;
+            }
+#ifdef AGG_SPAN_SIMD
+            if(count >= span_simd_min_count && span_simd.blend101010)
+            {
+                span_simd.blend101010((unsigned*)ptr + x, count, 0, 
+                                      c.r << 2, c.g << 2, c.b << 2, alpha);
+                return;
+            }
+#endif
+
+            unsigned int* p = (unsigned int *)ptr + x;
+            do
+            {
+                int r = (*p >> 20) & 0x3ff;
+                int g = (*p >> 10) & 0x3ff;
+                int b = *p & 0x3ff;
+                int cr = c.r << 2;
+                int cg = c.g << 2;
+                int cb = c.b << 2;
+                int dr = (((cr - r) * alpha) + (r << 16)) >> 16;
+                int dg = (((cg - g) * alpha) + (g << 16)) >> 16;
+                int db = (((cb - b) * alpha) + (b << 16)) >> 16;
+                *p++ = (dr << 20) | (dg << 10) | db;
+            }
+            while(--count);
+        }
+
         //--------------------------------------------------------------------
         static void hline(unsigned char* ptr, 
                           int x,
@@ -1299,6 +3305,13 @@ namespace agg
         {
             unsigned int* p = (unsigned int *)ptr + x;
             unsigned int c10 = (c.r << 22) | (c.g << 12) | (c.b << 2);
+#ifdef AGG_SPAN_SIMD
+            if(count >= span_simd_min_count && span_simd.fill32)
+            {
+                span_simd.fill32(p, count, c10);
+                return;
+            }
+#endif
             do { *p++ = c10; } while(--count);
         }
 
@@ -0,0 +1,537 @@
+//----------------------------------------------------------------------------
+// Anti-Grain Geometry - Version 2.1 Lite
+// Copyright (C) 2002-2003 Maxim Shemanarev (McSeem)
+//
+// Permission to copy, use, modify, sell and distribute this software
+// is granted provided this copyright notice appears in all copies.
+// This software is provided "as is" without express or implied
+// warranty, and with no claim as to its suitability for any purpose.
+//
+//----------------------------------------------------------------------------
+//
+// Vertex source converters: conv_transform, conv_curve, conv_clip,
+// conv_stroke and conv_decimate. Each one is a vertex source that pulls
+// the vertices from another one by rewind()/vertex() and converts them on
+// the fly, so they can be chained without any intermediate storage:
+//
+//     agg::path_storage path;                 // with curves
+//     agg::trans_affine mtx;
+//     agg::conv_transform<agg::path_storage>  trans(path, mtx);
+//     agg::conv_curve<agg::conv_transform<agg::path_storage> > curve(trans);
+//     agg::conv_stroke<agg::conv_curve<
+//         agg::conv_transform<agg::path_storage> > >  stroke(curve);
+//     stroke.width(agg::poly_coord(3.0));
+//     ras.add_path(stroke);
+//
+// They're templates, the whole chain is inlined into add_path(). Nothing
+// is allocated per vertex or per frame, except that the stroker keeps
+// the polylines until its memory is big enough for the largest path.
+//
+//----------------------------------------------------------------------------
+#ifndef AGG_CONV_INCLUDED
+#define AGG_CONV_INCLUDED
+
+#include "agg_stroke.h"
+#include "agg_trans_affine.h"
+
+namespace agg
+{
+
+    //========================================================================
+    // Transforms the vertices, the Transformer is anything with
+    // transform(int* x, int* y) const, like trans_affine.
+    //------------------------------------------------------------------------
+    template<class VertexSource, class Transformer = trans_affine>
+    class conv_transform
+    {
+    public:
+        conv_transform(VertexSource& source, const Transformer& tr) :
+            m_source(&source), m_trans(&tr) {}
+
+        void attach(VertexSource& source)        { m_source = &source; }
+        void transformer(const Transformer& tr)  { m_trans  = &tr; }
+
+        //--------------------------------------------------------------------
+        void rewind(unsigned path_id) { m_source->rewind(path_id); }
+
+        unsigned vertex(int* x, int* y)
+        {
+            unsigned cmd = m_source->vertex(x, y);
+            if(cmd >= path_cmd_move_to && cmd < path_cmd_end_poly)
+            {
+                m_trans->transform(x, y);
+            }
+            return cmd;
+        }
+
+    private:
+        conv_transform(const conv_transform&);
+        const conv_transform& operator = (const conv_transform&);
+
+        VertexSource*      m_source;
+        const Transformer* m_trans;
+    };
+
+
+
+    //========================================================================
+    // Flattens the curves of the source, path_cmd_curve3/path_cmd_curve4,
+    // into line_to() with curve3/curve4, all the other commands pass
+    // through. The tolerance is in subpixels, see agg_curves.h.
+    //------------------------------------------------------------------------
+    template<class VertexSource> class conv_curve
+    {
+    public:
+        conv_curve(VertexSource& source) :
+            m_source(&source),
+            m_tolerance(curve_tolerance),
+            m_curve(0),
+            m_last_x(0),
+            m_last_y(0)
+        {
+        }
+
+        void attach(VertexSource& source) { m_source = &source; }
+
+        void tolerance(int t) { m_tolerance = t; }
+        int  tolerance() const { return m_tolerance; }
+
+        //--------------------------------------------------------------------
+        void rewind(unsigned path_id)
+        {
+            m_source->rewind(path_id);
+            m_curve  = 0;
+            m_last_x = 0;
+            m_last_y = 0;
+        }
+
+        unsigned vertex(int* x, int* y)
+        {
+            if(m_curve == path_cmd_curve3)
+            {
+                if(m_curve3.vertex(x, y) != path_cmd_stop) return path_cmd_line_to;
+                m_curve = 0;
+            }
+            if(m_curve == path_cmd_curve4)
+            {
+                if(m_curve4.vertex(x, y) != path_cmd_stop) return path_cmd_line_to;
+                m_curve = 0;
+            }
+
+            int x2 = 0;
+            int y2 = 0;
+            int x3 = 0;
+            int y3 = 0;
+            unsigned cmd = m_source->vertex(x, y);
+            switch(cmd)
+            {
+            case path_cmd_curve3:
+                m_source->vertex(&x2, &y2);
+                m_curve3.init(m_last_x, m_last_y, *x, *y, x2, y2, m_tolerance);
+                m_curve3.vertex(x, y);          // The move_to() to the start
+                m_curve3.vertex(x, y);
+                m_curve = path_cmd_curve3;
+                m_last_x = x2;
+                m_last_y = y2;
+                return path_cmd_line_to;
+
+            case path_cmd_curve4:
+                m_source->vertex(&x2, &y2);
+                m_source->vertex(&x3, &y3);
+                m_curve4.init(m_last_x, m_last_y, *x, *y, x2, y2, x3, y3,
+                              m_tolerance);
+                m_curve4.vertex(x, y);          // The move_to() to the start
+                m_curve4.vertex(x, y);
+                m_curve = path_cmd_curve4;
+                m_last_x = x3;
+                m_last_y = y3;
+                return path_cmd_line_to;
+
+            case path_cmd_move_to:
+            case path_cmd_line_to:
+                m_last_x = *x;
+                m_last_y = *y;
+                break;
+            }
+            return cmd;
+        }
+
+    private:
+        conv_curve(const conv_curve&);
+        const conv_curve& operator = (const conv_curve&);
+
+        VertexSource* m_source;
+        int           m_tolerance;
+        unsigned      m_curve;          // The command of the current curve
+        int           m_last_x;
+        int           m_last_y;
+        curve3        m_curve3;
+        curve4        m_curve4;
+    };
+
+
+
+    //========================================================================
+    // Clips the polygons of the source to a box in subpixels with
+    // polygon_clipper, like the rasterizer does with its clip_box(), for
+    // the consumers that don't clip. The result has only move_to() and
+    // line_to(), every contour is closed implicitly, so it's meant for the
+    // filled shapes. The source must not have curves, put conv_curve first.
+    // The output of one vertex of the source is kept in a small fixed
+    // queue: at most 13 vertices, when an edge crosses the corners of the
+    // box and closes the contour.
+    //------------------------------------------------------------------------
+    template<class VertexSource> class conv_clip
+    {
+        enum { max_out = 16 };
+
+    public:
+        conv_clip(VertexSource& source) :
+            m_source(&source),
+            m_num_out(0),
+            m_out_pos(0),
+            m_done(false)
+        {
+        }
+
+        void attach(VertexSource& source) { m_source = &source; }
+
+        void clip_box(int x1, int y1, int x2, int y2)
+        {
+            m_clipper.clip_box(x1, y1, x2, y2);
+        }
+
+        //--------------------------------------------------------------------
+        void rewind(unsigned path_id)
+        {
+            m_source->rewind(path_id);
+            m_clipper.reset();
+            m_num_out = 0;
+            m_out_pos = 0;
+            m_done    = false;
+        }
+
+        unsigned vertex(int* x, int* y)
+        {
+            while(m_out_pos >= m_num_out)
+            {
+                if(m_done) return path_cmd_stop;
+                m_num_out = 0;
+                m_out_pos = 0;
+
+                int vx;
+                int vy;
+                unsigned cmd = m_source->vertex(&vx, &vy);
+                sink s(this);
+                if(cmd == path_cmd_stop)
+                {
+                    m_clipper.close_polygon(s);
+                    m_done = true;
+                }
+                else
+                if(cmd == path_cmd_move_to) m_clipper.move_to(s, vx, vy);
+                else
+                if(cmd == path_cmd_line_to) m_clipper.line_to(s, vx, vy);
+            }
+            const out_vertex& v = m_out[m_out_pos++];
+            *x = v.x;
+            *y = v.y;
+            return v.cmd;
+        }
+
+    private:
+        conv_clip(const conv_clip&);
+        const conv_clip& operator = (const conv_clip&);
+
+        struct out_vertex
+        {
+            int      x;
+            int      y;
+            unsigned cmd;
+        };
+
+        void add(int x, int y, unsigned cmd)
+        {
+            out_vertex& v = m_out[m_num_out++];
+            v.x   = x;
+            v.y   = y;
+            v.cmd = cmd;
+        }
+
+        // Receives the output of the clipper
+        struct sink;
+        friend struct sink;
+        struct sink
+        {
+            conv_clip* self;
+            sink(conv_clip* c) : self(c) {}
+            void move_to(int x, int y) { self->add(x, y, path_cmd_move_to); }
+            void line_to(int x, int y) { self->add(x, y, path_cmd_line_to); }
+        };
+
+        VertexSource*   m_source;
+        polygon_clipper m_clipper;
+        out_vertex      m_out[max_out];
+        unsigned        m_num_out;
+        unsigned        m_out_pos;
+        bool            m_done;
+    };
+
+
+
+    //========================================================================
+    // Strokes the polylines of the source with agg::stroker. The stroker
+    // needs the whole polyline for the joins, so rewind() reads the source
+    // into it; its memory is reused from one rewind() to the next.
+    // path_cmd_end_poly with path_flags_close closes the polyline, the
+    // curves must be flattened first, see conv_curve.
+    //------------------------------------------------------------------------
+    template<class VertexSource> class conv_stroke
+    {
+    public:
+        conv_stroke(VertexSource& source) : m_source(&source) {}
+
+        void attach(VertexSource& source) { m_source = &source; }
+
+        //--------------------------------------------------------------------
+        void width(int w)              { m_stroker.width(w); }
+        void line_join(line_join_e lj) { m_stroker.line_join(lj); }
+        void line_cap(line_cap_e lc)   { m_stroker.line_cap(lc); }
+        void miter_limit(double ml)    { m_stroker.miter_limit(ml); }
+        void tolerance(int t)          { m_stroker.tolerance(t); }
+
+        int         width()     const { return m_stroker.width(); }
+        line_join_e line_join() const { return m_stroker.line_join(); }
+        line_cap_e  line_cap()  const { return m_stroker.line_cap(); }
+
+        //--------------------------------------------------------------------
+        void rewind(unsigned path_id)
+        {
+            int x;
+            int y;
+            unsigned cmd;
+            m_stroker.remove_all();
+            m_source->rewind(path_id);
+            while((cmd = m_source->vertex(&x, &y)) != path_cmd_stop)
+            {
+                if(cmd == path_cmd_move_to) m_stroker.move_to(x, y);
+                else
+                if(cmd == path_cmd_line_to) m_stroker.line_to(x, y);
+                else
+                if((cmd & path_cmd_mask) == path_cmd_end_poly &&
+                   (cmd & path_flags_close))
+                {
+                    m_stroker.close_polygon();
+                }
+            }
+            m_stroker.rewind(0);
+        }
+
+        unsigned vertex(int* x, int* y) { return m_stroker.vertex(x, y); }
+
+    private:
+        conv_stroke(const conv_stroke&);
+        const conv_stroke& operator = (const conv_stroke&);
+
+        VertexSource* m_source;
+        stroker       m_stroker;
+    };
+
+
+
+    //========================================================================
+    // Drops the vertices of the polylines whose removal moves the outline
+    // by at most the tolerance, in subpixels, i.e., 1/256 of a pixel of
+    // the 24.8 coordinates. It's a streaming filter with O(1) work per
+    // vertex, without square roots and divisions, like the one of 
+    // Reumann and Witkam:
+    //
+    // The vertices within the tolerance from the last one sent are dropped
+    // in any case. The first one beyond it gives the direction, then the 
+    // following ones are dropped as long as they're within the strip of 
+    // the half of the tolerance along that direction and go forward along
+    // it. When a vertex doesn't fit, the previous one is sent and becomes
+    // the start. So every dropped vertex is within the tolerance from the
+    // segment that replaces it, and so are the edges between them. The 
+    // first and the last vertex of a polyline are always kept, the curves
+    // must be flattened first, see conv_curve.
+    //
+    // The distance to the line is compared with the tolerance by the cross 
+    // product against the larger of |dx| and |dy|, which is never more 
+    // than the length, so the strip may be up to 30% narrower.
+    //------------------------------------------------------------------------
+    template<class VertexSource> class conv_decimate
+    {
+    public:
+        conv_decimate(VertexSource& source,
+                      int tolerance = poly_base_size / 16) :
+            m_source(&source),
+            m_tolerance(tolerance),
+            m_num_in(0),
+            m_num_out(0),
+            m_started(false),
+            m_skipped(false),
+            m_pending(false)
+        {
+        }
+
+        void attach(VertexSource& source) { m_source = &source; }
+
+        void tolerance(int t) { m_tolerance = t; }
+        int  tolerance() const { return m_tolerance; }
+
+        //--------------------------------------------------------------------
+        // The number of move_to() and line_to() read from the source and
+        // sent, since the creation or reset_counters()
+        unsigned num_vertices_in()  const { return m_num_in; }
+        unsigned num_vertices_out() const { return m_num_out; }
+        void reset_counters() { m_num_in = m_num_out = 0; }
+
+        //--------------------------------------------------------------------
+        void rewind(unsigned path_id)
+        {
+            m_source->rewind(path_id);
+            m_started = false;
+            m_skipped = false;
+            m_pending = false;
+        }
+
+        unsigned vertex(int* x, int* y)
+        {
+            if(m_pending)
+            {
+                m_pending = false;
+                if(m_pending_cmd == path_cmd_move_to ||
+                   m_pending_cmd == path_cmd_line_to)
+                {
+                    *x = m_pending_x;
+                    *y = m_pending_y;
+                }
+                return m_pending_cmd;
+            }
+
+            for(;;)
+            {
+                unsigned cmd = m_source->vertex(x, y);
+                if(cmd == path_cmd_line_to && m_started)
+                {
+                    ++m_num_in;
+                    if(m_skipped && fits(*x, *y)) continue;
+
+                    // The last one dropped is sent instead and becomes
+                    // the start, the new vertex is tried from it
+                    if(m_skipped)
+                    {
+                        int lx = m_last_x;
+                        int ly = m_last_y;
+                        start(lx, ly);
+                        fits(*x, *y);
+                        *x = lx;
+                        *y = ly;
+                        ++m_num_out;
+                        return path_cmd_line_to;
+                    }
+                    fits(*x, *y);
+                    continue;
+                }
+
+                // Any other command ends the polyline
+                if(cmd == path_cmd_move_to || cmd == path_cmd_line_to)
+                {
+                    ++m_num_in;
+                    ++m_num_out;
+                }
+                bool skipped = m_skipped;
+                int  lx = m_last_x;
+                int  ly = m_last_y;
+                m_started = cmd == path_cmd_move_to;
+                if(m_started) start(*x, *y);
+                else m_skipped = false;
+                if(skipped)
+                {
+                    m_pending     = true;
+                    m_pending_x   = *x;
+                    m_pending_y   = *y;
+                    m_pending_cmd = cmd;
+                    *x = lx;
+                    *y = ly;
+                    ++m_num_out;
+                    return path_cmd_line_to;
+                }
+                return cmd;
+            }
+        }
+
+    private:
+        conv_decimate(const conv_decimate&);
+        const conv_decimate& operator = (const conv_decimate&);
+
+        void start(int x, int y)
+        {
+            m_start_x = x;
+            m_start_y = y;
+            m_dir_x   = 0;
+            m_dir_y   = 0;
+            m_skipped = false;
+        }
+
+        // Tries to drop (x, y), keeps it as the last one if it can be
+        bool fits(int x, int y)
+        {
+            int64 dx = x - m_start_x;
+            int64 dy = y - m_start_y;
+            int64 t  = m_tolerance;
+            if(m_dir_x == 0 && m_dir_y == 0)
+            {
+                // Before the direction is known
+                if(dx * dx + dy * dy > t * t)
+                {
+                    m_dir_x    = int(dx);
+                    m_dir_y    = int(dy);
+                    m_dir_max  = (dx < 0) ? -dx : dx;
+                    if(dy > m_dir_max || -dy > m_dir_max) 
+                    {
+                        m_dir_max = (dy < 0) ? -dy : dy;
+                    }
+                    m_last_dot = dx * dx + dy * dy;
+                }
+            }
+            else
+            {
+                int64 dot = dx * m_dir_x + dy * m_dir_y;
+                if(dot < m_last_dot) return false;
+                int64 cross = dx * m_dir_y - dy * m_dir_x;
+                if(cross < 0) cross = -cross;
+                if(2 * cross > t * m_dir_max) return false;
+                m_last_dot = dot;
+            }
+            m_last_x  = x;
+            m_last_y  = y;
+            m_skipped = true;
+            return true;
+        }
+
+        VertexSource* m_source;
+        int           m_tolerance;
+        unsigned      m_num_in;
+        unsigned      m_num_out;
+        bool          m_started;
+        int           m_start_x;      // The last vertex sent
+        int           m_start_y;
+        int           m_dir_x;        // The direction of the strip
+        int           m_dir_y;
+        int64         m_dir_max;      // max(|m_dir_x|, |m_dir_y|)
+        int64         m_last_dot;     // The projection of the last one
+        bool          m_skipped;      // (m_last_x, m_last_y) is dropped
+        int           m_last_x;
+        int           m_last_y;
+        bool          m_pending;      // The command after the last one
+        int           m_pending_x;
+        int           m_pending_y;
+        unsigned      m_pending_cmd;
+    };
+
+}
+
+
+#endif
@@ -0,0 +1,374 @@
+//----------------------------------------------------------------------------
+// Anti-Grain Geometry - Version 2.1 Lite
+// Copyright (C) 2002-2003 Maxim Shemanarev (McSeem)
+//
+// Permission to copy, use, modify, sell and distribute this software
+// is granted provided this copyright notice appears in all copies.
+// This software is provided "as is" without express or implied
+// warranty, and with no claim as to its suitability for any purpose.
+//
+//----------------------------------------------------------------------------
+//
+// Vertex sources that approximate ellipses, elliptic arcs and Bezier
+// curves with line segments: ellipse, arc, curve3 and curve4. They work
+// in the subpixel coordinates of the rasterizer and can be passed to
+// rasterizer::add_path() directly.
+//
+// The number of segments is chosen from the radius or the curvature, so
+// that no segment deviates from the true curve by more than a tolerance,
+// also in subpixels. The vertices are then produced by a fixed-point
+// rotation (ellipse, arc) or forward differences (curve3, curve4), that
+// is, without any floating point or libm calls per vertex.
+//
+//----------------------------------------------------------------------------
+#ifndef AGG_CURVES_INCLUDED
+#define AGG_CURVES_INCLUDED
+
+#include "agg.h"
+
+namespace agg
+{
+
+    //------------------------------------------------------------------------
+    // The angles of the arcs are radians in 16.16 fixed point.
+    // The default tolerance is 1/8 of a pixel of the 24.8 coordinates.
+    enum
+    {
+        curve_angle_shift = 16,
+        curve_tolerance   = poly_base_size / 8
+    };
+
+    //------------------------------------------------------------------------
+    inline int curve_angle(double a)
+    {
+        return int(a * (1 << curve_angle_shift));
+    }
+
+    //------------------------------------------------------------------------
+    // Fixed-point helpers, also used by the stroker. The angles are 
+    // radians in 34.30, the sines and cosines are in 2.30.
+    //
+    // arc_steps() returns the number of chords for the angle a of a circle
+    // of radius r, so that none deviates from the arc by more than the
+    // tolerance.
+    const int64 pi_q30 = 3373259426LL;
+
+    unsigned isqrt(int64u v);
+    void     sin_cos(int64 a, int* s, int* c);
+    unsigned arc_steps(int64 a, int r, int tolerance);
+
+
+    //========================================================================
+    // Ellipse with the center (x, y) and the radii rx, ry. It starts at
+    // (x + rx, y) and goes in the direction of the increasing angle, i.e.,
+    // clockwise on the screen. With num_steps = 0 the number of vertices
+    // is calculated from the radii and the tolerance.
+    //------------------------------------------------------------------------
+    class ellipse
+    {
+    public:
+        ellipse() : m_num_steps(0), m_step(0) {}
+
+        ellipse(int x, int y, int rx, int ry,
+                unsigned num_steps = 0,
+                int tolerance = curve_tolerance)
+        {
+            init(x, y, rx, ry, num_steps, tolerance);
+        }
+
+        void init(int x, int y, int rx, int ry,
+                  unsigned num_steps = 0,
+                  int tolerance = curve_tolerance);
+
+        unsigned num_steps() const { return m_num_steps; }
+
+        //--------------------------------------------------------------------
+        void rewind(unsigned)
+        {
+            m_step = 0;
+            m_cos  = 1 << 30;
+            m_sin  = 0;
+        }
+
+        //--------------------------------------------------------------------
+        unsigned vertex(int* x, int* y)
+        {
+            if(m_step >= m_num_steps)
+            {
+                if(m_step++ == m_num_steps) return path_cmd_end_poly | path_flags_close;
+                return path_cmd_stop;
+            }
+            *x = m_x + int((int64(m_rx) * m_cos + (1 << 29)) >> 30);
+            *y = m_y + int((int64(m_ry) * m_sin + (1 << 29)) >> 30);
+
+            int c = m_cos;
+            m_cos = int((int64(c) * m_step_cos - int64(m_sin) * m_step_sin + (1 << 29)) >> 30);
+            m_sin = int((int64(m_sin) * m_step_cos + int64(c) * m_step_sin + (1 << 29)) >> 30);
+
+            return (m_step++ == 0) ? path_cmd_move_to : path_cmd_line_to;
+        }
+
+    private:
+        int      m_x;
+        int      m_y;
+        int      m_rx;
+        int      m_ry;
+        unsigned m_num_steps;
+        unsigned m_step;
+        int      m_step_cos;    // The rotation of one step, 2.30
+        int      m_step_sin;
+        int      m_cos;         // The current angle, 2.30
+        int      m_sin;
+    };
+
+
+
+    //========================================================================
+    // Elliptic arc from the angle a1 to a2, see curve_angle(). If ccw is
+    // true the angle increases from a1 to a2, otherwise it decreases.
+    // The arc is an open contour: move_to() and line_to() up to the end
+    // point, which is calculated exactly.
+    //------------------------------------------------------------------------
+    class arc
+    {
+    public:
+        arc() : m_num_steps(0), m_step(0) {}
+
+        arc(int x, int y, int rx, int ry, int a1, int a2,
+            bool ccw = true,
+            int tolerance = curve_tolerance)
+        {
+            init(x, y, rx, ry, a1, a2, ccw, tolerance);
+        }
+
+        void init(int x, int y, int rx, int ry, int a1, int a2,
+                  bool ccw = true,
+                  int tolerance = curve_tolerance);
+
+        unsigned num_steps() const { return m_num_steps; }
+
+        //--------------------------------------------------------------------
+        void rewind(unsigned)
+        {
+            m_step = 0;
+            m_cos  = m_start_cos;
+            m_sin  = m_start_sin;
+        }
+
+        //--------------------------------------------------------------------
+        unsigned vertex(int* x, int* y)
+        {
+            if(m_step > m_num_steps) return path_cmd_stop;
+            if(m_step == m_num_steps)
+            {
+                m_step++;
+                *x = m_end_x;
+                *y = m_end_y;
+                return path_cmd_line_to;
+            }
+            *x = m_x + int((int64(m_rx) * m_cos + (1 << 29)) >> 30);
+            *y = m_y + int((int64(m_ry) * m_sin + (1 << 29)) >> 30);
+
+            int c = m_cos;
+            m_cos = int((int64(c) * m_step_cos - int64(m_sin) * m_step_sin + (1 << 29)) >> 30);
+            m_sin = int((int64(m_sin) * m_step_cos + int64(c) * m_step_sin + (1 << 29)) >> 30);
+
+            return (m_step++ == 0) ? path_cmd_move_to : path_cmd_line_to;
+        }
+
+    private:
+        int      m_x;
+        int      m_y;
+        int      m_rx;
+        int      m_ry;
+        int      m_end_x;
+        int      m_end_y;
+        unsigned m_num_steps;
+        unsigned m_step;
+        int      m_step_cos;
+        int      m_step_sin;
+        int      m_start_cos;
+        int      m_start_sin;
+        int      m_cos;
+        int      m_sin;
+    };
+
+
+
+    //========================================================================
+    // Quadratic Bezier curve (x1, y1) - (x3, y3) with the control point
+    // (x2, y2). The intermediate points are calculated with forward
+    // differences in 36.28 fixed point, the end points are exact.
+    //------------------------------------------------------------------------
+    class curve3
+    {
+    public:
+        enum { max_steps = 1024 };
+
+        curve3() : m_num_steps(0), m_step(0) {}
+
+        curve3(int x1, int y1,
+               int x2, int y2,
+               int x3, int y3,
+               int tolerance = curve_tolerance)
+        {
+            init(x1, y1, x2, y2, x3, y3, tolerance);
+        }
+
+        void init(int x1, int y1,
+                  int x2, int y2,
+                  int x3, int y3,
+                  int tolerance = curve_tolerance);
+
+        unsigned num_steps() const { return m_num_steps; }
+
+        //--------------------------------------------------------------------
+        void rewind(unsigned)
+        {
+            m_step = 0;
+            m_fx   = int64(m_start_x) << 28;
+            m_fy   = int64(m_start_y) << 28;
+            m_dfx  = m_start_dfx;
+            m_dfy  = m_start_dfy;
+        }
+
+        //--------------------------------------------------------------------
+        unsigned vertex(int* x, int* y)
+        {
+            if(m_step == 0)
+            {
+                m_step++;
+                *x = m_start_x;
+                *y = m_start_y;
+                return path_cmd_move_to;
+            }
+            if(m_step > m_num_steps) return path_cmd_stop;
+            if(m_step++ == m_num_steps)
+            {
+                *x = m_end_x;
+                *y = m_end_y;
+                return path_cmd_line_to;
+            }
+            m_fx  += m_dfx;
+            m_fy  += m_dfy;
+            m_dfx += m_ddfx;
+            m_dfy += m_ddfy;
+            *x = int((m_fx + (1 << 27)) >> 28);
+            *y = int((m_fy + (1 << 27)) >> 28);
+            return path_cmd_line_to;
+        }
+
+    private:
+        int      m_start_x;
+        int      m_start_y;
+        int      m_end_x;
+        int      m_end_y;
+        unsigned m_num_steps;
+        unsigned m_step;
+        int64    m_fx;
+        int64    m_fy;
+        int64    m_dfx;
+        int64    m_dfy;
+        int64    m_ddfx;
+        int64    m_ddfy;
+        int64    m_start_dfx;
+        int64    m_start_dfy;
+    };
+
+
+
+    //========================================================================
+    // Cubic Bezier curve (x1, y1) - (x4, y4) with the control points
+    // (x2, y2) and (x3, y3). The same as curve3, but with one more
+    // difference.
+    //------------------------------------------------------------------------
+    class curve4
+    {
+    public:
+        enum { max_steps = 1024 };
+
+        curve4() : m_num_steps(0), m_step(0) {}
+
+        curve4(int x1, int y1,
+               int x2, int y2,
+               int x3, int y3,
+               int x4, int y4,
+               int tolerance = curve_tolerance)
+        {
+            init(x1, y1, x2, y2, x3, y3, x4, y4, tolerance);
+        }
+
+        void init(int x1, int y1,
+                  int x2, int y2,
+                  int x3, int y3,
+                  int x4, int y4,
+                  int tolerance = curve_tolerance);
+
+        unsigned num_steps() const { return m_num_steps; }
+
+        //--------------------------------------------------------------------
+        void rewind(unsigned)
+        {
+            m_step = 0;
+            m_fx   = int64(m_start_x) << 28;
+            m_fy   = int64(m_start_y) << 28;
+            m_dfx  = m_start_dfx;
+            m_dfy  = m_start_dfy;
+            m_ddfx = m_start_ddfx;
+            m_ddfy = m_start_ddfy;
+        }
+
+        //--------------------------------------------------------------------
+        unsigned vertex(int* x, int* y)
+        {
+            if(m_step == 0)
+            {
+                m_step++;
+                *x = m_start_x;
+                *y = m_start_y;
+                return path_cmd_move_to;
+            }
+            if(m_step > m_num_steps) return path_cmd_stop;
+            if(m_step++ == m_num_steps)
+            {
+                *x = m_end_x;
+                *y = m_end_y;
+                return path_cmd_line_to;
+            }
+            m_fx   += m_dfx;
+            m_fy   += m_dfy;
+            m_dfx  += m_ddfx;
+            m_dfy  += m_ddfy;
+            m_ddfx += m_dddfx;
+            m_ddfy += m_dddfy;
+            *x = int((m_fx + (1 << 27)) >> 28);
+            *y = int((m_fy + (1 << 27)) >> 28);
+            return path_cmd_line_to;
+        }
+
+    private:
+        int      m_start_x;
+        int      m_start_y;
+        int      m_end_x;
+        int      m_end_y;
+        unsigned m_num_steps;
+        unsigned m_step;
+        int64    m_fx;
+        int64    m_fy;
+        int64    m_dfx;
+        int64    m_dfy;
+        int64    m_ddfx;
+        int64    m_ddfy;
+        int64    m_dddfx;
+        int64    m_dddfy;
+        int64    m_start_dfx;
+        int64    m_start_dfy;
+        int64    m_start_ddfx;
+        int64    m_start_ddfy;
+    };
+
+}
+
+
+#endif
+
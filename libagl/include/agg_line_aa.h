@@ -0,0 +1,192 @@
+//----------------------------------------------------------------------------
+// Anti-Grain Geometry - Version 2.1 Lite
+// Copyright (C) 2002-2003 Maxim Shemanarev (McSeem)
+//
+// Permission to copy, use, modify, sell and distribute this software
+// is granted provided this copyright notice appears in all copies.
+// This software is provided "as is" without express or implied
+// warranty, and with no claim as to its suitability for any purpose.
+//
+//----------------------------------------------------------------------------
+//
+// Anti-Aliased thin lines drawn directly into the renderer, without the
+// outline, the cells and the sweep of the rasterizer.
+//
+//----------------------------------------------------------------------------
+#ifndef AGG_LINE_AA_INCLUDED
+#define AGG_LINE_AA_INCLUDED
+
+#include "agg.h"
+
+namespace agg
+{
+
+    //========================================================================
+    // The part of renderer_line_aa that doesn't depend on the renderer:
+    // the width, the gamma and the setup of a line.
+    //
+    // A line is stepped pixel by pixel along its major axis, like in the
+    // algorithm of Wu. In every column (or row) the line is the interval
+    // of the minor axis around its center, as long as the width times
+    // len/major, and the cover of a pixel is the part of the pixel in the
+    // interval. The ends are butt, but cut across the major axis, not
+    // across the line: the first and the last column are covered in part,
+    // so the consecutive lines of a polyline don't overlap. Otherwise the
+    // pixels are the same as of the stroked polygon within a few levels.
+    //------------------------------------------------------------------------
+    class line_aa
+    {
+    public:
+        line_aa();
+
+        // The width in subpixels, it's meant for the lines of 1...3 pixels
+        void width(int w) { m_width = w; }
+        int  width() const { return m_width; }
+
+        void gamma(double g);
+        void gamma(const int8u* g);
+
+    protected:
+        // One line, in 16.16 pixels along the minor axis
+        struct segment
+        {
+            bool     vertical;   // The major axis is Y
+            int      first;      // The first and the last pixel
+            int      last;       // along the major axis, inclusive
+            int      center;     // The center in the first pixel
+            int      step;       // Per pixel
+            int      half;       // The half of the width
+            unsigned cover1;     // The part of the first and the last
+            unsigned cover2;     // pixel inside the line, 0...256
+        };
+
+        // Returns false if nothing of the line is in [0...w) x [0...h)
+        bool setup(segment& s, int x1, int y1, int x2, int y2,
+                   int w, int h) const;
+
+    protected:
+        int   m_width;
+        int8u m_gamma[256];
+    };
+
+
+
+    //========================================================================
+    // Draws the lines with a Renderer that has blend_pixel() and rbuf(),
+    // like renderer<Span>. All the coordinates are in subpixels:
+    //
+    //     agg::renderer_line_aa<agg::renderer<agg::span_rgb101010> > lines(ren);
+    //     lines.width(agg::poly_coord(1.5));
+    //     lines.line(x1, y1, x2, y2, agg::rgba8(0, 255, 0));
+    //
+    // move_to()/line_to() and add_path() draw polylines with the color of
+    // color(); the contours are not closed, path_cmd_end_poly with
+    // path_flags_close closes them.
+    //------------------------------------------------------------------------
+    template<class Renderer> class renderer_line_aa : public line_aa
+    {
+    public:
+        renderer_line_aa(Renderer& r) :
+            m_ren(&r), m_color(0, 0, 0),
+            m_start_x(0), m_start_y(0), m_cur_x(0), m_cur_y(0)
+        {
+        }
+
+        void attach(Renderer& r) { m_ren = &r; }
+
+        void color(const rgba8& c) { m_color = c; }
+        const rgba8& color() const { return m_color; }
+
+        //--------------------------------------------------------------------
+        void line(int x1, int y1, int x2, int y2, const rgba8& c)
+        {
+            segment s;
+            if(!setup(s, x1, y1, x2, y2,
+                      int(m_ren->rbuf().width()),
+                      int(m_ren->rbuf().height())))
+            {
+                return;
+            }
+
+            int center = s.center;
+            int m;
+            for(m = s.first; m <= s.last; m++, center += s.step)
+            {
+                unsigned f = 256;
+                if(m == s.first) f = s.cover1;
+                if(m == s.last)  f = (f * s.cover2) >> 8;
+
+                int top = center - s.half;
+                int bot = center + s.half;
+                int j   = top >> 16;
+                int je  = (bot - 1) >> 16;
+                for(; j <= je; j++)
+                {
+                    int t = j << 16;
+                    int b = t + 65536;
+                    if(t < top) t = top;
+                    if(b > bot) b = bot;
+                    unsigned cover = (unsigned(b - t) * f) >> 16;
+                    if(cover > 255) cover = 255;
+                    cover = m_gamma[cover];
+                    if(cover)
+                    {
+                        if(s.vertical) m_ren->blend_pixel(j, m, cover, c);
+                        else           m_ren->blend_pixel(m, j, cover, c);
+                    }
+                }
+            }
+        }
+
+        //--------------------------------------------------------------------
+        void move_to(int x, int y)
+        {
+            m_start_x = m_cur_x = x;
+            m_start_y = m_cur_y = y;
+        }
+
+        void line_to(int x, int y)
+        {
+            line(m_cur_x, m_cur_y, x, y, m_color);
+            m_cur_x = x;
+            m_cur_y = y;
+        }
+
+        void close_polygon() { line_to(m_start_x, m_start_y); }
+
+        //--------------------------------------------------------------------
+        template<class VertexSource> void add_path(VertexSource& vs,
+                                                   unsigned path_id = 0)
+        {
+            int x;
+            int y;
+            unsigned cmd;
+            vs.rewind(path_id);
+            while((cmd = vs.vertex(&x, &y)) != path_cmd_stop)
+            {
+                if(cmd == path_cmd_move_to) move_to(x, y);
+                else
+                if(cmd == path_cmd_line_to) line_to(x, y);
+                else
+                if((cmd & path_cmd_mask) == path_cmd_end_poly &&
+                   (cmd & path_flags_close))
+                {
+                    close_polygon();
+                }
+            }
+        }
+
+    private:
+        Renderer* m_ren;
+        rgba8     m_color;
+        int       m_start_x;
+        int       m_start_y;
+        int       m_cur_x;
+        int       m_cur_y;
+    };
+
+}
+
+
+#endif
+
@@ -0,0 +1,206 @@
+//----------------------------------------------------------------------------
+// Anti-Grain Geometry - Version 2.1 Lite
+// Copyright (C) 2002-2003 Maxim Shemanarev (McSeem)
+//
+// Permission to copy, use, modify, sell and distribute this software
+// is granted provided this copyright notice appears in all copies.
+// This software is provided "as is" without express or implied
+// warranty, and with no claim as to its suitability for any purpose.
+//
+//----------------------------------------------------------------------------
+//
+// Multi-threaded rendering for host builds (see Makefile.host). It needs
+// POSIX threads and is not part of the embedded library.
+//
+//----------------------------------------------------------------------------
+#ifndef AGG_MT_INCLUDED
+#define AGG_MT_INCLUDED
+
+#include <pthread.h>
+#include "agg.h"
+
+namespace agg
+{
+
+    //========================================================================
+    // A small work-stealing thread pool. run() splits the jobs 0...num_jobs-1
+    // into contiguous ranges, one per thread. Every thread takes the jobs
+    // from the front of its own range and, when it's exhausted, steals them
+    // from the back of the other ranges. The calling thread works as
+    // thread 0, so a pool of one thread runs everything in the caller.
+    //------------------------------------------------------------------------
+    class thread_pool
+    {
+    public:
+        typedef void (*job_func)(void* arg, unsigned job, unsigned thread);
+
+        ~thread_pool();
+
+        // 0 means the number of online CPUs
+        thread_pool(unsigned num_threads = 0);
+
+        unsigned num_threads() const { return m_num_threads; }
+
+        // Returns when all the jobs are done
+        void run(job_func func, void* arg, unsigned num_jobs);
+
+    private:
+        thread_pool(const thread_pool&);
+        const thread_pool& operator = (const thread_pool&);
+
+        struct worker
+        {
+            thread_pool* pool;
+            unsigned     index;
+            pthread_t    thread;
+        };
+
+        static void* thread_entry(void* arg);
+        void work(unsigned thread);
+        bool take(unsigned thread, unsigned* job);
+        bool steal(unsigned thread, unsigned* job);
+
+    private:
+        unsigned                  m_num_threads;
+        worker*                   m_workers;
+        volatile unsigned long long* m_ranges;
+        pthread_mutex_t           m_mutex;
+        pthread_cond_t            m_start;
+        pthread_cond_t            m_done;
+        unsigned                  m_generation;
+        unsigned                  m_busy;
+        bool                      m_quit;
+        job_func                  m_func;
+        void*                     m_arg;
+    };
+
+
+
+    //========================================================================
+    // Renders the shapes of a rasterizer in horizontal bands of band_height
+    // scanlines, in parallel. The sorted cells are split at the scanline
+    // boundaries and every band is swept by rasterizer::render_scanlines()
+    // with the scanline object of the thread that runs it. The bands don't
+    // share any pixels, so the result doesn't depend on the scheduling and
+    // it's exactly the same as of rasterizer::render().
+    //
+    // Shapes lower than two bands are rendered in the calling thread.
+    //
+    // With AGG_STATS every band is counted in the thread-local counters of
+    // the thread that renders it, then the counts of all the threads are
+    // added to the ones of the calling thread, see agg_stats.h.
+    //------------------------------------------------------------------------
+    class band_renderer
+    {
+    public:
+        enum
+        {
+            band_height = 32
+        };
+
+        ~band_renderer() 
+        { 
+            delete [] m_stats;
+            delete [] m_scanlines; 
+        }
+
+        band_renderer(thread_pool& pool) :
+            m_pool(&pool),
+            m_scanlines(new scanline [pool.num_threads()]),
+            m_stats(new agg_stats [pool.num_threads()])
+        {
+        }
+
+        //--------------------------------------------------------------------
+        template<class Rasterizer, class Renderer>
+        void render(Rasterizer& ras,
+                    Renderer& r,
+                    const rgba8& c,
+                    int dx=0,
+                    int dy=0)
+        {
+            if(ras.max_y() - ras.min_y() < band_height * 2 ||
+               m_pool->num_threads() == 1)
+            {
+                ras.render(r, c, dx, dy);
+                return;
+            }
+
+            if(!ras.sort()) return;
+
+            band_job<Rasterizer, Renderer> job;
+            job.ras       = &ras;
+            job.ren       = &r;
+            job.color     = c;
+            job.min_y     = ras.min_y();
+            job.dx        = dx;
+            job.dy        = dy;
+            job.scanlines = m_scanlines;
+            job.stats     = m_stats;
+#ifdef AGG_STATS
+            memset(m_stats, 0, sizeof(agg_stats) * m_pool->num_threads());
+#endif
+
+            unsigned num_bands = unsigned(ras.max_y() - ras.min_y()) /
+                                 band_height + 1;
+            m_pool->run(band_job<Rasterizer, Renderer>::run, &job, num_bands);
+
+#ifdef AGG_STATS
+            unsigned i;
+            for(i = 0; i < m_pool->num_threads(); i++)
+            {
+                agg_stats_add(&agg_stats_counters, m_stats + i);
+            }
+#endif
+        }
+
+    private:
+        band_renderer(const band_renderer&);
+        const band_renderer& operator = (const band_renderer&);
+
+        template<class Rasterizer, class Renderer> struct band_job
+        {
+            const Rasterizer* ras;
+            Renderer*         ren;
+            rgba8             color;
+            int               min_y;
+            int               dx;
+            int               dy;
+            scanline*         scanlines;
+            agg_stats*        stats;
+
+            // The counters of the thread are set aside for the band, so
+            // that the caller's ones are not added twice by thread 0
+            static void run(void* arg, unsigned band, unsigned thread)
+            {
+                const band_job* job = (const band_job*)arg;
+#ifdef AGG_STATS
+                agg_stats saved = agg_stats_counters;
+                memset(&agg_stats_counters, 0, sizeof(agg_stats_counters));
+#endif
+                int y1 = job->min_y + int(band) * band_height;
+                job->ras->render_scanlines(*job->ren,
+                                           job->scanlines[thread],
+                                           job->color,
+                                           y1,
+                                           y1 + band_height - 1,
+                                           job->dx,
+                                           job->dy);
+#ifdef AGG_STATS
+                agg_stats_add(job->stats + thread, &agg_stats_counters);
+                agg_stats_counters = saved;
+#endif
+            }
+        };
+
+    private:
+        thread_pool* m_pool;
+        scanline*    m_scanlines;
+        agg_stats*   m_stats;
+    };
+
+}
+
+
+#endif
+
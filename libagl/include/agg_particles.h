@@ -0,0 +1,190 @@
+//----------------------------------------------------------------------------
+// Anti-Grain Geometry - Version 2.1 Lite
+// Copyright (C) 2002-2003 Maxim Shemanarev (McSeem)
+//
+// Permission to copy, use, modify, sell and distribute this software
+// is granted provided this copyright notice appears in all copies.
+// This software is provided "as is" without express or implied
+// warranty, and with no claim as to its suitability for any purpose.
+//
+//----------------------------------------------------------------------------
+//
+// Particles: small Anti-Aliased discs stamped into the renderer from
+// precomputed coverage masks, without the rasterizer.
+//
+//----------------------------------------------------------------------------
+#ifndef AGG_PARTICLES_INCLUDED
+#define AGG_PARTICLES_INCLUDED
+
+#include "agg.h"
+
+namespace agg
+{
+
+    //========================================================================
+    // One particle, the center and the radius are in subpixels
+    //------------------------------------------------------------------------
+    struct particle
+    {
+        int   x;
+        int   y;
+        int   r;
+        rgba8 c;
+    };
+
+
+    //========================================================================
+    // The coverage masks of the discs, rendered once with the rasterizer
+    // for the radii of 1...max_radius/radius_step steps and for every
+    // 1/2^offset_shift of a pixel of the position of the center in X and
+    // Y. A particle is stamped with the mask of the nearest radius and
+    // offset, so it differs from the disc drawn by the rasterizer by at
+    // most half a step of the radius and 1/2^(offset_shift+1) of a pixel
+    // of the position. There's no outline, no sorting and no sweep, the
+    // rows of the mask go directly to the renderer, which clips them to
+    // the buffer:
+    //
+    //     agg::particle_masks masks;
+    //     masks.init(agg::poly_coord(8.0));
+    //     masks.render(ren, particles, num_particles);
+    //
+    // A row of a mask is the covers of the left edge, the run of the full
+    // cover, drawn with blend_hline(), and the covers of the right edge.
+    // With the defaults (1/4 of a pixel for the radius and the position)
+    // the masks up to 8 pixels take about 80 KB.
+    //------------------------------------------------------------------------
+    class particle_masks
+    {
+    public:
+        enum
+        {
+            max_offset_shift = 4,
+            max_radius_limit = 32 * poly_base_size
+        };
+
+        particle_masks();
+
+        // The radius step is 1 << radius_shift subpixels, max_radius is
+        // limited to max_radius_limit and offset_shift to max_offset_shift.
+        void init(int max_radius,
+                  unsigned radius_shift = poly_base_shift - 2,
+                  unsigned offset_shift = 2);
+
+        int max_radius() const { return int(m_num_radii << m_radius_shift); }
+
+        // The number of the bytes of the masks
+        unsigned byte_size() const;
+
+        //--------------------------------------------------------------------
+        // Returns the number of the drawn particles, the ones bigger than
+        // max_radius() are skipped and must be drawn with agg::ellipse.
+        template<class Renderer>
+        unsigned render(Renderer& ren, const particle* p, unsigned num) const
+        {
+            int w = int(ren.rbuf().width());
+            int h = int(ren.rbuf().height());
+            unsigned drawn = 0;
+            for(; num; --num, ++p)
+            {
+                int px;
+                int py;
+                const mask* m = find(p->x, p->y, p->r, &px, &py);
+                if(m == 0) continue;
+                ++drawn;
+
+                int y = py + m->y;
+                if(y >= h || y + int(m->num_rows) <= 0 ||
+                   px + m->x1 >= w || px + m->x2 <= 0)
+                {
+                    continue;
+                }
+
+                const row* r = &m_rows[m->rows];
+                unsigned i;
+                for(i = m->num_rows; i; --i, ++r, ++y)
+                {
+                    const int8u* covers = &m_covers[r->covers];
+                    int x = px + r->x;
+                    if(r->num_left)
+                    {
+                        ren.blend_span(x, y, r->num_left, covers, p->c);
+                        x += r->num_left;
+                    }
+                    if(r->num_solid)
+                    {
+                        ren.blend_hline(x, y, r->num_solid, 255, p->c);
+                        x += r->num_solid;
+                    }
+                    if(r->num_right)
+                    {
+                        ren.blend_span(x, y, r->num_right,
+                                       covers + r->num_left, p->c);
+                    }
+                }
+            }
+            return drawn;
+        }
+
+    private:
+        // One row, x is relative to the pixel of the center. The covers of
+        // the left edge are followed by the ones of the right edge.
+        struct row
+        {
+            int16    x;
+            int16    num_left;
+            int16    num_solid;
+            int16    num_right;
+            unsigned covers;
+        };
+
+        // The rows [rows...rows+num_rows) start at y and are within
+        // [x1...x2), relative to the pixel of the center
+        struct mask
+        {
+            int      y;
+            int      x1;
+            int      x2;
+            unsigned num_rows;
+            unsigned rows;
+        };
+
+        //--------------------------------------------------------------------
+        const mask* find(int x, int y, int r, int* px, int* py) const
+        {
+            if(m_num_radii == 0) return 0;
+            unsigned ri = unsigned(r + (1 << m_radius_shift >> 1)) >> m_radius_shift;
+            if(ri > m_num_radii) return 0;
+            if(ri == 0) ri = 1;
+
+            int shift = poly_base_shift - m_offset_shift;
+            int half  = (1 << shift) >> 1;
+            int tx = (x + half) >> shift;
+            int ty = (y + half) >> shift;
+            *px = tx >> m_offset_shift;
+            *py = ty >> m_offset_shift;
+            unsigned mask_o = (1 << m_offset_shift) - 1;
+            return &m_masks[((((ri - 1) << m_offset_shift) +
+                              (ty & mask_o)) << m_offset_shift) +
+                             (tx & mask_o)];
+        }
+
+        void add_mask(int r, int cx, int cy);
+
+    private:
+        particle_masks(const particle_masks&);
+        const particle_masks& operator = (const particle_masks&);
+
+    private:
+        unsigned          m_num_radii;
+        unsigned          m_radius_shift;
+        unsigned          m_offset_shift;
+        pod_vector<mask>  m_masks;
+        pod_vector<row>   m_rows;
+        pod_vector<int8u> m_covers;
+    };
+
+}
+
+
+#endif
+
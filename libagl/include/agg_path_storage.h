@@ -0,0 +1,143 @@
+//----------------------------------------------------------------------------
+// Anti-Grain Geometry - Version 2.1 Lite
+// Copyright (C) 2002-2003 Maxim Shemanarev (McSeem)
+//
+// Permission to copy, use, modify, sell and distribute this software
+// is granted provided this copyright notice appears in all copies.
+// This software is provided "as is" without express or implied
+// warranty, and with no claim as to its suitability for any purpose.
+//
+//----------------------------------------------------------------------------
+//
+// Container of paths: the vertices and their commands, kept in blocks.
+//
+//----------------------------------------------------------------------------
+#ifndef AGG_PATH_STORAGE_INCLUDED
+#define AGG_PATH_STORAGE_INCLUDED
+
+#include "agg.h"
+
+namespace agg
+{
+
+    //========================================================================
+    // Keeps any number of paths made with move_to()/line_to(). The
+    // vertices are stored in blocks of block_size, the coordinates and
+    // the commands separately, so adding a vertex never moves the ones
+    // already stored, and remove_all() keeps the blocks for the next
+    // frame. The paths are separated by path_cmd_stop, start_new_path()
+    // returns the path_id of the new one.
+    //
+    // It's a vertex source (see path_commands_e), but the rasterizers
+    // have an overload of add_path() for it that reads the blocks
+    // directly, see outline_aa::add_path(). The paths with curves must go
+    // through agg::conv_curve instead, the rasterizers ignore them.
+    //------------------------------------------------------------------------
+    class path_storage
+    {
+    public:
+        enum
+        {
+            block_shift = 8,
+            block_size  = 1 << block_shift,
+            block_mask  = block_size - 1,
+            block_pool  = 256
+        };
+
+        ~path_storage();
+        path_storage();
+
+        // Removes the vertices, but keeps the memory
+        void remove_all() { m_total_vertices = 0; m_iterator = 0; }
+
+        // Frees the memory too
+        void free_all();
+
+        //--------------------------------------------------------------------
+        unsigned start_new_path();
+
+        void move_to(int x, int y) { add_vertex(x, y, path_cmd_move_to); }
+        void line_to(int x, int y) { add_vertex(x, y, path_cmd_line_to); }
+
+        // The curves start at the last vertex, see path_cmd_curve3
+        void curve3(int x_ctrl, int y_ctrl, int x_to, int y_to)
+        {
+            add_vertex(x_ctrl, y_ctrl, path_cmd_curve3);
+            add_vertex(x_to,   y_to,   path_cmd_curve3);
+        }
+        void curve4(int x_ctrl1, int y_ctrl1,
+                    int x_ctrl2, int y_ctrl2,
+                    int x_to,    int y_to)
+        {
+            add_vertex(x_ctrl1, y_ctrl1, path_cmd_curve4);
+            add_vertex(x_ctrl2, y_ctrl2, path_cmd_curve4);
+            add_vertex(x_to,    y_to,    path_cmd_curve4);
+        }
+        void close_polygon()
+        {
+            add_vertex(0, 0, path_cmd_end_poly | path_flags_close);
+        }
+
+        void add_vertex(int x, int y, unsigned cmd)
+        {
+            unsigned nb = m_total_vertices >> block_shift;
+            if(nb >= m_total_blocks) allocate_block(nb);
+            unsigned i = m_total_vertices & block_mask;
+            int* xy = m_coord_blocks[nb] + (i << 1);
+            xy[0] = x;
+            xy[1] = y;
+            m_cmd_blocks[nb][i] = int8u(cmd);
+            ++m_total_vertices;
+        }
+
+        //--------------------------------------------------------------------
+        unsigned total_vertices() const { return m_total_vertices; }
+
+        unsigned command(unsigned idx) const
+        {
+            return m_cmd_blocks[idx >> block_shift][idx & block_mask];
+        }
+
+        unsigned vertex(unsigned idx, int* x, int* y) const
+        {
+            unsigned nb = idx >> block_shift;
+            const int* xy = m_coord_blocks[nb] + ((idx & block_mask) << 1);
+            *x = xy[0];
+            *y = xy[1];
+            return m_cmd_blocks[nb][idx & block_mask];
+        }
+
+        //--------------------------------------------------------------------
+        // The vertices of block nb, 2 coordinates and a command per vertex
+        const int*   block_coords(unsigned nb) const { return m_coord_blocks[nb]; }
+        const int8u* block_cmds(unsigned nb)   const { return m_cmd_blocks[nb]; }
+
+        //--------------------------------------------------------------------
+        void rewind(unsigned path_id) { m_iterator = path_id; }
+
+        unsigned vertex(int* x, int* y)
+        {
+            if(m_iterator >= m_total_vertices) return path_cmd_stop;
+            return vertex(m_iterator++, x, y);
+        }
+
+    private:
+        path_storage(const path_storage&);
+        const path_storage& operator = (const path_storage&);
+
+        void allocate_block(unsigned nb);
+
+    private:
+        unsigned m_total_vertices;
+        unsigned m_total_blocks;
+        unsigned m_max_blocks;
+        int**    m_coord_blocks;
+        int8u**  m_cmd_blocks;
+        unsigned m_iterator;
+    };
+
+}
+
+
+#endif
+
@@ -0,0 +1,131 @@
+//----------------------------------------------------------------------------
+// Anti-Grain Geometry - Version 2.1 Lite
+// Copyright (C) 2002-2003 Maxim Shemanarev (McSeem)
+//
+// Permission to copy, use, modify, sell and distribute this software
+// is granted provided this copyright notice appears in all copies.
+// This software is provided "as is" without express or implied
+// warranty, and with no claim as to its suitability for any purpose.
+//
+//----------------------------------------------------------------------------
+//
+// Storage of rasterized shapes. The scanlines of a sweep are kept in a 
+// compact form and replayed any number of times, at any integer offset
+// and in any color, without the cells, the sort and the sweep.
+//
+//----------------------------------------------------------------------------
+#ifndef AGG_SCANLINE_STORAGE_INCLUDED
+#define AGG_SCANLINE_STORAGE_INCLUDED
+
+#include "agg.h"
+
+namespace agg
+{
+
+    //========================================================================
+    // Stores the scanlines of the shapes rendered into it. It works as a
+    // Renderer for the rasterizer, the color is ignored:
+    //
+    //     agg::scanline_storage logo;
+    //     ras.render(logo, agg::rgba8(0,0,0));
+    //     . . .
+    //     logo.replay(ren, agg::rgba8(255,0,0), x, y);   // every frame
+    //
+    // The spans are kept as they come from the scanline: the ones of cells
+    // with all their covers, the solid ones with one cover, so the replay
+    // blends exactly the same pixels as rendering the shape at (x, y) 
+    // would. Several shapes can be stored one after another, they're 
+    // replayed in the same order and in the same color. The renderer is 
+    // anything with blend_span() and blend_hline(), like renderer<Span>, 
+    // which clips them to the buffer.
+    //------------------------------------------------------------------------
+    class scanline_storage
+    {
+    public:
+        scanline_storage();
+
+        // Removes the scanlines, but keeps the memory
+        void reset();
+
+        //--------------------------------------------------------------------
+        // The Renderer interface, see rasterizer::render()
+        void render(const scanline& sl, const rgba8&);
+
+        //--------------------------------------------------------------------
+        template<class Renderer> void replay(Renderer& r, 
+                                             const rgba8& c, 
+                                             int dx = 0, 
+                                             int dy = 0) const
+        {
+            unsigned i;
+            for(i = 0; i < m_rows.size(); i++)
+            {
+                const row_info& row = m_rows[i];
+                const span_info* span = &m_spans[row.start];
+                int y = row.y + dy;
+                unsigned num_spans = row.num_spans;
+                do
+                {
+                    if(span->len < 0)
+                    {
+                        r.blend_hline(span->x + dx, y, unsigned(-span->len), 
+                                      m_covers[span->covers], c);
+                    }
+                    else
+                    {
+                        r.blend_span(span->x + dx, y, unsigned(span->len), 
+                                     &m_covers[span->covers], c);
+                    }
+                    ++span;
+                }
+                while(--num_spans);
+            }
+        }
+
+        //--------------------------------------------------------------------
+        // The bounding box of the stored pixels, without the offset
+        int min_x() const { return m_min_x; }
+        int min_y() const { return m_min_y; }
+        int max_x() const { return m_max_x; }
+        int max_y() const { return m_max_y; }
+
+        unsigned num_scanlines() const { return m_rows.size(); }
+        unsigned num_spans()     const { return m_spans.size(); }
+
+        // The memory in bytes: taken by the stored data and allocated
+        unsigned byte_size() const;
+        unsigned allocated_size() const;
+
+    private:
+        scanline_storage(const scanline_storage&);
+        const scanline_storage& operator = (const scanline_storage&);
+
+        struct row_info
+        {
+            int      y;
+            unsigned start;
+            unsigned num_spans;
+        };
+
+        // len < 0 is a solid span with one cover
+        struct span_info
+        {
+            int      x;
+            int      len;
+            unsigned covers;
+        };
+
+        pod_vector<row_info>  m_rows;
+        pod_vector<span_info> m_spans;
+        pod_vector<int8u>     m_covers;
+        int                   m_min_x;
+        int                   m_min_y;
+        int                   m_max_x;
+        int                   m_max_y;
+    };
+
+}
+
+
+#endif
+
@@ -0,0 +1,72 @@
+//----------------------------------------------------------------------------
+// Anti-Grain Geometry - Version 2.1 Lite
+// Copyright (C) 2002-2003 Maxim Shemanarev (McSeem)
+//
+// Permission to copy, use, modify, sell and distribute this software
+// is granted provided this copyright notice appears in all copies.
+// This software is provided "as is" without express or implied
+// warranty, and with no claim as to its suitability for any purpose.
+//
+//----------------------------------------------------------------------------
+//
+// SSE2 and AVX2 loops of the 32-bit spans for host builds (see
+// Makefile.host). agg.h uses them with AGG_SPAN_SIMD defined, it's not
+// part of the embedded library.
+//
+//----------------------------------------------------------------------------
+#ifndef AGG_SPAN_SIMD_INCLUDED
+#define AGG_SPAN_SIMD_INCLUDED
+
+namespace agg
+{
+
+    //------------------------------------------------------------------------
+    enum span_simd_e
+    {
+        span_simd_scalar,
+        span_simd_sse2,
+        span_simd_avx2
+    };
+
+    //========================================================================
+    // The loops of the spans of 4 bytes per pixel, chosen at the start-up
+    // by the features of the CPU. The pixels are the same as of the
+    // scalar loops of agg.h, bit by bit, so the code compiled without
+    // AGG_SPAN_SIMD can draw into the same buffers. A pointer is 0 if
+    // there's nothing better than the scalar loop, the spans shorter than
+    // span_simd_min_count are always drawn by the scalar one.
+    //
+    // blend32() blends count pixels of 4 channels with color, the 4 bytes
+    // in the order of the pixel. The alpha of a pixel is covers[i] * alpha,
+    // or alpha itself if covers is 0. blend101010() is the same for
+    // span_rgb101010 with the 10-bit color r, g, b. fill32() fills count
+    // pixels with v.
+    //------------------------------------------------------------------------
+    struct span_simd_funcs
+    {
+        void (*blend32)(unsigned char* p, unsigned count,
+                        const unsigned char* covers,
+                        const unsigned char* color, unsigned alpha);
+
+        void (*blend101010)(unsigned* p, unsigned count,
+                            const unsigned char* covers,
+                            unsigned r, unsigned g, unsigned b,
+                            unsigned alpha);
+
+        void (*fill32)(unsigned* p, unsigned count, unsigned v);
+    };
+
+    enum { span_simd_min_count = 8 };
+
+    extern span_simd_funcs span_simd;
+
+    // The level in use. span_simd_select() sets the best one up to level
+    // that the CPU has, for the tests and the benchmarks. It must not be
+    // called while something is being drawn.
+    span_simd_e span_simd_level();
+    span_simd_e span_simd_select(span_simd_e level);
+
+}
+
+
+#endif
@@ -0,0 +1,111 @@
+/*----------------------------------------------------------------------------
+ * Anti-Grain Geometry - Version 2.1 Lite
+ * Copyright (C) 2002-2003 Maxim Shemanarev (McSeem)
+ *
+ * Permission to copy, use, modify, sell and distribute this software
+ * is granted provided this copyright notice appears in all copies.
+ * This software is provided "as is" without express or implied
+ * warranty, and with no claim as to its suitability for any purpose.
+ *
+ *----------------------------------------------------------------------------
+ *
+ * The counters of the work of the rasterizers and the renderer, for the
+ * frame profilers. It's a C header, the counters are read from C too.
+ *
+ * They're compiled in only with AGG_STATS defined, both for the library
+ * and for the code that includes agg.h, because renderer<Span> and the
+ * render() of the rasterizers are templates. Without it the macros are
+ * empty and agg_stats_read() returns zeros:
+ *
+ *     agg_stats_reset();
+ *     ... draw ...
+ *     struct agg_stats s;
+ *     agg_stats_read(&s);
+ *
+ * The counters aren't atomic. On the host they are per thread, so
+ * agg_stats_reset() and agg_stats_read() see the ones of the calling
+ * thread. band_renderer of agg_mt.h counts every band in the thread that
+ * renders it, and adds the counts to the calling thread's at the end of
+ * render(). The board has no threads and the counters are global.
+ *
+ *----------------------------------------------------------------------------*/
+#ifndef AGG_STATS_INCLUDED
+#define AGG_STATS_INCLUDED
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct agg_stats
+{
+    unsigned edges;             /* Lines given to the cells, after clipping */
+    unsigned cells;             /* Cells added to the outlines */
+    unsigned dropped_cells;     /* Cells lost, the cell arena was exhausted */
+    unsigned sorted_cells;      /* Cells sorted by outline_aa */
+    unsigned sort_compares;     /* Comparisons of the insertion sort */
+    unsigned radix_passes;      /* Passes of the radix sort, per scanline */
+    unsigned scanlines;         /* Scanlines given to renderer<Span> */
+    unsigned spans;             /* Spans drawn by renderer<Span> */
+    unsigned solid_pixels;      /* Pixels of the solid spans, clipped */
+    unsigned partial_pixels;    /* Pixels of the spans of covers, clipped */
+    unsigned long long sort_cycles;   /* Sorting of the cells */
+    unsigned long long sweep_cycles;  /* Sweeps, with the blending */
+};
+
+/* Zeroes the counters, usually once per frame or per draw call */
+void agg_stats_reset(void);
+
+/* Copies the counters */
+void agg_stats_read(struct agg_stats* s);
+
+/* Adds the counters of a to the ones of s */
+void agg_stats_add(struct agg_stats* s, const struct agg_stats* a);
+
+/* Returns 1 if the library counts, i.e., it's built with AGG_STATS */
+int agg_stats_enabled(void);
+
+/* The cycle counter: CC on LM32, the TSC on x86, 0 elsewhere */
+static inline unsigned agg_stats_cycles(void)
+{
+#if defined(__lm32__)
+    unsigned cc;
+    __asm__ __volatile__("rcsr %0, CC" : "=r"(cc));
+    return cc;
+#elif defined(__i386__) || defined(__x86_64__)
+    unsigned lo, hi;
+    __asm__ __volatile__("rdtsc" : "=a"(lo), "=d"(hi));
+    (void)hi;
+    return lo;
+#else
+    return 0;
+#endif
+}
+
+#if defined(__lm32__)
+#define AGG_STATS_THREAD
+#else
+#define AGG_STATS_THREAD __thread
+#endif
+
+extern AGG_STATS_THREAD struct agg_stats agg_stats_counters;
+
+#ifdef __cplusplus
+}
+#endif
+
+
+/* The instrumentation of the library, empty without AGG_STATS. The cycle
+ * counter is 32-bit, each timed interval must be shorter than its wrap. */
+#ifdef AGG_STATS
+#define AGG_STATS_ADD(counter, n) (agg_stats_counters.counter += (n))
+#define AGG_STATS_TIMER_START(t)  unsigned t = agg_stats_cycles()
+#define AGG_STATS_TIMER_STOP(t, counter) \
+    (agg_stats_counters.counter += (unsigned)(agg_stats_cycles() - (t)))
+#else
+#define AGG_STATS_ADD(counter, n) ((void)0)
+#define AGG_STATS_TIMER_START(t)
+#define AGG_STATS_TIMER_STOP(t, counter) ((void)0)
+#endif
+
+
+#endif
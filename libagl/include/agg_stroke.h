@@ -0,0 +1,159 @@
+//----------------------------------------------------------------------------
+// Anti-Grain Geometry - Version 2.1 Lite
+// Copyright (C) 2002-2003 Maxim Shemanarev (McSeem)
+//
+// Permission to copy, use, modify, sell and distribute this software
+// is granted provided this copyright notice appears in all copies.
+// This software is provided "as is" without express or implied
+// warranty, and with no claim as to its suitability for any purpose.
+//
+//----------------------------------------------------------------------------
+//
+// Stroke generator: turns polylines into the outlines of lines of a given
+// width, with joins and caps.
+//
+//----------------------------------------------------------------------------
+#ifndef AGG_STROKE_INCLUDED
+#define AGG_STROKE_INCLUDED
+
+#include "agg_curves.h"
+
+namespace agg
+{
+
+    //------------------------------------------------------------------------
+    enum line_join_e
+    {
+        miter_join,
+        round_join,
+        bevel_join
+    };
+
+    //------------------------------------------------------------------------
+    enum line_cap_e
+    {
+        butt_cap,
+        square_cap,
+        round_cap
+    };
+
+
+    //========================================================================
+    // Stroke generator. The polylines are made with move_to()/line_to(),
+    // close_polygon() makes the current one closed. Then the stroker works
+    // as a vertex source (see path_commands_e) that can be passed to
+    // rasterizer::add_path().
+    //
+    // An open polyline becomes one contour: along one side, around the end
+    // cap, back along the other side and around the start cap. A closed
+    // one becomes two contours of the opposite directions. The contours
+    // overlap themselves at the joints, but with the same direction, so,
+    // being rendered with fill_non_zero, every pixel is blended once and
+    // the whole line strip needs only one sweep.
+    //
+    // All the values are in the subpixel coordinates, like the vertices.
+    // The miter joins that are longer than miter_limit() times the half
+    // of the width are beveled. The round joins and caps are approximated
+    // with the given tolerance, like agg::arc. The outline is calculated
+    // in integers, by rewind().
+    //------------------------------------------------------------------------
+    class stroker
+    {
+    public:
+        stroker();
+
+        //--------------------------------------------------------------------
+        void width(int w);
+        void line_join(line_join_e lj) { m_line_join = lj; m_ready = false; }
+        void line_cap(line_cap_e lc)   { m_line_cap  = lc; m_ready = false; }
+        void miter_limit(double ml);
+        void tolerance(int t);
+
+        int         width()     const { return m_width; }
+        line_join_e line_join() const { return m_line_join; }
+        line_cap_e  line_cap()  const { return m_line_cap; }
+
+        //--------------------------------------------------------------------
+        void remove_all();
+        void move_to(int x, int y);
+        void line_to(int x, int y);
+        void close_polygon();
+
+        //--------------------------------------------------------------------
+        void rewind(unsigned path_id);
+
+        unsigned vertex(int* x, int* y)
+        {
+            if(m_out_vertex >= m_out.size()) return path_cmd_stop;
+            const out_vertex& v = m_out[m_out_vertex++];
+            *x = v.x;
+            *y = v.y;
+            return v.cmd;
+        }
+
+    private:
+        struct src_vertex
+        {
+            int x;
+            int y;
+        };
+
+        struct polyline
+        {
+            unsigned start;
+            unsigned num_vertices;
+            bool     closed;
+        };
+
+        struct segment
+        {
+            int      nx;     // The unit normal, 2.30
+            int      ny;
+            unsigned len;
+        };
+
+        struct out_vertex
+        {
+            int      x;
+            int      y;
+            unsigned cmd;
+        };
+
+        void calc_steps();
+        void stroke(const polyline& pl);
+        void add_point(int x, int y);
+        void add_offset(int x, int y, int nx, int ny);
+        void end_contour();
+        void calc_cap(const src_vertex& v, int nx, int ny);
+        void calc_join(const src_vertex& v,
+                       int nx1, int ny1,
+                       int nx2, int ny2,
+                       unsigned min_len);
+        void calc_arc(const src_vertex& v,
+                      int nx1, int ny1,
+                      int nx2, int ny2);
+
+    private:
+        int                    m_width;
+        int                    m_half_width;
+        line_join_e            m_line_join;
+        line_cap_e             m_line_cap;
+        int64                  m_miter_den;
+        int                    m_tolerance;
+        unsigned               m_arc_steps;     // Per half a turn
+        int                    m_arc_cos;
+        int                    m_arc_sin;
+        bool                   m_ready;
+        pod_vector<src_vertex> m_src;
+        pod_vector<polyline>   m_polylines;
+        pod_vector<segment>    m_segments;
+        pod_vector<out_vertex> m_out;
+        unsigned               m_contour_start;
+        unsigned               m_out_vertex;
+    };
+
+}
+
+
+#endif
+
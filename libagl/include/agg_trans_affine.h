@@ -0,0 +1,173 @@
+//----------------------------------------------------------------------------
+// Anti-Grain Geometry - Version 2.1 Lite
+// Copyright (C) 2002-2003 Maxim Shemanarev (McSeem)
+//
+// Permission to copy, use, modify, sell and distribute this software
+// is granted provided this copyright notice appears in all copies.
+// This software is provided "as is" without express or implied
+// warranty, and with no claim as to its suitability for any purpose.
+//
+//----------------------------------------------------------------------------
+//
+// Affine transformations in fixed point. The matrix is in 16.16, the
+// translation and the transformed points are in the subpixel coordinates
+// of the rasterizer (24.8), so the result goes to rasterizer::move_to() 
+// and line_to() as it is, without floating point at any step.
+//
+//----------------------------------------------------------------------------
+#ifndef AGG_TRANS_AFFINE_INCLUDED
+#define AGG_TRANS_AFFINE_INCLUDED
+
+#include "agg_curves.h"
+
+namespace agg
+{
+
+    //------------------------------------------------------------------------
+    enum
+    {
+        affine_shift = 16,
+        affine_one   = 1 << affine_shift
+    };
+
+    //------------------------------------------------------------------------
+    // For the constants. It uses floating point, so it's not meant to be 
+    // called per vertex.
+    inline int affine_coord(double v)
+    {
+        return int(v * affine_one + ((v < 0.0) ? -0.5 : 0.5));
+    }
+
+
+    //========================================================================
+    // The matrix
+    //
+    //     | sx  shx tx |
+    //     | shy sy  ty |
+    //
+    // x' = sx * x + shx * y + tx, y' = shy * x + sy * y + ty.
+    //
+    // The products are 64-bit and rounded to the nearest subpixel. The
+    // transformations are combined in the order of application:
+    //
+    //     agg::trans_affine mtx;
+    //     mtx *= agg::trans_affine_translation(-cx, -cy);
+    //     mtx *= agg::trans_affine_rotation(agg::curve_angle(0.5));
+    //     mtx *= agg::trans_affine_translation(cx, cy);
+    //     . . .
+    //     mtx.transform(&x, &y);
+    //     ras.line_to(x, y);
+    //------------------------------------------------------------------------
+    class trans_affine
+    {
+    public:
+        // Identity
+        trans_affine() : 
+            sx(affine_one), shy(0), shx(0), sy(affine_one), tx(0), ty(0) {}
+
+        trans_affine(int sx_, int shy_, int shx_, int sy_, int tx_, int ty_) :
+            sx(sx_), shy(shy_), shx(shx_), sy(sy_), tx(tx_), ty(ty_) {}
+
+        //--------------------------------------------------------------------
+        // Applies m after this transformation
+        const trans_affine& multiply(const trans_affine& m);
+
+        // Applies m before this transformation
+        const trans_affine& premultiply(const trans_affine& m);
+
+        const trans_affine& reset() { *this = trans_affine(); return *this; }
+
+        const trans_affine& operator *= (const trans_affine& m)
+        {
+            return multiply(m);
+        }
+
+        trans_affine operator * (const trans_affine& m) const
+        {
+            return trans_affine(*this).multiply(m);
+        }
+
+        //--------------------------------------------------------------------
+        void transform(int* x, int* y) const
+        {
+            int64 x0 = *x;
+            int64 y0 = *y;
+            *x = int((x0 * sx  + y0 * shx + (1 << (affine_shift - 1))) >> affine_shift) + tx;
+            *y = int((x0 * shy + y0 * sy  + (1 << (affine_shift - 1))) >> affine_shift) + ty;
+        }
+
+        // Only the scaling and the rotation, for the vectors
+        void transform_2x2(int* x, int* y) const
+        {
+            int64 x0 = *x;
+            int64 y0 = *y;
+            *x = int((x0 * sx  + y0 * shx + (1 << (affine_shift - 1))) >> affine_shift);
+            *y = int((x0 * shy + y0 * sy  + (1 << (affine_shift - 1))) >> affine_shift);
+        }
+
+        //--------------------------------------------------------------------
+        bool is_identity() const
+        {
+            return sx == affine_one && shy == 0 && shx == 0 && 
+                   sy == affine_one && tx  == 0 && ty  == 0;
+        }
+
+    public:
+        int sx;
+        int shy;
+        int shx;
+        int sy;
+        int tx;
+        int ty;
+    };
+
+
+    //========================================================================
+    // The translation is in the subpixel coordinates
+    class trans_affine_translation : public trans_affine
+    {
+    public:
+        trans_affine_translation(int x, int y) : 
+            trans_affine(affine_one, 0, 0, affine_one, x, y) {}
+    };
+
+    //========================================================================
+    // The scale factors are in 16.16
+    class trans_affine_scaling : public trans_affine
+    {
+    public:
+        trans_affine_scaling(int s) : 
+            trans_affine(s, 0, 0, s, 0, 0) {}
+
+        trans_affine_scaling(int x, int y) : 
+            trans_affine(x, 0, 0, y, 0, 0) {}
+    };
+
+    //========================================================================
+    // The rotation by the angle in the units of curve_angle(), or by the 
+    // sine and cosine in 16.16 when they're known or kept in a table, 
+    // which doesn't calculate anything. The angle increases clockwise on
+    // the screen, like in agg::arc.
+    class trans_affine_rotation : public trans_affine
+    {
+    public:
+        trans_affine_rotation(int a);
+
+        trans_affine_rotation(int s, int c) : 
+            trans_affine(c, s, -s, c, 0, 0) {}
+    };
+
+    //========================================================================
+    // The skewing by the tangents of the angles in 16.16
+    class trans_affine_skewing : public trans_affine
+    {
+    public:
+        trans_affine_skewing(int x, int y) : 
+            trans_affine(affine_one, y, x, affine_one, 0, 0) {}
+    };
+
+}
+
+
+#endif
+
@@ -14,6 +14,7 @@
 //#define TEST_BASIC
 //#define TEST_DIR
 #define TEST_FILE
+//#define AGG_BENCH
 
 static void test_lua(void)
 {
@@ -57,6 +58,7 @@ static void test_lua(void)
 extern void *_heapstart;
 
 extern void agg_test(void);
+extern void agg_bench(void);
 
 int main()
 {
@@ -68,7 +70,11 @@ int main()
 	
 	printf("Hello World\n");
 	test_lua();
+#ifdef AGG_BENCH
+	agg_bench();
+#else
 	agg_test();
+#endif
 	
 	while(1);
 	